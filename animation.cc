@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "animation.h"
+#include "world.h"
+#include <limits>
+
+using namespace std;
+
+namespace foo {
+
+void AnimationArrays::Clear() {
+	first_frame.clear();
+	frame_count.clear();
+	frame.clear();
+	frame_seconds.clear();
+	elapsed.clear();
+	loop.clear();
+	region.clear();
+}
+
+void AnimationArrays::Reserve(size_t count) {
+	first_frame.reserve(count);
+	frame_count.reserve(count);
+	frame.reserve(count);
+	frame_seconds.reserve(count);
+	elapsed.reserve(count);
+	loop.reserve(count);
+	region.reserve(count);
+}
+
+void AnimationArrays::Add(const Animation &animation, int first_region) {
+	first_frame.push_back(animation.first_frame);
+	frame_count.push_back(animation.frame_count);
+	frame.push_back(0);
+	// A frame rate of zero holds the first frame forever.
+	frame_seconds.push_back(animation.fps > 0.0f
+		? 1.0f / animation.fps
+		: numeric_limits<float>::infinity());
+	elapsed.push_back(0.0f);
+	loop.push_back(animation.loop ? 1 : 0);
+	region.push_back(first_region);
+}
+
+void AnimationArrays::SwapRemove(size_t index) {
+	size_t last = size() - 1;
+	first_frame[index] = first_frame[last];
+	frame_count[index] = frame_count[last];
+	frame[index] = frame[last];
+	frame_seconds[index] = frame_seconds[last];
+	elapsed[index] = elapsed[last];
+	loop[index] = loop[last];
+	region[index] = region[last];
+	first_frame.pop_back();
+	frame_count.pop_back();
+	frame.pop_back();
+	frame_seconds.pop_back();
+	elapsed.pop_back();
+	loop.pop_back();
+	region.pop_back();
+}
+
+AnimationPool::AnimationPool() : version_(0) {}
+
+uint32_t AnimationPool::AddSequence(const int *frames, size_t count) {
+	uint32_t first = static_cast<uint32_t>(frames_.size());
+	frames_.insert(end(frames_), frames, frames + count);
+	return first;
+}
+
+void AnimationPool::Add(Entity entity, const Animation &animation) {
+	Remove(entity);
+	if (entity.index >= slots_.size()) {
+		slots_.resize(entity.index + 1, kNoComponentSlot);
+	}
+	slots_[entity.index] = static_cast<uint32_t>(entities_.size());
+	entities_.push_back(entity);
+	animations_.Add(animation, frames_[animation.first_frame]);
+	++version_;
+}
+
+void AnimationPool::Remove(Entity entity) {
+	if (!Has(entity)) {
+		return;
+	}
+
+	uint32_t slot = slots_[entity.index];
+	uint32_t last = static_cast<uint32_t>(entities_.size() - 1);
+	if (slot != last) {
+		entities_[slot] = entities_[last];
+		slots_[entities_[slot].index] = slot;
+	}
+	entities_.pop_back();
+	animations_.SwapRemove(slot);
+	slots_[entity.index] = kNoComponentSlot;
+	++version_;
+}
+
+void AnimationPool::Clear() {
+	slots_.clear();
+	entities_.clear();
+	animations_.Clear();
+	frames_.clear();
+	++version_;
+}
+
+void AnimationPool::Reserve(size_t count) {
+	entities_.reserve(count);
+	animations_.Reserve(count);
+}
+
+void AnimationSystem::Step(World &world, float step_seconds) const {
+	AnimationPool &pool = world.animations();
+	AnimationArrays &animations = pool.animations();
+	const int *frames = pool.frames().data();
+	const size_t count = animations.size();
+	bool changed = false;
+
+	for (size_t i = 0; i < count; ++i) {
+		float elapsed = animations.elapsed[i] + step_seconds;
+		float frame_seconds = animations.frame_seconds[i];
+		if (elapsed < frame_seconds) {
+			animations.elapsed[i] = elapsed;
+			continue;
+		}
+
+		// Slow steps may skip frames rather than slow the animation down.
+		uint32_t advance = static_cast<uint32_t>(elapsed / frame_seconds);
+		elapsed -= advance * frame_seconds;
+		uint32_t frame_count = animations.frame_count[i];
+		uint32_t frame = animations.frame[i] + advance;
+		if (frame >= frame_count) {
+			if (animations.loop[i]) {
+				frame %= frame_count;
+			} else {
+				frame = frame_count - 1;
+				elapsed = 0.0f;
+			}
+		}
+		animations.elapsed[i] = elapsed;
+		animations.frame[i] = frame;
+
+		int region = frames[animations.first_frame[i] + frame];
+		if (region != animations.region[i]) {
+			animations.region[i] = region;
+			changed = true;
+		}
+	}
+
+	if (changed) {
+		pool.MarkChanged();
+	}
+}
+
+} // namespace foo
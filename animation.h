@@ -0,0 +1,160 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef FOO_ASTEROIDS_ANIMATION_H_
+#define FOO_ASTEROIDS_ANIMATION_H_
+
+#include "component_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace foo {
+
+class World;
+
+// State of an animation when it is added to an AnimationPool. Frames are
+// spritesheet region indices stored in the pool by AddSequence().
+struct Animation {
+	uint32_t first_frame;
+	uint32_t frame_count;
+	float fps;
+	bool loop;
+};
+
+// Playing animations as parallel arrays, so advancing them is one pass
+// over a few small arrays. region is the output: the spritesheet region
+// of the current frame, which is all the renderer reads.
+struct AnimationArrays {
+	std::vector<uint32_t> first_frame;
+	std::vector<uint32_t> frame_count;
+	std::vector<uint32_t> frame;
+	std::vector<float> frame_seconds;
+	// Time spent on the current frame.
+	std::vector<float> elapsed;
+	std::vector<uint8_t> loop;
+	std::vector<int> region;
+
+	inline size_t
+	size() const { return frame.size(); }
+
+	void
+	Clear();
+
+	void
+	Reserve(size_t count);
+
+	void
+	Add(const Animation &animation, int first_region);
+
+	// Removes the animation at index by moving the last one into its place.
+	void
+	SwapRemove(size_t index);
+};
+
+// Sparse set of animations, like BodyPool, plus the frame sequences they
+// play. Sequences are shared, so any number of animations of the same
+// effect cost one copy of its frames.
+//
+// version() changes whenever an animation is added or removed or shows
+// another region, so the renderer can skip frames where nothing did.
+class AnimationPool {
+	std::vector<uint32_t> slots_;
+	std::vector<Entity> entities_;
+	AnimationArrays animations_;
+	std::vector<int> frames_;
+	unsigned int version_;
+
+public:
+	AnimationPool();
+
+	// Stores count region indices and returns where they start, for
+	// Animation::first_frame.
+	uint32_t
+	AddSequence(const int *frames, size_t count);
+
+	// Gives entity an animation starting at its first frame, replacing
+	// the one it had. The sequence must not be empty.
+	void
+	Add(Entity entity, const Animation &animation);
+
+	void
+	Remove(Entity entity);
+
+	// Removes every animation and sequence.
+	void
+	Clear();
+
+	void
+	Reserve(size_t count);
+
+	inline bool
+	Has(Entity entity) const {
+		return entity.index < slots_.size()
+			&& kNoComponentSlot != slots_[entity.index]
+			&& entities_[slots_[entity.index]] == entity;
+	}
+
+	// Returns the index of the animation of entity in animations(), or -1.
+	inline int
+	IndexOf(Entity entity) const {
+		return Has(entity) ? static_cast<int>(slots_[entity.index]) : -1;
+	}
+
+	inline size_t
+	size() const { return entities_.size(); }
+
+	inline bool
+	empty() const { return entities_.empty(); }
+
+	// Owner of every animation, parallel to animations().
+	inline const std::vector<Entity>&
+	entities() const { return entities_; }
+
+	inline AnimationArrays&
+	animations() { return animations_; }
+
+	inline const AnimationArrays&
+	animations() const { return animations_; }
+
+	inline const std::vector<int>&
+	frames() const { return frames_; }
+
+	inline unsigned int
+	version() const { return version_; }
+
+	// Called by writers of animations() that changed a region.
+	inline void
+	MarkChanged() { ++version_; }
+};
+
+// Advances every animation of a World at the fixed simulation step.
+class AnimationSystem {
+public:
+	void
+	Step(World &world, float step_seconds) const;
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_ANIMATION_H_
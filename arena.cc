@@ -0,0 +1,139 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "arena.h"
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+const size_t kFirstBlockSize = 16 * 1024;
+const size_t kMaxBlockSize = 4 * 1024 * 1024;
+
+} // namespace
+
+Arena::Arena()
+	: current_(nullptr)
+	, remaining_(0)
+	, next_block_size_(kFirstBlockSize)
+	, used_bytes_(0)
+	, reserved_bytes_(0) {
+}
+
+Arena::Arena(Arena &&other) : Arena() {
+	swap(*this, other);
+}
+
+Arena::~Arena() {}
+
+Arena& Arena::operator=(Arena &&other) {
+	if (this != &other) {
+		Reset();
+		swap(*this, other);
+	}
+	return *this;
+}
+
+void swap(Arena &lhs, Arena &rhs) {
+	using std::swap;
+
+	swap(lhs.blocks_, rhs.blocks_);
+	swap(lhs.current_, rhs.current_);
+	swap(lhs.remaining_, rhs.remaining_);
+	swap(lhs.next_block_size_, rhs.next_block_size_);
+	swap(lhs.used_bytes_, rhs.used_bytes_);
+	swap(lhs.reserved_bytes_, rhs.reserved_bytes_);
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+	size_t padding = (alignment - reinterpret_cast<uintptr_t>(current_)
+		% alignment) % alignment;
+	if (!current_ || padding + size > remaining_) {
+		AddBlock(size + alignment);
+		padding = (alignment - reinterpret_cast<uintptr_t>(current_)
+			% alignment) % alignment;
+	}
+
+	char *result = current_ + padding;
+	current_ += padding + size;
+	remaining_ -= padding + size;
+	used_bytes_ += size;
+	return result;
+}
+
+StringRef Arena::CopyString(const char *data, size_t size) {
+	char *copy = static_cast<char*>(Allocate(size + 1, 1));
+	memcpy(copy, data, size);
+	copy[size] = '\0';
+	return StringRef(copy, size);
+}
+
+void Arena::Reserve(size_t size) {
+	if (size > remaining_) {
+		AddBlock(size);
+	}
+}
+
+void Arena::Absorb(Arena &&other) {
+	// The current block keeps serving allocations; other's blocks are
+	// only kept alive.
+	for (auto &block: other.blocks_) {
+		blocks_.emplace_back(move(block));
+	}
+	used_bytes_ += other.used_bytes_;
+	reserved_bytes_ += other.reserved_bytes_;
+
+	other.blocks_.clear();
+	other.current_ = nullptr;
+	other.remaining_ = 0;
+	other.next_block_size_ = kFirstBlockSize;
+	other.used_bytes_ = 0;
+	other.reserved_bytes_ = 0;
+}
+
+void Arena::Reset() {
+	blocks_.clear();
+	current_ = nullptr;
+	remaining_ = 0;
+	next_block_size_ = kFirstBlockSize;
+	used_bytes_ = 0;
+	reserved_bytes_ = 0;
+}
+
+void Arena::AddBlock(size_t size) {
+	size_t block_size = size > next_block_size_ ? size : next_block_size_;
+	if (next_block_size_ < kMaxBlockSize) {
+		next_block_size_ *= 2;
+	}
+
+	blocks_.emplace_back(new char[block_size]);
+	current_ = blocks_.back().get();
+	remaining_ = block_size;
+	reserved_bytes_ += block_size;
+}
+
+} // namespace foo
@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_ARENA_H_
+#define FOO_ASTEROIDS_ARENA_H_
+
+#include "string_ref.h"
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace foo {
+
+// Monotonic allocator for data that lives exactly as long as its owner,
+// such as everything a Scene loads. Memory comes from a few large blocks
+// and is only given back all at once by Reset() or the destructor, so
+// only trivially destructible types may be created in it.
+class Arena {
+	std::vector<std::unique_ptr<char[]>> blocks_;
+	char *current_;
+	size_t remaining_;
+	size_t next_block_size_;
+	size_t used_bytes_;
+	size_t reserved_bytes_;
+
+public:
+	Arena();
+	Arena(const Arena&) = delete;
+	Arena(Arena &&other);
+	~Arena();
+
+	Arena& operator=(const Arena&) = delete;
+	Arena& operator=(Arena &&other);
+	friend void swap(Arena &lhs, Arena &rhs);
+
+	// alignment must be a power of two.
+	void*
+	Allocate(size_t size, size_t alignment);
+
+	template <typename T>
+	T*
+	New() {
+		static_assert(
+			std::is_trivially_destructible<T>::value,
+			"Arena never runs destructors");
+		return new (Allocate(sizeof(T), alignof(T))) T();
+	}
+
+	// Returns a NUL-terminated copy of value owned by the arena.
+	StringRef
+	CopyString(const char *data, size_t size);
+
+	inline StringRef
+	CopyString(const StringRef &value) {
+		return CopyString(value.data(), value.size());
+	}
+
+	// Makes sure the next size bytes come from a single block. Loaders
+	// call this with an estimate so a whole scene fits in one allocation.
+	void
+	Reserve(size_t size);
+
+	// Takes over the blocks of other, which is left empty. Lets worker
+	// threads fill arenas of their own and hand the result back.
+	void
+	Absorb(Arena &&other);
+
+	// Releases every block.
+	void
+	Reset();
+
+	inline size_t
+	used_bytes() const { return used_bytes_; }
+
+	inline size_t
+	reserved_bytes() const { return reserved_bytes_; }
+
+private:
+	void
+	AddBlock(size_t size);
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_ARENA_H_
@@ -0,0 +1,342 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "atlas_reader.h"
+#include <cstring>
+#include <limits>
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+const char kSubTexture[] = "SubTexture";
+const char kTextureAtlas[] = "TextureAtlas";
+
+enum RegionField {
+	kRegionName = 1 << 0,
+	kRegionX = 1 << 1,
+	kRegionY = 1 << 2,
+	kRegionWidth = 1 << 3,
+	kRegionHeight = 1 << 4,
+	kRegionComplete = (1 << 5) - 1,
+};
+
+inline bool
+IsSpace(char c) {
+	return ' ' == c || '\n' == c || '\r' == c || '\t' == c;
+}
+
+inline bool
+IsNameChar(char c) {
+	return (c >= 'a' && c <= 'z')
+		|| (c >= 'A' && c <= 'Z')
+		|| (c >= '0' && c <= '9')
+		|| '_' == c || '-' == c || ':' == c || '.' == c;
+}
+
+inline bool
+Matches(const char *begin, const char *end, const char *name) {
+	size_t length = strlen(name);
+	return static_cast<size_t>(end - begin) == length
+		&& 0 == memcmp(begin, name, length);
+}
+
+const char*
+Find(const char *begin, const char *end, const char *needle) {
+	size_t length = strlen(needle);
+	for (const char *p = begin;
+			static_cast<size_t>(end - p) >= length;
+			++p) {
+		p = static_cast<const char*>(memchr(p, needle[0], end - p));
+		if (!p || static_cast<size_t>(end - p) < length) {
+			return nullptr;
+		}
+		if (0 == memcmp(p, needle, length)) {
+			return p;
+		}
+	}
+	return nullptr;
+}
+
+// Upper bound on the number of regions, so they are allocated once.
+size_t
+CountSubTextures(const char *begin, const char *end) {
+	const size_t length = sizeof(kSubTexture) - 1;
+	size_t count = 0;
+	for (const char *p = begin; p != end; ++p) {
+		p = static_cast<const char*>(memchr(p, '<', end - p));
+		if (!p) {
+			break;
+		}
+		if (static_cast<size_t>(end - p) > length
+				&& 0 == memcmp(p + 1, kSubTexture, length)) {
+			++count;
+		}
+	}
+	return count;
+}
+
+// Matches what tinyxml2's QueryAttribute accepts for well-formed atlases:
+// an optionally signed run of digits, optionally padded with spaces.
+bool
+ParseInt(const char *begin, const char *end, int &out) {
+	while (begin != end && IsSpace(*begin)) ++begin;
+	while (begin != end && IsSpace(end[-1])) --end;
+
+	bool negative = false;
+	if (begin != end && '-' == *begin) {
+		negative = true;
+		++begin;
+	}
+	if (begin == end) {
+		return false;
+	}
+
+	long long value = 0;
+	for (; begin != end; ++begin) {
+		if (*begin < '0' || *begin > '9') {
+			return false;
+		}
+		value = value * 10 + (*begin - '0');
+		if (value > numeric_limits<int>::max()) {
+			return false;
+		}
+	}
+	out = static_cast<int>(negative ? -value : value);
+	return true;
+}
+
+// Copies an attribute value, expanding the predefined and numeric
+// character references.
+bool
+DecodeValue(const char *begin, const char *end, string &out) {
+	const char *amp = static_cast<const char*>(
+		memchr(begin, '&', end - begin));
+	if (!amp) {
+		out.assign(begin, end);
+		return true;
+	}
+
+	out.assign(begin, amp);
+	for (const char *p = amp; p != end; ) {
+		if ('&' != *p) {
+			out.push_back(*p++);
+			continue;
+		}
+
+		const char *semicolon = static_cast<const char*>(
+			memchr(p, ';', end - p));
+		if (!semicolon) {
+			return false;
+		}
+		const char *entity = p + 1;
+		if (Matches(entity, semicolon, "amp")) {
+			out.push_back('&');
+		} else if (Matches(entity, semicolon, "lt")) {
+			out.push_back('<');
+		} else if (Matches(entity, semicolon, "gt")) {
+			out.push_back('>');
+		} else if (Matches(entity, semicolon, "quot")) {
+			out.push_back('"');
+		} else if (Matches(entity, semicolon, "apos")) {
+			out.push_back('\'');
+		} else {
+			// Numeric references are rare enough in atlases that the
+			// fallback can deal with them.
+			return false;
+		}
+		p = semicolon + 1;
+	}
+	return true;
+}
+
+} // namespace
+
+bool
+ReadTextureAtlas(
+		const char *data,
+		size_t size,
+		string &image_path,
+		vector<SceneSceneSpritesheetRegion> &regions) {
+	const char *p = data;
+	const char *end = data + size;
+	string name_buffer;
+	int depth = 0;
+	bool has_root = false;
+	bool has_image_path = false;
+
+	regions.clear();
+	regions.reserve(CountSubTextures(p, end));
+
+	for (;;) {
+		p = static_cast<const char*>(memchr(p, '<', end - p));
+		if (!p) {
+			break;
+		}
+		++p;
+		if (p == end) {
+			return false;
+		}
+
+		if ('?' == *p) {
+			p = Find(p, end, "?>");
+			if (!p) return false;
+			continue;
+		}
+		if ('!' == *p) {
+			if (end - p < 3 || 0 != memcmp(p, "!--", 3)) {
+				return false;
+			}
+			p = Find(p + 3, end, "-->");
+			if (!p) return false;
+			continue;
+		}
+		if ('/' == *p) {
+			p = static_cast<const char*>(memchr(p, '>', end - p));
+			if (!p || 0 == depth) return false;
+			--depth;
+			continue;
+		}
+
+		const char *name = p;
+		while (p != end && IsNameChar(*p)) ++p;
+		const char *name_end = p;
+		if (name == name_end) {
+			return false;
+		}
+
+		bool is_root = 0 == depth;
+		bool is_region = 1 == depth
+			&& Matches(name, name_end, kSubTexture);
+		if (is_root && (has_root
+				|| !Matches(name, name_end, kTextureAtlas))) {
+			return false;
+		}
+		has_root = has_root || is_root;
+
+		SceneSceneSpritesheetRegion region;
+		unsigned fields = 0;
+		bool self_closing = false;
+		for (;;) {
+			while (p != end && IsSpace(*p)) ++p;
+			if (p == end) {
+				return false;
+			}
+			if ('>' == *p) {
+				++p;
+				break;
+			}
+			if ('/' == *p) {
+				if (end - p < 2 || '>' != p[1]) return false;
+				p += 2;
+				self_closing = true;
+				break;
+			}
+
+			const char *attribute = p;
+			while (p != end && IsNameChar(*p)) ++p;
+			const char *attribute_end = p;
+			while (p != end && IsSpace(*p)) ++p;
+			if (attribute == attribute_end || p == end || '=' != *p) {
+				return false;
+			}
+			++p;
+			while (p != end && IsSpace(*p)) ++p;
+			if (p == end || ('"' != *p && '\'' != *p)) {
+				return false;
+			}
+			const char quote = *p++;
+			const char *value = p;
+			p = static_cast<const char*>(memchr(p, quote, end - p));
+			if (!p) {
+				return false;
+			}
+			const char *value_end = p++;
+
+			if (is_root) {
+				if (Matches(attribute, attribute_end, "imagePath")) {
+					if (!DecodeValue(value, value_end, image_path)) {
+						return false;
+					}
+					has_image_path = true;
+				}
+				continue;
+			}
+			if (!is_region) {
+				continue;
+			}
+
+			// Attribute names are told apart by length and first
+			// letter before comparing them in full.
+			bool parsed = true;
+			switch (attribute_end - attribute) {
+			case 1:
+				if ('x' == *attribute) {
+					parsed = ParseInt(value, value_end, region.x);
+					fields |= kRegionX;
+				} else if ('y' == *attribute) {
+					parsed = ParseInt(value, value_end, region.y);
+					fields |= kRegionY;
+				}
+				break;
+			case 4:
+				if (Matches(attribute, attribute_end, "name")) {
+					parsed = DecodeValue(value, value_end, name_buffer);
+					region.name = InternAtom(name_buffer);
+					fields |= kRegionName;
+				}
+				break;
+			case 5:
+				if (Matches(attribute, attribute_end, "width")) {
+					parsed = ParseInt(value, value_end, region.width);
+					fields |= kRegionWidth;
+				}
+				break;
+			case 6:
+				if (Matches(attribute, attribute_end, "height")) {
+					parsed = ParseInt(value, value_end, region.height);
+					fields |= kRegionHeight;
+				}
+				break;
+			}
+			if (!parsed) {
+				return false;
+			}
+		}
+
+		if (is_region) {
+			if (fields != kRegionComplete) {
+				return false;
+			}
+			regions.emplace_back(move(region));
+		}
+		if (!self_closing) {
+			++depth;
+		}
+	}
+
+	return has_root && has_image_path && 0 == depth;
+}
+
+} // namespace foo
@@ -0,0 +1,49 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_ATLAS_READER_H_
+#define FOO_ASTEROIDS_ATLAS_READER_H_
+
+#include "scene.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace foo {
+
+// Reads a TextureAtlas document in [data, data + size) in one pass,
+// appending a region per SubTexture child of the root, with names interned
+// as atoms. Each element's attributes are scanned once and x, y, width
+// and height are parsed as plain integers. Returns false on anything it
+// does not handle - other root elements, DOCTYPE or CDATA sections,
+// numeric character references, integers with fractions - so the caller
+// can fall back to tinyxml2.
+bool
+ReadTextureAtlas(
+	const char *data,
+	size_t size,
+	std::string &image_path,
+	std::vector<SceneSceneSpritesheetRegion> &regions);
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_ATLAS_READER_H_
@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "atom.h"
+#include "arena.h"
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+// Names live in an arena that is never reset; slots is an open-addressed
+// hash table of atoms, kept at most half full.
+class AtomTable {
+	mutex mutex_;
+	Arena arena_;
+	vector<StringRef> names_;
+	vector<uint64_t> hashes_;
+	vector<Atom> slots_;
+
+public:
+	AtomTable() : names_(1), hashes_(1, 0), slots_(1024, kNoAtom) {}
+
+	Atom
+	Intern(const StringRef &name, bool add) {
+		if (name.empty()) {
+			return kNoAtom;
+		}
+
+		uint64_t hash = HashString(name.data(), name.size());
+		lock_guard<mutex> lock(mutex_);
+
+		size_t mask = slots_.size() - 1;
+		size_t slot = hash & mask;
+		for (Atom atom; (atom = slots_[slot]) != kNoAtom;
+				slot = (slot + 1) & mask) {
+			if (hashes_[atom] == hash && names_[atom] == name) {
+				return atom;
+			}
+		}
+		if (!add) {
+			return kNoAtom;
+		}
+
+		Atom atom = static_cast<Atom>(names_.size());
+		names_.push_back(arena_.CopyString(name));
+		hashes_.push_back(hash);
+		slots_[slot] = atom;
+		if (names_.size() * 2 > slots_.size()) {
+			Grow();
+		}
+		return atom;
+	}
+
+	StringRef
+	Name(Atom atom) {
+		lock_guard<mutex> lock(mutex_);
+		return atom < names_.size() ? names_[atom] : StringRef();
+	}
+
+private:
+	void
+	Grow() {
+		vector<Atom> slots(slots_.size() * 2, kNoAtom);
+		size_t mask = slots.size() - 1;
+		for (Atom atom = 1; atom < names_.size(); ++atom) {
+			size_t slot = hashes_[atom] & mask;
+			while (slots[slot] != kNoAtom) {
+				slot = (slot + 1) & mask;
+			}
+			slots[slot] = atom;
+		}
+		slots_.swap(slots);
+	}
+};
+
+AtomTable&
+GetAtomTable() {
+	static AtomTable table;
+	return table;
+}
+
+} // namespace
+
+Atom
+InternAtom(const StringRef &name) {
+	return GetAtomTable().Intern(name, true);
+}
+
+Atom
+FindAtom(const StringRef &name) {
+	return GetAtomTable().Intern(name, false);
+}
+
+StringRef
+AtomName(Atom atom) {
+	return GetAtomTable().Name(atom);
+}
+
+} // namespace foo
@@ -0,0 +1,55 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_ATOM_H_
+#define FOO_ASTEROIDS_ATOM_H_
+
+#include "string_ref.h"
+#include <cstdint>
+
+namespace foo {
+
+// Process-wide interned string. Equal names always map to the same atom,
+// so ids are compared and hashed as integers. Atoms are never freed:
+// reloading a scene interns the same names again and gets the same atoms
+// back, so the table only grows with the number of distinct names.
+typedef uint32_t Atom;
+
+const Atom kNoAtom = 0;
+
+// Returns the atom for name, adding it if needed. The empty string is
+// kNoAtom. Safe to call from any thread.
+Atom
+InternAtom(const StringRef &name);
+
+// Returns the atom for name if it was interned before, or kNoAtom.
+Atom
+FindAtom(const StringRef &name);
+
+// Returns the NUL-terminated name of atom; stays valid for the lifetime
+// of the process. kNoAtom is the empty string.
+StringRef
+AtomName(Atom atom);
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_ATOM_H_
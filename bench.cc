@@ -0,0 +1,1090 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "scene.h"
+#include "collision.h"
+#include "collision_mask.h"
+#include "kinematics.h"
+#include "animation.h"
+#include "particles.h"
+#include "renderer.h"
+#include "thread_pool.h"
+#include "timing.h"
+#include "transform.h"
+#include "world.h"
+#include "SDL.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace foo;
+using namespace std;
+
+namespace {
+
+const char kAssetsPrefix[] = "assets/";
+const char kBaseScene[] = "assets/scene.json";
+const int kRuns = 5;
+const size_t kBodies = 1000000;
+const float kStepSeconds = 1.0f / 60.0f;
+
+atomic<unsigned long long> g_allocations(0);
+
+struct Options {
+	const char *mode;
+	const char *scene;
+	int frames;
+	bool headless;
+
+	Options()
+		: mode("frames")
+		, scene(kBaseScene)
+		, frames(1000)
+		, headless(true) {}
+};
+
+void
+InitializeRenderSystem(const Options &options, RenderSystem &render_system) {
+	render_system.set_headless(options.headless);
+	render_system.Initialize();
+	render_system.set_vsync(false);
+}
+
+// Writes a scene with the atlas and background of the base scene and
+// object_count sprites scattered over it. Unless max_spin is zero, every
+// sprite spins at up to max_spin degrees per second either way, and
+// unless max_speed is zero moves at up to max_speed pixels per second
+// along each axis.
+string
+GenerateScene(
+		const Scene &base,
+		size_t object_count,
+		float max_spin = 0.0f,
+		float max_speed = 0.0f) {
+	const SceneSpritesheet &sheet = base.spritesheets().front();
+	mt19937 random(1234);
+	uniform_int_distribution<size_t> pick_region(
+		0, sheet.regions.size() - 1);
+	uniform_int_distribution<int> pick_x(0, base.width());
+	uniform_int_distribution<int> pick_y(0, base.height());
+	uniform_real_distribution<float> pick_spin(-max_spin, max_spin);
+	uniform_real_distribution<float> pick_speed(-max_speed, max_speed);
+
+	ostringstream out;
+	out << "{\"id\":\"bench\",\"title\":\"bench\","
+		<< "\"width\":" << base.width() << ","
+		<< "\"height\":" << base.height() << ","
+		<< "\"spritesheets\":[{\"id\":\"sheet\",\"path\":\"sheet.xml\"}],"
+		<< "\"textures\":[{\"id\":\"background\","
+		<< "\"path\":\"background/darkPurple.png\"}],"
+		<< "\"objects\":[{\"id\":\"background\",\"position\":[0,0],"
+		<< "\"components\":[{\"type\":\"texture\","
+		<< "\"texture_id\":\"background\"},"
+		<< "{\"type\":\"texture_repeat\",\"repeat\":[3,2]}]}";
+
+	for (size_t i = 0; i < object_count; ++i) {
+		out << ",{\"id\":\"object" << i << "\",\"position\":["
+			<< pick_x(random) << "," << pick_y(random) << "],"
+			<< "\"components\":[{\"type\":\"texture\",\"texture_id\":"
+			<< "\"sheet:"
+			<< AtomName(sheet.regions[pick_region(random)].name).c_str()
+			<< "\"}";
+		if (max_spin != 0.0f || max_speed != 0.0f) {
+			out << ",{\"type\":\"velocity\",\"velocity\":["
+				<< pick_speed(random) << "," << pick_speed(random) << "],"
+				<< "\"angular_velocity\":" << pick_spin(random) << "}";
+		}
+		out << "]}";
+	}
+
+	out << "]}";
+	return out.str();
+}
+
+double
+Median(vector<double> samples) {
+	sort(begin(samples), end(samples));
+	return samples[samples.size() / 2];
+}
+
+double
+Percentile(const vector<double> &sorted, double percentile) {
+	size_t index = static_cast<size_t>(percentile * (sorted.size() - 1));
+	return sorted[index];
+}
+
+// Measures scene parsing and RenderSystem's object binding pass on
+// synthetic scenes, to check that both scale linearly with object count.
+int
+BenchmarkBinding(const Options &options) {
+	Scene base;
+	base.LoadFromFile(kBaseScene);
+	World world;
+	InstantiateScene(base, world);
+
+	RenderSystem render_system;
+	InitializeRenderSystem(options, render_system);
+	// Creates the renderer and fills the texture cache, so the timed runs
+	// only measure binding.
+	render_system.ProcessScene(base, world);
+	render_system.FinishLoading();
+
+	SDL_LogSetAllPriority(SDL_LOG_PRIORITY_WARN);
+
+	const size_t counts[] = { 1000, 10000, 100000 };
+	for (size_t count: counts) {
+		string document = GenerateScene(base, count);
+
+		vector<double> load_samples;
+		vector<double> bind_samples;
+		for (int run = 0; run < kRuns; ++run) {
+			Scene scene;
+
+			FrameClock clock;
+			scene.LoadFromBuffer(
+				document.data(), document.size(), kAssetsPrefix);
+			load_samples.push_back(clock.Tick());
+			InstantiateScene(scene, world);
+			render_system.ProcessScene(scene, world);
+			bind_samples.push_back(clock.Tick());
+		}
+
+		double load = Median(load_samples);
+		double bind = Median(bind_samples);
+		SDL_Log(
+			"bind %7lu objects: load %9.3f ms (%7.1f ns/object),"
+			" process %9.3f ms (%7.1f ns/object)\n",
+			static_cast<unsigned long>(count),
+			load,
+			load * 1e6 / count,
+			bind,
+			bind * 1e6 / count);
+	}
+
+	return 0;
+}
+
+// Compares the jsoncpp DOM reader with the streaming reader on synthetic
+// scenes. Both produce identical scenes; the streaming reader should need
+// far fewer allocations since it never builds a Json::Value tree.
+int
+BenchmarkParsing(const Options & /*options*/) {
+	Scene base;
+	base.LoadFromFile(kBaseScene);
+
+	SDL_LogSetAllPriority(SDL_LOG_PRIORITY_WARN);
+
+	const size_t counts[] = { 10000, 100000, 500000 };
+	for (size_t count: counts) {
+		string document = GenerateScene(base, count);
+
+		vector<double> dom_samples;
+		vector<double> stream_samples;
+		unsigned long long dom_allocations = 0;
+		unsigned long long stream_allocations = 0;
+		for (int run = 0; run < kRuns; ++run) {
+			{
+				Scene scene;
+				istringstream in(document);
+				unsigned long long before = g_allocations.load();
+				FrameClock clock;
+				scene.LoadFromStream(in, kAssetsPrefix);
+				dom_samples.push_back(clock.Tick());
+				dom_allocations = g_allocations.load() - before;
+			}
+			{
+				Scene scene;
+				unsigned long long before = g_allocations.load();
+				FrameClock clock;
+				scene.LoadFromBuffer(
+					document.data(), document.size(), kAssetsPrefix);
+				stream_samples.push_back(clock.Tick());
+				stream_allocations = g_allocations.load() - before;
+			}
+		}
+
+		double dom = Median(dom_samples);
+		double stream = Median(stream_samples);
+		SDL_Log(
+			"parse %7lu objects: dom %9.3f ms (%llu allocations),"
+			" stream %9.3f ms (%llu allocations), %.2fx\n",
+			static_cast<unsigned long>(count),
+			dom,
+			dom_allocations,
+			stream,
+			stream_allocations,
+			dom / stream);
+	}
+
+	return 0;
+}
+
+// Renders a scene for a number of frames as fast as possible and reports
+// the distribution of frame times together with per-frame draw calls and
+// heap allocations.
+int
+BenchmarkFrames(const Options &options) {
+	Scene scene;
+	scene.LoadFromFile(options.scene);
+	World world;
+	InstantiateScene(scene, world);
+
+	RenderSystem render_system;
+	InitializeRenderSystem(options, render_system);
+	render_system.ProcessScene(scene, world);
+	render_system.FinishLoading();
+
+	SDL_LogSetAllPriority(SDL_LOG_PRIORITY_WARN);
+
+	// Warm up, so buffers reach their steady-state capacity.
+	for (int i = 0; i < 10; ++i) {
+		render_system.Update(world, 0.0f, 0.0f);
+	}
+
+	vector<double> frame_times;
+	frame_times.reserve(options.frames);
+	unsigned long long draw_calls = 0;
+	unsigned long long quads = 0;
+	unsigned long long allocations_before = g_allocations.load();
+
+	FrameClock clock;
+	double total = 0.0;
+	for (int i = 0; i < options.frames; ++i) {
+		clock.Reset();
+		render_system.Update(world, 0.0f, 0.0f);
+		double elapsed = clock.Tick();
+		frame_times.push_back(elapsed);
+		total += elapsed;
+		draw_calls += render_system.stats().draw_calls;
+		quads += render_system.stats().quads;
+	}
+
+	unsigned long long allocations =
+		g_allocations.load() - allocations_before;
+
+	sort(begin(frame_times), end(frame_times));
+	SDL_Log(
+		"%s: %d frames %s, %.1f fps\n",
+		options.scene,
+		options.frames,
+		options.headless ? "headless" : "windowed",
+		options.frames * 1000.0 / total);
+	SDL_Log(
+		"frame ms: p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n",
+		Percentile(frame_times, 0.50),
+		Percentile(frame_times, 0.95),
+		Percentile(frame_times, 0.99),
+		frame_times.back());
+	SDL_Log(
+		"per frame: %.1f draw calls, %.1f quads, %.2f allocations\n",
+		static_cast<double>(draw_calls) / options.frames,
+		static_cast<double>(quads) / options.frames,
+		static_cast<double>(allocations) / options.frames);
+
+	return 0;
+}
+
+// Steps a million bodies wrapping around a 1920x1080 playfield, without
+// rendering, and reports the time per step.
+int
+BenchmarkKinematics(const Options &options) {
+	World world;
+	world.bodies().Reserve(kBodies);
+	mt19937 random(42);
+	uniform_real_distribution<float> pick_x(0.0f, 1920.0f);
+	uniform_real_distribution<float> pick_y(0.0f, 1080.0f);
+	uniform_real_distribution<float> pick_speed(-200.0f, 200.0f);
+	for (size_t i = 0; i < kBodies; ++i) {
+		Body body = {
+			pick_x(random),
+			pick_y(random),
+			pick_speed(random),
+			pick_speed(random),
+			0.0f,
+			pick_speed(random)
+		};
+		world.bodies().Add(world.Create(), body);
+	}
+
+	KinematicsSystem kinematics;
+	kinematics.set_bounds(0.0f, 0.0f, 1920.0f, 1080.0f);
+
+	int steps = min(options.frames, 200);
+	vector<double> step_times;
+	step_times.reserve(steps);
+	FrameClock clock;
+	for (int i = 0; i < steps; ++i) {
+		clock.Reset();
+		kinematics.Step(world, kStepSeconds);
+		step_times.push_back(clock.Tick());
+	}
+
+	sort(begin(step_times), end(step_times));
+	double median = Percentile(step_times, 0.50);
+	SDL_Log(
+		"kinematics: %lu bodies, %d steps, p50 %.3f ms, max %.3f ms"
+		" per step (%.2f ns/body, %.0f M bodies/s)\n",
+		static_cast<unsigned long>(kBodies),
+		steps,
+		median,
+		step_times.back(),
+		median * 1e6 / kBodies,
+		kBodies / (median * 1e3));
+	return 0;
+}
+
+// Steps a million animations of a 20-frame sequence at mixed frame
+// rates and reports the time per step.
+int
+BenchmarkAnimation(const Options &options) {
+	const int kFrames = 20;
+	int sequence[kFrames];
+	for (int i = 0; i < kFrames; ++i) {
+		sequence[i] = i;
+	}
+
+	World world;
+	AnimationPool &animations = world.animations();
+	animations.Reserve(kBodies);
+	uint32_t first_frame = animations.AddSequence(sequence, kFrames);
+	mt19937 random(42);
+	uniform_real_distribution<float> pick_fps(5.0f, 60.0f);
+	for (size_t i = 0; i < kBodies; ++i) {
+		Animation animation = {
+			first_frame,
+			kFrames,
+			pick_fps(random),
+			0 != (i & 1)
+		};
+		animations.Add(world.Create(), animation);
+	}
+
+	AnimationSystem animation;
+	int steps = min(options.frames, 200);
+	vector<double> step_times;
+	step_times.reserve(steps);
+	FrameClock clock;
+	for (int i = 0; i < steps; ++i) {
+		clock.Reset();
+		animation.Step(world, kStepSeconds);
+		step_times.push_back(clock.Tick());
+	}
+
+	sort(begin(step_times), end(step_times));
+	double median = Percentile(step_times, 0.50);
+	SDL_Log(
+		"animation: %lu animations, %d steps, p50 %.3f ms, max %.3f ms"
+		" per step (%.2f ns/animation)\n",
+		static_cast<unsigned long>(kBodies),
+		steps,
+		median,
+		step_times.back(),
+		median * 1e6 / kBodies);
+	return 0;
+}
+
+// Times the transform pass alone on 100k sprites turning every step, then
+// renders a scene of as many spinning sprites, stepping and publishing
+// their bodies every frame so every corner is computed again.
+int
+BenchmarkRotation(const Options &options) {
+	const size_t kSprites = 100000;
+	const float kMaxSpin = 180.0f;
+
+	RenderList list;
+	list.Reserve(kSprites);
+	mt19937 random(42);
+	uniform_int_distribution<int> pick_x(0, 1920);
+	uniform_int_distribution<int> pick_y(0, 1080);
+	uniform_int_distribution<int> pick_size(16, 128);
+	uniform_real_distribution<float> pick_angle(0.0f, 360.0f);
+	uniform_real_distribution<float> pick_scale(0.5f, 2.0f);
+	for (size_t i = 0; i < kSprites; ++i) {
+		size_t index = list.Add(
+			pick_x(random),
+			pick_y(random),
+			pick_size(random),
+			pick_size(random),
+			0);
+		list.rotation[index] = pick_angle(random);
+		list.scale_x[index] = pick_scale(random);
+		list.scale_y[index] = list.scale_x[index];
+	}
+
+	QuadCorners corners;
+	int steps = min(options.frames, 200);
+	vector<double> pass_times;
+	pass_times.reserve(steps);
+	FrameClock clock;
+	for (int i = 0; i < steps; ++i) {
+		for (float &rotation: list.rotation) {
+			rotation += 1.0f;
+		}
+		clock.Reset();
+		TransformRenderList(list, corners);
+		pass_times.push_back(clock.Tick());
+	}
+
+	sort(begin(pass_times), end(pass_times));
+	double median = Percentile(pass_times, 0.50);
+	SDL_Log(
+		"transform pass: %lu sprites, p50 %.3f ms, max %.3f ms"
+		" (%.2f ns/sprite)\n",
+		static_cast<unsigned long>(kSprites),
+		median,
+		pass_times.back(),
+		median * 1e6 / kSprites);
+
+	Scene base;
+	base.LoadFromFile(kBaseScene);
+	string document = GenerateScene(base, kSprites, kMaxSpin);
+	Scene scene;
+	scene.LoadFromBuffer(document.data(), document.size(), kAssetsPrefix);
+	World world;
+	InstantiateScene(scene, world);
+
+	RenderSystem render_system;
+	InitializeRenderSystem(options, render_system);
+	render_system.ProcessScene(scene, world);
+	render_system.FinishLoading();
+	KinematicsSystem kinematics;
+	kinematics.set_bounds(
+		0.0f,
+		0.0f,
+		static_cast<float>(scene.width()),
+		static_cast<float>(scene.height()));
+
+	SDL_LogSetAllPriority(SDL_LOG_PRIORITY_WARN);
+
+	for (int i = 0; i < 10; ++i) {
+		kinematics.Step(world, kStepSeconds);
+		kinematics.Publish(world, 1.0f);
+		render_system.Update(world, 0.0f, 0.0f);
+	}
+
+	vector<double> frame_times;
+	frame_times.reserve(options.frames);
+	unsigned long long quads = 0;
+	unsigned long long allocations_before = g_allocations.load();
+	for (int i = 0; i < options.frames; ++i) {
+		kinematics.Step(world, kStepSeconds);
+		kinematics.Publish(world, 1.0f);
+		clock.Reset();
+		render_system.Update(world, 0.0f, 0.0f);
+		frame_times.push_back(clock.Tick());
+		quads += render_system.stats().quads;
+	}
+	unsigned long long allocations =
+		g_allocations.load() - allocations_before;
+
+	sort(begin(frame_times), end(frame_times));
+	SDL_Log(
+		"rotation: %lu spinning sprites, %d frames, render p50 %.3f ms,"
+		" p99 %.3f ms, %.1f quads, %.2f allocations per frame\n",
+		static_cast<unsigned long>(kSprites),
+		options.frames,
+		Percentile(frame_times, 0.50),
+		Percentile(frame_times, 0.99),
+		static_cast<double>(quads) / options.frames,
+		static_cast<double>(allocations) / options.frames);
+	return 0;
+}
+
+// Steps 100 emitters of 2000 particles each, about 200k live particles,
+// on one thread and then on a thread pool, does the same with a single
+// emitter of 200k, and renders the 100 emitters over the base scene.
+int
+BenchmarkParticles(const Options &options) {
+	const size_t kEmitters = 100;
+	const uint32_t kCapacity = 2000;
+
+	Scene scene;
+	scene.LoadFromFile(kBaseScene);
+	World world;
+	InstantiateScene(scene, world);
+
+	const SceneComponentEmitter *source = nullptr;
+	for (const auto &object: scene.objects()) {
+		if (object.emitter && object.emitter->frame_count > 0) {
+			source = object.emitter;
+			break;
+		}
+	}
+	if (!source) {
+		SDL_LogError(
+			SDL_LOG_CATEGORY_APPLICATION,
+			"%s has no emitter with frames\n",
+			kBaseScene);
+		return 1;
+	}
+
+	ParticlePool &particles = world.particles();
+	uint32_t first_frame = particles.AddSequence(
+		source->frames, source->frame_count);
+	mt19937 random(42);
+	uniform_int_distribution<int> pick_x(0, scene.width());
+	uniform_int_distribution<int> pick_y(0, scene.height());
+	for (size_t i = 0; i < kEmitters; ++i) {
+		Entity entity = world.Create();
+		PositionComponent position = { pick_x(random), pick_y(random) };
+		world.positions().Add(entity, position);
+		Emitter emitter = {
+			source->spritesheet_index,
+			first_frame,
+			static_cast<uint32_t>(source->frame_count),
+			false,
+			kCapacity,
+			2000.0f,
+			0,
+			1.0f,
+			1.0f,
+			20.0f,
+			120.0f,
+			0.0f,
+			360.0f,
+			0.0f,
+			0.0f,
+			0.0f,
+			0.0f
+		};
+		particles.Add(entity, emitter);
+	}
+
+	ParticleSystem system;
+	// Fill every emitter before measuring.
+	for (int i = 0; i < 90; ++i) {
+		system.Step(world, kStepSeconds);
+	}
+
+	int steps = min(options.frames, 200);
+	vector<double> single_times;
+	single_times.reserve(steps);
+	FrameClock clock;
+	for (int i = 0; i < steps; ++i) {
+		clock.Reset();
+		system.Step(world, kStepSeconds);
+		single_times.push_back(clock.Tick());
+	}
+
+	ThreadPool pool;
+	// Let the pool's queue and the system's slices reach their size.
+	system.Step(world, kStepSeconds, &pool);
+	vector<double> pooled_times;
+	pooled_times.reserve(steps);
+	unsigned long long pooled_allocations_before = g_allocations.load();
+	for (int i = 0; i < steps; ++i) {
+		clock.Reset();
+		system.Step(world, kStepSeconds, &pool);
+		pooled_times.push_back(clock.Tick());
+	}
+	unsigned long long pooled_allocations =
+		g_allocations.load() - pooled_allocations_before;
+
+	size_t live = particles.particle_count();
+	sort(begin(single_times), end(single_times));
+	sort(begin(pooled_times), end(pooled_times));
+	SDL_Log(
+		"particles: %lu live in %lu emitters, step p50 %.3f ms"
+		" (%.2f ns/particle), %lu threads p50 %.3f ms"
+		" (%.2f allocations per step)\n",
+		static_cast<unsigned long>(live),
+		static_cast<unsigned long>(kEmitters),
+		Percentile(single_times, 0.50),
+		Percentile(single_times, 0.50) * 1e6 / max<size_t>(live, 1),
+		static_cast<unsigned long>(pool.size()),
+		Percentile(pooled_times, 0.50),
+		static_cast<double>(pooled_allocations) / steps);
+
+	// The same number of particles in a single emitter, which the pool
+	// can only share out by slicing it.
+	{
+		World single_world;
+		Entity entity = single_world.Create();
+		PositionComponent position = { scene.width() / 2, scene.height() / 2 };
+		single_world.positions().Add(entity, position);
+		ParticlePool &single_particles = single_world.particles();
+		Emitter emitter = {
+			source->spritesheet_index,
+			single_particles.AddSequence(
+				source->frames, source->frame_count),
+			static_cast<uint32_t>(source->frame_count),
+			false,
+			static_cast<uint32_t>(kEmitters * kCapacity),
+			kEmitters * 2000.0f,
+			0,
+			1.0f,
+			1.0f,
+			20.0f,
+			120.0f,
+			0.0f,
+			360.0f,
+			0.0f,
+			0.0f,
+			0.0f,
+			0.0f
+		};
+		single_particles.Add(entity, emitter);
+		for (int i = 0; i < 90; ++i) {
+			system.Step(single_world, kStepSeconds, &pool);
+		}
+
+		single_times.clear();
+		pooled_times.clear();
+		for (int i = 0; i < steps; ++i) {
+			clock.Reset();
+			system.Step(single_world, kStepSeconds);
+			single_times.push_back(clock.Tick());
+		}
+		for (int i = 0; i < steps; ++i) {
+			clock.Reset();
+			system.Step(single_world, kStepSeconds, &pool);
+			pooled_times.push_back(clock.Tick());
+		}
+		sort(begin(single_times), end(single_times));
+		sort(begin(pooled_times), end(pooled_times));
+		SDL_Log(
+			"particles: %lu live in 1 emitter, step p50 %.3f ms,"
+			" %lu threads p50 %.3f ms\n",
+			static_cast<unsigned long>(single_particles.particle_count()),
+			Percentile(single_times, 0.50),
+			static_cast<unsigned long>(pool.size()),
+			Percentile(pooled_times, 0.50));
+	}
+
+	RenderSystem render_system;
+	InitializeRenderSystem(options, render_system);
+	render_system.ProcessScene(scene, world);
+	render_system.FinishLoading();
+
+	SDL_LogSetAllPriority(SDL_LOG_PRIORITY_WARN);
+
+	for (int i = 0; i < 10; ++i) {
+		system.Step(world, kStepSeconds);
+		render_system.Update(world, 0.0f, 0.0f);
+	}
+
+	vector<double> frame_times;
+	frame_times.reserve(options.frames);
+	unsigned long long quads = 0;
+	unsigned long long allocations_before = g_allocations.load();
+	for (int i = 0; i < options.frames; ++i) {
+		system.Step(world, kStepSeconds);
+		clock.Reset();
+		render_system.Update(world, 0.0f, 0.0f);
+		frame_times.push_back(clock.Tick());
+		quads += render_system.stats().quads;
+	}
+	unsigned long long allocations =
+		g_allocations.load() - allocations_before;
+
+	sort(begin(frame_times), end(frame_times));
+	SDL_Log(
+		"particles: %d frames, render p50 %.3f ms, p99 %.3f ms,"
+		" %.1f quads, %.2f allocations per frame\n",
+		options.frames,
+		Percentile(frame_times, 0.50),
+		Percentile(frame_times, 0.99),
+		static_cast<double>(quads) / options.frames,
+		static_cast<double>(allocations) / options.frames);
+	return 0;
+}
+
+// Renders the base scene with and without a HUD of three counters, one
+// of which changes every frame and is laid out again, to measure what
+// the HUD adds per frame.
+int
+BenchmarkHud(const Options &options) {
+	Scene scene;
+	scene.LoadFromFile(kBaseScene);
+	World world;
+	InstantiateScene(scene, world);
+
+	RenderSystem render_system;
+	InitializeRenderSystem(options, render_system);
+	render_system.ProcessScene(scene, world);
+	render_system.FinishLoading();
+
+	SDL_LogSetAllPriority(SDL_LOG_PRIORITY_WARN);
+
+	FrameClock clock;
+	Hud &hud = render_system.hud();
+	int score = -1;
+	for (int pass = 0; pass < 2; ++pass) {
+		if (1 == pass) {
+			score = hud.AddCounter(16, 16);
+			int lives = hud.AddCounter(
+				600, 16, InternAtom("playerLife1_orange.png"), true);
+			int fps = hud.AddCounter(16, 450);
+			hud.SetValue(lives, 3);
+			hud.SetValue(fps, 60);
+			// Icons are looked up when the scene is processed.
+			render_system.ProcessScene(scene, world);
+			render_system.FinishLoading();
+		}
+
+		for (int i = 0; i < 10; ++i) {
+			if (score >= 0) {
+				hud.SetValue(score, 1000000 + i);
+			}
+			render_system.Update(world, 0.0f, 0.0f);
+		}
+
+		vector<double> frame_times;
+		frame_times.reserve(options.frames);
+		unsigned long long draw_calls = 0;
+		unsigned long long quads = 0;
+		unsigned long long allocations_before = g_allocations.load();
+		for (int i = 0; i < options.frames; ++i) {
+			if (score >= 0) {
+				hud.SetValue(score, 1000000 + 7 * i);
+			}
+			clock.Reset();
+			render_system.Update(world, 0.0f, 0.0f);
+			frame_times.push_back(clock.Tick());
+			draw_calls += render_system.stats().draw_calls;
+			quads += render_system.stats().quads;
+		}
+		unsigned long long allocations =
+			g_allocations.load() - allocations_before;
+
+		sort(begin(frame_times), end(frame_times));
+		SDL_Log(
+			"%s: %d frames, render p50 %.3f ms, %.1f draw calls,"
+			" %.1f quads, %.2f allocations per frame\n",
+			pass ? "with hud" : "without hud",
+			options.frames,
+			Percentile(frame_times, 0.50),
+			static_cast<double>(draw_calls) / options.frames,
+			static_cast<double>(quads) / options.frames,
+			static_cast<double>(allocations) / options.frames);
+	}
+	return 0;
+}
+
+// Renders 100k sprites drifting without turning, so their node keeps its
+// spatial grid and rebuilds it every frame, stepping and publishing their
+// bodies as the game does.
+int
+BenchmarkMoving(const Options &options) {
+	const size_t kSprites = 100000;
+	const float kMaxSpeed = 120.0f;
+
+	Scene base;
+	base.LoadFromFile(kBaseScene);
+	string document = GenerateScene(base, kSprites, 0.0f, kMaxSpeed);
+	Scene scene;
+	scene.LoadFromBuffer(document.data(), document.size(), kAssetsPrefix);
+	World world;
+	InstantiateScene(scene, world);
+
+	RenderSystem render_system;
+	InitializeRenderSystem(options, render_system);
+	render_system.ProcessScene(scene, world);
+	render_system.FinishLoading();
+	KinematicsSystem kinematics;
+	kinematics.set_bounds(
+		0.0f,
+		0.0f,
+		static_cast<float>(scene.width()),
+		static_cast<float>(scene.height()));
+
+	SDL_LogSetAllPriority(SDL_LOG_PRIORITY_WARN);
+
+	for (int i = 0; i < 10; ++i) {
+		kinematics.Step(world, kStepSeconds);
+		kinematics.Publish(world, 1.0f);
+		render_system.Update(world, 0.0f, 0.0f);
+	}
+
+	vector<double> frame_times;
+	frame_times.reserve(options.frames);
+	unsigned long long quads = 0;
+	unsigned long long culled = 0;
+	unsigned long long allocations_before = g_allocations.load();
+	FrameClock clock;
+	for (int i = 0; i < options.frames; ++i) {
+		kinematics.Step(world, kStepSeconds);
+		kinematics.Publish(world, 1.0f);
+		clock.Reset();
+		render_system.Update(world, 0.0f, 0.0f);
+		frame_times.push_back(clock.Tick());
+		quads += render_system.stats().quads;
+		culled += render_system.stats().culled;
+	}
+	unsigned long long allocations =
+		g_allocations.load() - allocations_before;
+
+	sort(begin(frame_times), end(frame_times));
+	SDL_Log(
+		"moving: %lu drifting sprites, %d frames, render p50 %.3f ms,"
+		" p99 %.3f ms, %.1f quads, %.1f culled, %.2f allocations"
+		" per frame\n",
+		static_cast<unsigned long>(kSprites),
+		options.frames,
+		Percentile(frame_times, 0.50),
+		Percentile(frame_times, 0.99),
+		static_cast<double>(quads) / options.frames,
+		static_cast<double>(culled) / options.frames,
+		static_cast<double>(allocations) / options.frames);
+	return 0;
+}
+
+// Runs the broadphase over growing numbers of moving colliders at a
+// constant density, so the time per collider should stay flat.
+int
+BenchmarkBroadphase(const Options & /*options*/) {
+	const float kAreaPerCollider = 64.0f * 64.0f;
+	const float kRadius = 12.0f;
+	const size_t counts[] = { 1000, 10000, 100000, 1000000 };
+	for (size_t count: counts) {
+		float side = sqrt(count * kAreaPerCollider);
+		World world;
+		world.bodies().Reserve(count);
+		world.colliders().Reserve(count);
+		mt19937 random(42);
+		uniform_real_distribution<float> pick(0.0f, side);
+		uniform_real_distribution<float> pick_speed(-200.0f, 200.0f);
+		for (size_t i = 0; i < count; ++i) {
+			Entity entity = world.Create();
+			Body body = {
+				pick(random),
+				pick(random),
+				pick_speed(random),
+				pick_speed(random),
+				0.0f,
+				0.0f
+			};
+			world.bodies().Add(entity, body);
+			ColliderComponent collider = { kRadius, kRadius, kRadius };
+			world.colliders().Add(entity, collider);
+		}
+
+		KinematicsSystem kinematics;
+		kinematics.set_bounds(0.0f, 0.0f, side, side);
+		Broadphase broadphase;
+		broadphase.set_bounds(0.0f, 0.0f, side, side);
+
+		vector<double> samples;
+		size_t pairs = 0;
+		for (int run = 0; run < kRuns * 4; ++run) {
+			kinematics.Step(world, kStepSeconds);
+			FrameClock clock;
+			broadphase.Update(world);
+			samples.push_back(clock.Tick());
+			pairs += broadphase.pairs().size();
+		}
+
+		double median = Median(samples);
+		SDL_Log(
+			"broadphase %7lu colliders: %9.3f ms (%6.1f ns/collider),"
+			" %dx%d cells, %.0f pairs\n",
+			static_cast<unsigned long>(count),
+			median,
+			median * 1e6 / count,
+			broadphase.columns(),
+			broadphase.rows(),
+			static_cast<double>(pairs) / samples.size());
+	}
+	return 0;
+}
+
+// Confirms the broadphase pairs of 100k meteor-sized colliders, whose
+// masks are discs inscribed in their square sprites, so the pairs that
+// only touch at the corners are rejected by the circles and most of
+// the rest need a mask test.
+int
+BenchmarkNarrowphase(const Options & /*options*/) {
+	const size_t kColliders = 100000;
+	const int kSize = 96;
+	const float kRadius = kSize * 0.5f;
+	const float kAreaPerCollider = 128.0f * 128.0f;
+
+	CollisionMask disc;
+	disc.Reset(kSize, kSize);
+	for (int y = 0; y < kSize; ++y) {
+		for (int x = 0; x < kSize; ++x) {
+			float dx = x + 0.5f - kRadius;
+			float dy = y + 0.5f - kRadius;
+			if (dx * dx + dy * dy < kRadius * kRadius) {
+				disc.Set(x, y);
+			}
+		}
+	}
+	CollisionMasks masks;
+	masks.SetTexture(0, disc);
+
+	float side = sqrt(kColliders * kAreaPerCollider);
+	World world;
+	world.bodies().Reserve(kColliders);
+	world.sprites().Reserve(kColliders);
+	world.colliders().Reserve(kColliders);
+	mt19937 random(42);
+	uniform_real_distribution<float> pick(0.0f, side);
+	uniform_real_distribution<float> pick_speed(-200.0f, 200.0f);
+	for (size_t i = 0; i < kColliders; ++i) {
+		Entity entity = world.Create();
+		Body body = {
+			pick(random),
+			pick(random),
+			pick_speed(random),
+			pick_speed(random),
+			0.0f,
+			0.0f
+		};
+		world.bodies().Add(entity, body);
+		SpriteComponent sprite = { 0, -1, -1, -1 };
+		world.sprites().Add(entity, sprite);
+		ColliderComponent collider = { kRadius, kRadius, kRadius };
+		world.colliders().Add(entity, collider);
+	}
+
+	KinematicsSystem kinematics;
+	kinematics.set_bounds(0.0f, 0.0f, side, side);
+	Broadphase broadphase;
+	broadphase.set_bounds(0.0f, 0.0f, side, side);
+	Narrowphase narrowphase;
+	narrowphase.set_bounds(0.0f, 0.0f, side, side);
+
+	vector<double> samples;
+	NarrowphaseStats totals;
+	for (int run = 0; run < kRuns * 4; ++run) {
+		kinematics.Step(world, kStepSeconds);
+		broadphase.Update(world);
+		FrameClock clock;
+		narrowphase.Update(world, masks, broadphase.pairs());
+		samples.push_back(clock.Tick());
+
+		const NarrowphaseStats &stats = narrowphase.stats();
+		totals.candidates += stats.candidates;
+		totals.circle_rejects += stats.circle_rejects;
+		totals.mask_tests += stats.mask_tests;
+		totals.mask_hits += stats.mask_hits;
+	}
+
+	double median = Median(samples);
+	double runs = static_cast<double>(samples.size());
+	SDL_Log(
+		"narrowphase %lu colliders: %.3f ms (%.1f ns/candidate),"
+		" %.0f candidates, %.0f circle rejects, %.0f mask tests,"
+		" %.0f contacts\n",
+		static_cast<unsigned long>(kColliders),
+		median,
+		median * 1e6 * runs / max(1u, totals.candidates),
+		totals.candidates / runs,
+		totals.circle_rejects / runs,
+		totals.mask_tests / runs,
+		totals.mask_hits / runs);
+	return 0;
+}
+
+void
+PrintUsage(const char *program) {
+	SDL_Log(
+		"usage: %s [frames|bind|parse|kinematics|animation|broadphase"
+		"|narrowphase|rotation|moving|particles|hud]"
+		" [--scene path]"
+		" [--frames N] [--window]\n",
+		program);
+}
+
+bool
+ParseOptions(int argc, char **argv, Options &options) {
+	int i = 1;
+	if (i < argc && argv[i][0] != '-') {
+		options.mode = argv[i++];
+	}
+
+	for (; i < argc; ++i) {
+		if (0 == strcmp(argv[i], "--scene") && i + 1 < argc) {
+			options.scene = argv[++i];
+		} else if (0 == strcmp(argv[i], "--frames") && i + 1 < argc) {
+			options.frames = max(1, atoi(argv[++i]));
+		} else if (0 == strcmp(argv[i], "--window")) {
+			options.headless = false;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+// Counts heap allocations made through operator new, so the benchmarks can
+// report how many happen per frame.
+void*
+operator new(size_t size) {
+	++g_allocations;
+	void *memory = malloc(size ? size : 1);
+	if (!memory) {
+		throw bad_alloc();
+	}
+	return memory;
+}
+
+void
+operator delete(void *memory) noexcept {
+	free(memory);
+}
+
+int
+main(int argc, char **argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	if (0 == strcmp(options.mode, "frames")) {
+		return BenchmarkFrames(options);
+	} else if (0 == strcmp(options.mode, "bind")) {
+		return BenchmarkBinding(options);
+	} else if (0 == strcmp(options.mode, "parse")) {
+		return BenchmarkParsing(options);
+	} else if (0 == strcmp(options.mode, "kinematics")) {
+		return BenchmarkKinematics(options);
+	} else if (0 == strcmp(options.mode, "animation")) {
+		return BenchmarkAnimation(options);
+	} else if (0 == strcmp(options.mode, "broadphase")) {
+		return BenchmarkBroadphase(options);
+	} else if (0 == strcmp(options.mode, "narrowphase")) {
+		return BenchmarkNarrowphase(options);
+	} else if (0 == strcmp(options.mode, "rotation")) {
+		return BenchmarkRotation(options);
+	} else if (0 == strcmp(options.mode, "moving")) {
+		return BenchmarkMoving(options);
+	} else if (0 == strcmp(options.mode, "particles")) {
+		return BenchmarkParticles(options);
+	} else if (0 == strcmp(options.mode, "hud")) {
+		return BenchmarkHud(options);
+	}
+
+	PrintUsage(argv[0]);
+	return 1;
+}
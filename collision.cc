@@ -0,0 +1,429 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "collision.h"
+#include "collision_mask.h"
+#include "world.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+// Upper bound on cells per collider, so tiny colliders on a large
+// playfield do not make walking the grid cost more than its contents.
+const int kMaxCellsPerCollider = 2;
+
+// Neighbours checked from each cell. Only half of them, so each pair of
+// adjacent cells is visited once.
+const int kForwardNeighbours[][2] = {
+	{ 1, 0 },
+	{ -1, 1 },
+	{ 0, 1 },
+	{ 1, 1 },
+};
+
+// Number of cells of at least min_size that fit in span, at most
+// max_count. Fewer than three are merged into one, since wrapping would
+// make them neighbours twice.
+int
+CellCount(float span, float min_size, int max_count) {
+	if (span <= 0.0f) {
+		return 1;
+	}
+	double count = min_size > 0.0f
+		? floor(static_cast<double>(span) / min_size)
+		: max_count;
+	if (count > max_count) {
+		count = max_count;
+	}
+	return count < 3.0 ? 1 : static_cast<int>(count);
+}
+
+inline int
+CellIndex(float value, float origin, float cell_size, int count) {
+	if (1 == count) {
+		return 0;
+	}
+	int index = static_cast<int>(floor((value - origin) / cell_size));
+	if (index < 0 || index >= count) {
+		// Outside the playfield; wrapped like the bodies would be.
+		index %= count;
+		if (index < 0) {
+			index += count;
+		}
+	}
+	return index;
+}
+
+// Shortest offset from a to b along an axis that wraps every span.
+inline float
+WrappedDelta(float a, float b, float span) {
+	float delta = b - a;
+	if (span > 0.0f) {
+		if (delta > span * 0.5f) {
+			delta -= span;
+		} else if (delta < -span * 0.5f) {
+			delta += span;
+		}
+	}
+	return delta;
+}
+
+// Where the collider of entity is: the top-left corner of its sprite,
+// which bodies are ahead of since published positions are rounded and
+// interpolated for drawing.
+inline bool
+FindOrigin(const World &world, Entity entity, float &x, float &y) {
+	int body = world.bodies().IndexOf(entity);
+	if (body >= 0) {
+		x = world.bodies().bodies().x[body];
+		y = world.bodies().bodies().y[body];
+		return true;
+	}
+	if (auto position = world.positions().Find(entity)) {
+		x = static_cast<float>(position->x);
+		y = static_cast<float>(position->y);
+		return true;
+	}
+	return false;
+}
+
+// Placement of the mask of entity drawn at (x, y). Its transform, which
+// is absent or scales evenly, gives the scale and pivot; bodies spin it
+// by their own rotation, which like their position is ahead of the
+// published one.
+MaskPlacement
+Place(
+		const World &world,
+		Entity entity,
+		const CollisionMask &mask,
+		float x,
+		float y) {
+	MaskPlacement placement = {x, y, 0.0f, 1.0f, 0.0f, 0.0f};
+	const TransformComponent *transform = world.transforms().Find(entity);
+	if (transform) {
+		int body = world.bodies().IndexOf(entity);
+		placement.rotation = body >= 0
+			? world.bodies().bodies().rotation[body]
+			: transform->rotation;
+		placement.scale = transform->scale_x;
+		placement.pivot_x = transform->pivot_x * mask.width();
+		placement.pivot_y = transform->pivot_y * mask.height();
+	}
+	return placement;
+}
+
+inline bool
+IsIdentity(const MaskPlacement &placement) {
+	return 0.0f == placement.rotation && 1.0f == placement.scale;
+}
+
+const CollisionMask*
+FindMask(const World &world, const CollisionMasks &masks, Entity entity) {
+	if (world.texture_repeats().Find(entity)) {
+		return nullptr;
+	}
+	// Masks are of the untransformed sprite, which can only be rotated
+	// and scaled evenly to test against another.
+	const TransformComponent *transform = world.transforms().Find(entity);
+	if (transform && transform->scale_x != transform->scale_y) {
+		return nullptr;
+	}
+	const SpriteComponent *sprite = world.sprites().Find(entity);
+	if (!sprite) {
+		return nullptr;
+	}
+	if (sprite->composite_index >= 0) {
+		return masks.FindComposite(sprite->composite_index);
+	}
+	int animation = world.animations().IndexOf(entity);
+	return masks.Find(
+		sprite->texture_index,
+		sprite->spritesheet_index,
+		animation >= 0
+			? world.animations().animations().region[animation]
+			: sprite->region_index);
+}
+
+} // namespace
+
+Broadphase::Broadphase()
+	: left_(0.0f)
+	, top_(0.0f)
+	, width_(0.0f)
+	, height_(0.0f)
+	, columns_(1)
+	, rows_(1)
+	, cell_width_(0.0f)
+	, cell_height_(0.0f) {}
+
+void Broadphase::set_bounds(
+		float left,
+		float top,
+		float right,
+		float bottom) {
+	left_ = left;
+	top_ = top;
+	width_ = max(0.0f, right - left);
+	height_ = max(0.0f, bottom - top);
+}
+
+void Broadphase::Update(const World &world) {
+	Gather(world);
+	LayOutGrid();
+	SortIntoCells();
+	FindPairs();
+}
+
+void Broadphase::Gather(const World &world) {
+	entities_.clear();
+	x_.clear();
+	y_.clear();
+	radius_.clear();
+
+	const auto &colliders = world.colliders();
+	for (size_t i = 0; i < colliders.size(); ++i) {
+		Entity entity = colliders.entities()[i];
+		const ColliderComponent &collider = colliders.components()[i];
+
+		float x;
+		float y;
+		if (!FindOrigin(world, entity, x, y)) {
+			continue;
+		}
+
+		entities_.push_back(entity);
+		x_.push_back(x + collider.offset_x);
+		y_.push_back(y + collider.offset_y);
+		radius_.push_back(collider.radius);
+	}
+}
+
+void Broadphase::LayOutGrid() {
+	float max_radius = 0.0f;
+	for (float radius: radius_) {
+		max_radius = max(max_radius, radius);
+	}
+
+	// Split the cell budget between the axes in proportion to the
+	// playfield, then fit cells at least one collider wide.
+	double max_cells = static_cast<double>(kMaxCellsPerCollider)
+		* max<size_t>(1, entities_.size());
+	double aspect = width_ > 0.0f && height_ > 0.0f
+		? static_cast<double>(width_) / height_
+		: 1.0;
+	int max_columns = static_cast<int>(
+		max(1.0, sqrt(max_cells * aspect)));
+	int max_rows = static_cast<int>(
+		max(1.0, sqrt(max_cells / aspect)));
+	columns_ = CellCount(width_, max_radius * 2.0f, max_columns);
+	rows_ = CellCount(height_, max_radius * 2.0f, max_rows);
+	cell_width_ = width_ / columns_;
+	cell_height_ = height_ / rows_;
+}
+
+void Broadphase::SortIntoCells() {
+	const size_t count = entities_.size();
+	const int cell_count = columns_ * rows_;
+
+	cells_.resize(count);
+	cell_start_.assign(cell_count + 1, 0);
+	for (size_t i = 0; i < count; ++i) {
+		int cell = CellIndex(y_[i], top_, cell_height_, rows_) * columns_
+			+ CellIndex(x_[i], left_, cell_width_, columns_);
+		cells_[i] = cell;
+		++cell_start_[cell + 1];
+	}
+
+	for (int i = 0; i < cell_count; ++i) {
+		cell_start_[i + 1] += cell_start_[i];
+	}
+
+	// Scatter using the starts as write cursors, then shift them back.
+	sorted_entities_.resize(count);
+	sorted_x_.resize(count);
+	sorted_y_.resize(count);
+	sorted_radius_.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		int slot = cell_start_[cells_[i]]++;
+		sorted_entities_[slot] = entities_[i];
+		sorted_x_[slot] = x_[i];
+		sorted_y_[slot] = y_[i];
+		sorted_radius_[slot] = radius_[i];
+	}
+	for (int i = cell_count; i > 0; --i) {
+		cell_start_[i] = cell_start_[i - 1];
+	}
+	cell_start_[0] = 0;
+}
+
+void Broadphase::FindPairs() {
+	pairs_.clear();
+	for (int row = 0; row < rows_; ++row) {
+		for (int column = 0; column < columns_; ++column) {
+			int cell = row * columns_ + column;
+			int begin = cell_start_[cell];
+			int end = cell_start_[cell + 1];
+			if (begin == end) {
+				continue;
+			}
+
+			for (int a = begin; a < end; ++a) {
+				for (int b = a + 1; b < end; ++b) {
+					TestPair(a, b);
+				}
+			}
+
+			for (const auto &offset: kForwardNeighbours) {
+				if ((1 == columns_ && offset[0])
+						|| (1 == rows_ && offset[1])) {
+					continue;
+				}
+
+				int neighbour_column = column + offset[0];
+				if (neighbour_column < 0) {
+					neighbour_column += columns_;
+				} else if (neighbour_column >= columns_) {
+					neighbour_column -= columns_;
+				}
+				int neighbour_row = row + offset[1];
+				if (neighbour_row >= rows_) {
+					neighbour_row -= rows_;
+				}
+				int neighbour = neighbour_row * columns_ + neighbour_column;
+				for (int a = begin; a < end; ++a) {
+					for (int b = cell_start_[neighbour];
+							b < cell_start_[neighbour + 1];
+							++b) {
+						TestPair(a, b);
+					}
+				}
+			}
+		}
+	}
+}
+
+void Broadphase::TestPair(int first, int second) {
+	float reach = sorted_radius_[first] + sorted_radius_[second];
+	float dx = WrappedDelta(sorted_x_[first], sorted_x_[second], width_);
+	float dy = WrappedDelta(sorted_y_[first], sorted_y_[second], height_);
+	if (fabs(dx) < reach && fabs(dy) < reach) {
+		CollisionPair pair = {
+			sorted_entities_[first],
+			sorted_entities_[second]
+		};
+		pairs_.push_back(pair);
+	}
+}
+
+Narrowphase::Narrowphase() : width_(0.0f), height_(0.0f) {}
+
+void Narrowphase::set_bounds(
+		float left,
+		float top,
+		float right,
+		float bottom) {
+	width_ = max(0.0f, right - left);
+	height_ = max(0.0f, bottom - top);
+}
+
+void Narrowphase::Update(
+		const World &world,
+		const CollisionMasks &masks,
+		const vector<CollisionPair> &candidates) {
+	contacts_.clear();
+	stats_ = NarrowphaseStats();
+	stats_.candidates = static_cast<unsigned int>(candidates.size());
+	for (const auto &pair: candidates) {
+		if (TestPair(world, masks, pair)) {
+			contacts_.push_back(pair);
+		}
+	}
+}
+
+bool Narrowphase::TestPair(
+		const World &world,
+		const CollisionMasks &masks,
+		const CollisionPair &pair) {
+	const ColliderComponent *first = world.colliders().Find(pair.first);
+	const ColliderComponent *second = world.colliders().Find(pair.second);
+	float first_x;
+	float first_y;
+	float second_x;
+	float second_y;
+	if (!first || !second
+			|| !FindOrigin(world, pair.first, first_x, first_y)
+			|| !FindOrigin(world, pair.second, second_x, second_y)) {
+		return false;
+	}
+
+	// Offset between the sprites, the short way around the playfield.
+	float dx = WrappedDelta(first_x, second_x, width_);
+	float dy = WrappedDelta(first_y, second_y, height_);
+
+	float centre_dx = dx + second->offset_x - first->offset_x;
+	float centre_dy = dy + second->offset_y - first->offset_y;
+	float reach = first->radius + second->radius;
+	if (centre_dx * centre_dx + centre_dy * centre_dy >= reach * reach) {
+		++stats_.circle_rejects;
+		return false;
+	}
+
+	const CollisionMask *first_mask = FindMask(world, masks, pair.first);
+	const CollisionMask *second_mask = FindMask(world, masks, pair.second);
+	if (!first_mask || !second_mask) {
+		return true;
+	}
+
+	// Sprites are drawn at whole pixels.
+	++stats_.mask_tests;
+	float offset_x = floor(dx + 0.5f);
+	float offset_y = floor(dy + 0.5f);
+	MaskPlacement first_placement =
+		Place(world, pair.first, *first_mask, 0.0f, 0.0f);
+	MaskPlacement second_placement =
+		Place(world, pair.second, *second_mask, offset_x, offset_y);
+	bool hit;
+	if (IsIdentity(first_placement) && IsIdentity(second_placement)) {
+		hit = MasksOverlap(
+			*first_mask,
+			*second_mask,
+			static_cast<int>(offset_x),
+			static_cast<int>(offset_y));
+	} else {
+		hit = TransformedMasksOverlap(
+			*first_mask,
+			first_placement,
+			*second_mask,
+			second_placement);
+	}
+	if (hit) {
+		++stats_.mask_hits;
+	}
+	return hit;
+}
+
+} // namespace foo
@@ -0,0 +1,168 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_COLLISION_H_
+#define FOO_ASTEROIDS_COLLISION_H_
+
+#include "component_pool.h"
+#include <vector>
+
+namespace foo {
+
+class World;
+class CollisionMasks;
+
+struct CollisionPair {
+	Entity first;
+	Entity second;
+};
+
+// Finds colliders that may touch, for a narrow phase to confirm. The
+// playfield is covered by a uniform grid that wraps around like the
+// bodies do, and is rebuilt from scratch every tick: colliders are
+// bucketed by the cell of their centre with a counting sort. Cells are at
+// least as wide as the largest collider, so overlapping colliders are
+// always in the same or adjacent cells and the cost stays linear in the
+// number of colliders.
+class Broadphase {
+	float left_;
+	float top_;
+	float width_;
+	float height_;
+	int columns_;
+	int rows_;
+	float cell_width_;
+	float cell_height_;
+	// Colliders of the current tick, with their centres and radii, in
+	// the order they were gathered and then sorted by cell. Colliders of
+	// cell i are [cell_start_[i], cell_start_[i + 1]) of the sorted
+	// arrays, so testing a cell against its neighbours reads memory in
+	// order.
+	std::vector<Entity> entities_;
+	std::vector<float> x_;
+	std::vector<float> y_;
+	std::vector<float> radius_;
+	std::vector<int> cells_;
+	std::vector<int> cell_start_;
+	std::vector<Entity> sorted_entities_;
+	std::vector<float> sorted_x_;
+	std::vector<float> sorted_y_;
+	std::vector<float> sorted_radius_;
+	std::vector<CollisionPair> pairs_;
+
+public:
+	Broadphase();
+
+	// The playfield, which should match KinematicsSystem::set_bounds().
+	// Without bounds every collider is tested against every other.
+	void
+	set_bounds(float left, float top, float right, float bottom);
+
+	// Rebuilds the grid from the colliders of world at their current
+	// positions and collects the pairs whose bounding boxes overlap.
+	void
+	Update(const World &world);
+
+	// Pairs found by the last Update(), each reported once.
+	inline const std::vector<CollisionPair>&
+	pairs() const { return pairs_; }
+
+	inline int
+	columns() const { return columns_; }
+
+	inline int
+	rows() const { return rows_; }
+
+private:
+	void
+	Gather(const World &world);
+
+	void
+	LayOutGrid();
+
+	void
+	SortIntoCells();
+
+	void
+	FindPairs();
+
+	void
+	TestPair(int first, int second);
+};
+
+struct NarrowphaseStats {
+	unsigned int candidates;
+	// Pairs rejected because their circles do not touch.
+	unsigned int circle_rejects;
+	// Pairs whose masks were compared, and how many of them overlapped.
+	unsigned int mask_tests;
+	unsigned int mask_hits;
+
+	NarrowphaseStats()
+		: candidates(0)
+		, circle_rejects(0)
+		, mask_tests(0)
+		, mask_hits(0) {}
+};
+
+// Confirms the pairs found by Broadphase. Bounding circles are tested
+// first; pairs that pass are tested pixel by pixel against the collision
+// masks of their sprites, 64 pixels per AND, or one pixel at a time when
+// either is rotated or scaled. Sprites whose mask is not known yet, and
+// repeated or unevenly scaled sprites, collide by their circles alone.
+class Narrowphase {
+	float width_;
+	float height_;
+	std::vector<CollisionPair> contacts_;
+	NarrowphaseStats stats_;
+
+public:
+	Narrowphase();
+
+	// The playfield, which should match Broadphase::set_bounds().
+	void
+	set_bounds(float left, float top, float right, float bottom);
+
+	void
+	Update(
+		const World &world,
+		const CollisionMasks &masks,
+		const std::vector<CollisionPair> &candidates);
+
+	// Pairs that touch, in the order of the candidates.
+	inline const std::vector<CollisionPair>&
+	contacts() const { return contacts_; }
+
+	inline const NarrowphaseStats&
+	stats() const { return stats_; }
+
+private:
+	bool
+	TestPair(
+		const World &world,
+		const CollisionMasks &masks,
+		const CollisionPair &pair);
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_COLLISION_H_
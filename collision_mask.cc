@@ -0,0 +1,340 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "collision_mask.h"
+#include "smart_pointers.h"
+#include "SDL.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+// Alpha at or above which a pixel is solid.
+const Uint32 kSolidAlpha = 128;
+
+// Bits [bit, bit + 64) of a row of words, which may start before or run
+// past the end of the row; missing bits are clear.
+inline uint64_t
+LoadBits(const uint64_t *row, int words, int bit) {
+	int word = bit >= 0 ? bit / 64 : -((63 - bit) / 64);
+	int shift = bit - word * 64;
+	uint64_t low = word >= 0 && word < words ? row[word] : 0;
+	if (0 == shift) {
+		return low;
+	}
+	uint64_t high = word + 1 >= 0 && word + 1 < words ? row[word + 1] : 0;
+	return (low >> shift) | (high << (64 - shift));
+}
+
+void
+MarkSolidPixels(SDL_Surface *surface, CollisionMask &mask) {
+	const SDL_PixelFormat *format = surface->format;
+	for (int y = 0; y < surface->h; ++y) {
+		const Uint32 *pixels = reinterpret_cast<const Uint32*>(
+			static_cast<const Uint8*>(surface->pixels)
+			+ y * surface->pitch);
+		for (int x = 0; x < surface->w; ++x) {
+			if (((pixels[x] & format->Amask) >> format->Ashift)
+					>= kSolidAlpha) {
+				mask.Set(x, y);
+			}
+		}
+	}
+}
+
+} // namespace
+
+CollisionMask::CollisionMask()
+	: width_(0)
+	, height_(0)
+	, words_per_row_(0) {}
+
+void CollisionMask::Reset(int width, int height) {
+	width_ = max(0, width);
+	height_ = max(0, height);
+	words_per_row_ = (width_ + 63) / 64;
+	bits_.assign(static_cast<size_t>(words_per_row_) * height_, 0);
+}
+
+CollisionMask CollisionMask::Cut(int x, int y, int w, int h) const {
+	CollisionMask result;
+	result.Reset(w, h);
+	if (result.words_per_row_ == 0) {
+		return result;
+	}
+
+	// Bits past w in the last word of each row must stay clear.
+	uint64_t last_word_mask = (w & 63)
+		? (uint64_t(1) << (w & 63)) - 1
+		: ~uint64_t(0);
+	for (int row_index = 0; row_index < result.height_; ++row_index) {
+		int source_row = y + row_index;
+		if (source_row < 0 || source_row >= height_) {
+			continue;
+		}
+		uint64_t *out = &result.bits_[row_index * result.words_per_row_];
+		for (int word = 0; word < result.words_per_row_; ++word) {
+			out[word] = LoadBits(
+				row(source_row), words_per_row_, x + word * 64);
+		}
+		out[result.words_per_row_ - 1] &= last_word_mask;
+	}
+	return result;
+}
+
+void CollisionMask::Paste(
+		const CollisionMask &source,
+		int x,
+		int y,
+		bool flip) {
+	for (int source_y = 0; source_y < source.height_; ++source_y) {
+		int out_y = y + source_y;
+		if (out_y < 0 || out_y >= height_) {
+			continue;
+		}
+		for (int source_x = 0; source_x < source.width_; ++source_x) {
+			int out_x = x + (flip
+				? source.width_ - 1 - source_x
+				: source_x);
+			if (out_x >= 0 && out_x < width_
+					&& source.Get(source_x, source_y)) {
+				Set(out_x, out_y);
+			}
+		}
+	}
+}
+
+bool
+ExtractCollisionMask(SDL_Surface *surface, CollisionMask &mask) {
+	mask.Reset(0, 0);
+	if (!surface) {
+		return false;
+	}
+
+	if (0 == surface->format->Amask || 4 != surface->format->BytesPerPixel) {
+		// Colour keys and palettes with transparent entries become an
+		// alpha channel when converted; anything else is opaque.
+		SurfacePtr converted(SDL_ConvertSurfaceFormat(
+			surface, SDL_PIXELFORMAT_ARGB8888, 0));
+		if (!converted) {
+			return false;
+		}
+		return ExtractCollisionMask(converted.get(), mask);
+	}
+
+	if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) != 0) {
+		return false;
+	}
+	mask.Reset(surface->w, surface->h);
+	MarkSolidPixels(surface, mask);
+	if (SDL_MUSTLOCK(surface)) {
+		SDL_UnlockSurface(surface);
+	}
+	return true;
+}
+
+bool
+MasksOverlap(
+		const CollisionMask &a,
+		const CollisionMask &b,
+		int offset_x,
+		int offset_y) {
+	int top = max(0, offset_y);
+	int bottom = min(a.height(), offset_y + b.height());
+	int left = max(0, offset_x);
+	int right = min(a.width(), offset_x + b.width());
+	if (left >= right || top >= bottom) {
+		return false;
+	}
+
+	// Bits of a outside [left, right) meet clear bits of b: either they
+	// are before its first pixel, past its padded row, or a's padding.
+	int first_word = left / 64;
+	int last_word = (right - 1) / 64;
+	for (int y = top; y < bottom; ++y) {
+		const uint64_t *a_row = a.row(y);
+		const uint64_t *b_row = b.row(y - offset_y);
+		for (int word = first_word; word <= last_word; ++word) {
+			uint64_t b_bits = LoadBits(
+				b_row, b.words_per_row(), word * 64 - offset_x);
+			if (a_row[word] & b_bits) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool
+TransformedMasksOverlap(
+		const CollisionMask &a,
+		const MaskPlacement &a_placement,
+		const CollisionMask &b,
+		const MaskPlacement &b_placement) {
+	// Sample the mask with the smaller pixels, so none of the other's are
+	// stepped over.
+	if (fabs(b_placement.scale) < fabs(a_placement.scale)) {
+		return TransformedMasksOverlap(b, b_placement, a, a_placement);
+	}
+	if (0.0f == a_placement.scale || 0.0f == b_placement.scale) {
+		return false;
+	}
+
+	// A point p of a lands on b at q = m (p - pivot of a) + t, where m is
+	// the relative rotation of the two scaled by the ratio of the scales,
+	// and t brings the pivot of a, rotated back by b, into b.
+	const float kRadiansPerDegree = 3.14159265f / 180.0f;
+	float ratio = a_placement.scale / b_placement.scale;
+	float angle =
+		(a_placement.rotation - b_placement.rotation) * kRadiansPerDegree;
+	float m_cos = cos(angle) * ratio;
+	float m_sin = sin(angle) * ratio;
+	float b_angle = b_placement.rotation * kRadiansPerDegree;
+	float b_cos = cos(b_angle);
+	float b_sin = sin(b_angle);
+	float dx = a_placement.x + a_placement.pivot_x
+		- b_placement.x - b_placement.pivot_x;
+	float dy = a_placement.y + a_placement.pivot_y
+		- b_placement.y - b_placement.pivot_y;
+	float origin_x = b_placement.pivot_x
+		+ (b_cos * dx + b_sin * dy) / b_placement.scale
+		- m_cos * a_placement.pivot_x + m_sin * a_placement.pivot_y;
+	float origin_y = b_placement.pivot_y
+		+ (b_cos * dy - b_sin * dx) / b_placement.scale
+		- m_sin * a_placement.pivot_x - m_cos * a_placement.pivot_y;
+
+	float b_width = static_cast<float>(b.width());
+	float b_height = static_cast<float>(b.height());
+	for (int y = 0; y < a.height(); ++y) {
+		// Pixel centres u + 0.5 of this row land at row_x + m_cos u,
+		// row_y + m_sin u; keep the span of u where both are inside b.
+		float v = y + 0.5f;
+		float row_x = origin_x - m_sin * v + 0.5f * m_cos;
+		float row_y = origin_y + m_cos * v + 0.5f * m_sin;
+		float low = 0.0f;
+		float high = static_cast<float>(a.width() - 1);
+		const float axes[2][3] = {
+			{row_x, m_cos, b_width},
+			{row_y, m_sin, b_height},
+		};
+		for (const auto &axis: axes) {
+			if (0.0f == axis[1]) {
+				if (axis[0] < 0.0f || axis[0] >= axis[2]) {
+					high = -1.0f;
+				}
+				continue;
+			}
+			float enter = -axis[0] / axis[1];
+			float leave = (axis[2] - axis[0]) / axis[1];
+			low = max(low, min(enter, leave));
+			high = min(high, max(enter, leave));
+		}
+		if (low > high) {
+			continue;
+		}
+
+		const uint64_t *a_row = a.row(y);
+		int last = static_cast<int>(floor(high));
+		for (int x = static_cast<int>(ceil(low)); x <= last; ++x) {
+			if (0 == (a_row[x >> 6] >> (x & 63) & 1)) {
+				continue;
+			}
+			// The span is computed in floats; its ends may stray by a
+			// rounding error.
+			int b_x = static_cast<int>(floor(row_x + m_cos * x));
+			int b_y = static_cast<int>(floor(row_y + m_sin * x));
+			if (b_x >= 0 && b_x < b.width() && b_y >= 0 && b_y < b.height()
+					&& b.Get(b_x, b_y)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void CollisionMasks::Clear() {
+	textures_.clear();
+	spritesheets_.clear();
+	composites_.clear();
+}
+
+void CollisionMasks::SetTexture(int texture_index, CollisionMask mask) {
+	if (texture_index >= static_cast<int>(textures_.size())) {
+		textures_.resize(texture_index + 1);
+	}
+	textures_[texture_index] = move(mask);
+}
+
+void CollisionMasks::SetSpritesheet(
+		int spritesheet_index,
+		vector<CollisionMask> regions) {
+	if (spritesheet_index >= static_cast<int>(spritesheets_.size())) {
+		spritesheets_.resize(spritesheet_index + 1);
+	}
+	spritesheets_[spritesheet_index] = move(regions);
+}
+
+const CollisionMask* CollisionMasks::Find(
+		int texture_index,
+		int spritesheet_index,
+		int region_index) const {
+	const CollisionMask *mask = nullptr;
+	if (texture_index >= 0) {
+		if (texture_index < static_cast<int>(textures_.size())) {
+			mask = &textures_[texture_index];
+		}
+	} else if (spritesheet_index >= 0
+			&& spritesheet_index < static_cast<int>(spritesheets_.size())) {
+		const auto &regions = spritesheets_[spritesheet_index];
+		if (region_index >= 0
+				&& region_index < static_cast<int>(regions.size())) {
+			mask = &regions[region_index];
+		}
+	}
+	return mask && !mask->empty() ? mask : nullptr;
+}
+
+void CollisionMasks::SetComposite(
+		int composite_index,
+		CollisionMask mask) {
+	if (composite_index >= static_cast<int>(composites_.size())) {
+		composites_.resize(composite_index + 1);
+	}
+	composites_[composite_index] = move(mask);
+}
+
+const CollisionMask* CollisionMasks::FindComposite(
+		int composite_index) const {
+	if (composite_index < 0
+			|| composite_index >= static_cast<int>(composites_.size())
+			|| composites_[composite_index].empty()) {
+		return nullptr;
+	}
+	return &composites_[composite_index];
+}
+
+} // namespace foo
@@ -0,0 +1,162 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_COLLISION_MASK_H_
+#define FOO_ASTEROIDS_COLLISION_MASK_H_
+
+#include <vector>
+#include <cstdint>
+
+struct SDL_Surface;
+
+namespace foo {
+
+// One bit per pixel, set where the image is opaque enough to collide.
+// Rows are padded to whole 64-bit words with clear bits; bit i of word w
+// of a row is pixel w * 64 + i.
+class CollisionMask {
+	int width_;
+	int height_;
+	int words_per_row_;
+	std::vector<uint64_t> bits_;
+
+public:
+	CollisionMask();
+
+	// Clears the mask and resizes it to width by height pixels.
+	void
+	Reset(int width, int height);
+
+	inline void
+	Set(int x, int y) {
+		bits_[y * words_per_row_ + (x >> 6)] |= uint64_t(1) << (x & 63);
+	}
+
+	inline bool
+	Get(int x, int y) const {
+		return 0 != (bits_[y * words_per_row_ + (x >> 6)]
+			& (uint64_t(1) << (x & 63)));
+	}
+
+	inline const uint64_t*
+	row(int y) const { return &bits_[y * words_per_row_]; }
+
+	inline int
+	width() const { return width_; }
+
+	inline int
+	height() const { return height_; }
+
+	inline int
+	words_per_row() const { return words_per_row_; }
+
+	inline bool
+	empty() const { return bits_.empty(); }
+
+	// Copies the w by h pixels at (x, y). Pixels outside this mask are
+	// clear in the result.
+	CollisionMask
+	Cut(int x, int y, int w, int h) const;
+
+	// Adds the solid pixels of source with its top-left corner at (x, y),
+	// mirrored horizontally if flip is set. Pixels falling outside this
+	// mask are dropped.
+	void
+	Paste(const CollisionMask &source, int x, int y, bool flip);
+};
+
+// Marks the pixels of surface whose alpha is at least half. Surfaces that
+// are not 32-bit with an alpha channel are converted first; without any
+// alpha every pixel is solid. Returns false if the surface could not be
+// read, leaving mask empty.
+bool
+ExtractCollisionMask(SDL_Surface *surface, CollisionMask &mask);
+
+// True if a solid pixel of a overlaps a solid pixel of b, with the top
+// left corner of b at (offset_x, offset_y) relative to that of a. Only the
+// rows and words where both masks overlap are tested, 64 pixels at a time.
+bool
+MasksOverlap(
+	const CollisionMask &a,
+	const CollisionMask &b,
+	int offset_x,
+	int offset_y);
+
+// Where a mask is drawn: its untransformed top-left corner at (x, y),
+// rotated by rotation degrees clockwise and scaled by scale about the
+// point (pivot_x, pivot_y) pixels from that corner.
+struct MaskPlacement {
+	float x;
+	float y;
+	float rotation;
+	float scale;
+	float pivot_x;
+	float pivot_y;
+};
+
+// Like MasksOverlap, for masks that may be rotated or uniformly scaled.
+// The centres of the solid pixels of the mask drawn at the finer scale
+// are mapped into the other mask, clipped row by row to its bounds.
+bool
+TransformedMasksOverlap(
+	const CollisionMask &a,
+	const MaskPlacement &a_placement,
+	const CollisionMask &b,
+	const MaskPlacement &b_placement);
+
+// Masks for the images of a scene, indexed like Scene::textures(),
+// Scene::composites() and by region within Scene::spritesheets(). Filled
+// by the render system as the images are decoded; lookups fail until
+// then.
+class CollisionMasks {
+	std::vector<CollisionMask> textures_;
+	std::vector<std::vector<CollisionMask>> spritesheets_;
+	std::vector<CollisionMask> composites_;
+
+public:
+	void
+	Clear();
+
+	void
+	SetTexture(int texture_index, CollisionMask mask);
+
+	void
+	SetSpritesheet(
+		int spritesheet_index,
+		std::vector<CollisionMask> regions);
+
+	// Returns the mask of a texture, or of a spritesheet region if
+	// texture_index is negative; null if it is not known yet.
+	const CollisionMask*
+	Find(int texture_index, int spritesheet_index, int region_index) const;
+
+	void
+	SetComposite(int composite_index, CollisionMask mask);
+
+	// Null until the masks of every part are known.
+	const CollisionMask*
+	FindComposite(int composite_index) const;
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_COLLISION_MASK_H_
@@ -0,0 +1,578 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "compiled_scene.h"
+#include "scene.h"
+#include "file_stamp.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "SDL_log.h"
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+const size_t kTableAlignment = 8;
+
+class StringTableBuilder {
+	vector<char> chars_;
+	unordered_map<string, CompiledString> interned_;
+
+public:
+	CompiledString
+	Add(const StringRef &ref) {
+		string value = ref.str();
+		auto iter = interned_.find(value);
+		if (iter != end(interned_)) {
+			return iter->second;
+		}
+
+		CompiledString result;
+		result.offset = static_cast<uint32_t>(chars_.size());
+		result.length = static_cast<uint32_t>(value.size());
+		chars_.insert(end(chars_), begin(value), end(value));
+		chars_.push_back('\0');
+		interned_.emplace(value, result);
+		return result;
+	}
+
+	inline const vector<char>&
+	chars() const { return chars_; }
+};
+
+// Scene paths are stored with the scene directory prepended; compiled
+// scenes keep them relative so the output can be moved with its assets.
+string
+RelativePath(const StringRef &path, const string &prefix) {
+	if (!prefix.empty()
+			&& path.size() >= prefix.size()
+			&& 0 == memcmp(path.data(), prefix.data(), prefix.size())) {
+		return string(
+			path.data() + prefix.size(), path.size() - prefix.size());
+	}
+	return path.str();
+}
+
+template <typename T>
+CompiledTable
+AppendTable(vector<char> &out, const vector<T> &records) {
+	while (out.size() % kTableAlignment) {
+		out.push_back('\0');
+	}
+
+	CompiledTable table;
+	table.offset = static_cast<uint32_t>(out.size());
+	table.count = static_cast<uint32_t>(records.size());
+	const char *raw = reinterpret_cast<const char*>(records.data());
+	out.insert(end(out), raw, raw + records.size() * sizeof(T));
+	return table;
+}
+
+template <typename T>
+bool
+IsTableInBounds(const CompiledTable &table, size_t file_size) {
+	return table.offset % kTableAlignment == 0
+		&& table.offset <= file_size
+		&& table.count <= (file_size - table.offset) / sizeof(T);
+}
+
+inline bool
+IsStringInBounds(const CompiledString &value, uint32_t table_size) {
+	return value.offset < table_size
+		&& value.length < table_size - value.offset;
+}
+
+inline bool
+IsIndexValid(int32_t index, uint32_t count) {
+	return index >= -1 && index < static_cast<int64_t>(count);
+}
+
+// True if the frame_count frames from first_frame are in the frames table
+// and are regions of the spritesheet at spritesheet_index, which must be
+// resolved unless there are none.
+bool
+AreFramesValid(
+		const MappedFile &file,
+		const CompiledSceneHeader &header,
+		const CompiledSpritesheet *sheets,
+		int32_t spritesheet_index,
+		uint32_t first_frame,
+		uint32_t frame_count) {
+	if (first_frame > header.frames.count
+			|| frame_count > header.frames.count - first_frame) {
+		return false;
+	}
+	if (0 == frame_count) {
+		return true;
+	}
+	if (spritesheet_index < 0) {
+		return false;
+	}
+	auto frames = CompiledRecords<int32_t>(file, header.frames);
+	uint32_t region_count = sheets[spritesheet_index].region_count;
+	for (uint32_t i = 0; i < frame_count; ++i) {
+		int32_t region = frames[first_frame + i];
+		if (region < 0 || static_cast<uint32_t>(region) >= region_count) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+void
+WriteCompiledScene(
+		const Scene &scene,
+		const char *scene_file_name,
+		const char *out_file_name) {
+	string prefix = ScenePathPrefix(scene_file_name);
+	StringTableBuilder strings;
+
+	CompiledSceneHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kCompiledSceneMagic;
+	header.version = kCompiledSceneVersion;
+	header.width = scene.width();
+	header.height = scene.height();
+	header.id = strings.Add(scene.id());
+	header.title = strings.Add(scene.title());
+
+	vector<string> source_paths;
+	source_paths.emplace_back(scene_file_name);
+	for (const auto &sheet: scene.spritesheets()) {
+		source_paths.emplace_back(sheet.path.str());
+	}
+
+	vector<CompiledSource> sources;
+	for (const auto &path: source_paths) {
+		FileStamp stamp = StampFile(path);
+		if (stamp.size < 0) {
+			SDL_LogError(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"Failed to stamp scene source %s\n",
+				path.c_str());
+			throw runtime_error("Failed to stamp scene source");
+		}
+
+		CompiledSource source;
+		memset(&source, 0, sizeof(source));
+		source.path = strings.Add(RelativePath(path, prefix));
+		source.modified = stamp.modified;
+		source.size = stamp.size;
+		source.hash = stamp.hash;
+		sources.push_back(source);
+	}
+
+	vector<CompiledTexture> textures;
+	for (const auto &texture: scene.textures()) {
+		CompiledTexture record;
+		record.id = strings.Add(AtomName(texture.id));
+		record.path = strings.Add(RelativePath(texture.path, prefix));
+		textures.push_back(record);
+	}
+
+	vector<CompiledSpritesheet> spritesheets;
+	vector<CompiledRegion> regions;
+	for (const auto &sheet: scene.spritesheets()) {
+		CompiledSpritesheet record;
+		record.id = strings.Add(AtomName(sheet.id));
+		record.path = strings.Add(RelativePath(sheet.path, prefix));
+		record.image_path = strings.Add(
+			RelativePath(sheet.image_path, prefix));
+		record.first_region = static_cast<uint32_t>(regions.size());
+		record.region_count = static_cast<uint32_t>(sheet.regions.size());
+		spritesheets.push_back(record);
+
+		for (const auto &region: sheet.regions) {
+			CompiledRegion region_record;
+			region_record.name = strings.Add(AtomName(region.name));
+			region_record.x = region.x;
+			region_record.y = region.y;
+			region_record.width = region.width;
+			region_record.height = region.height;
+			regions.push_back(region_record);
+		}
+	}
+
+	vector<CompiledObject> objects;
+	vector<int32_t> frames;
+	// Objects sharing a sequence share their frames in the scene too.
+	unordered_map<const int*, uint32_t> first_frames;
+	auto add_frames = [&](const int *object_frames, int count) {
+		if (!object_frames) {
+			return 0u;
+		}
+		auto iter = first_frames.find(object_frames);
+		if (iter == end(first_frames)) {
+			iter = first_frames.emplace(
+				object_frames,
+				static_cast<uint32_t>(frames.size())).first;
+			frames.insert(
+				end(frames), object_frames, object_frames + count);
+		}
+		return iter->second;
+	};
+	vector<CompiledCompositePart> composite_parts;
+	for (const auto &object: scene.objects()) {
+		CompiledObject record;
+		memset(&record, 0, sizeof(record));
+		record.id = strings.Add(AtomName(object.id));
+		record.x = object.x;
+		record.y = object.y;
+		record.texture_index = -1;
+		record.spritesheet_index = -1;
+		record.region_index = -1;
+		if (object.texture) {
+			record.flags |= kCompiledObjectTexture;
+			record.texture_id = strings.Add(
+				AtomName(object.texture->texture_id));
+			record.region_id = strings.Add(
+				AtomName(object.texture->region_id));
+			record.texture_index = object.texture->texture_index;
+			record.spritesheet_index = object.texture->spritesheet_index;
+			record.region_index = object.texture->region_index;
+		}
+		if (object.texture_repeat) {
+			record.flags |= kCompiledObjectTextureRepeat;
+			record.repeat_x = object.texture_repeat->repeat_x;
+			record.repeat_y = object.texture_repeat->repeat_y;
+		}
+		if (object.velocity) {
+			record.flags |= kCompiledObjectVelocity;
+			record.velocity_x = object.velocity->x;
+			record.velocity_y = object.velocity->y;
+			record.angular_velocity = object.velocity->angular;
+		}
+		if (object.collider) {
+			record.flags |= kCompiledObjectCollider;
+			record.collider_radius = object.collider->radius;
+		}
+		if (object.animation) {
+			const SceneComponentAnimation &animation = *object.animation;
+			record.flags |= kCompiledObjectAnimation;
+			if (animation.loop) {
+				record.flags |= kCompiledObjectAnimationLoop;
+			}
+			record.animation_sequence = strings.Add(
+				AtomName(animation.sequence));
+			record.animation_fps = animation.fps;
+			record.animation_first_frame = add_frames(
+				animation.frames, animation.frame_count);
+			record.animation_frame_count =
+				static_cast<uint32_t>(animation.frame_count);
+		}
+		if (object.composite) {
+			record.flags |= kCompiledObjectComposite;
+			record.composite_first_part =
+				static_cast<uint32_t>(composite_parts.size());
+			record.composite_part_count =
+				static_cast<uint32_t>(object.composite->part_count);
+			for (int i = 0; i < object.composite->part_count; ++i) {
+				const SceneCompositePart &part = object.composite->parts[i];
+				CompiledCompositePart part_record;
+				memset(&part_record, 0, sizeof(part_record));
+				part_record.texture_id = strings.Add(
+					AtomName(part.texture_id));
+				part_record.region_id = strings.Add(
+					AtomName(part.region_id));
+				part_record.x = part.x;
+				part_record.y = part.y;
+				if (part.flip) {
+					part_record.flags |= kCompiledCompositePartFlip;
+				}
+				part_record.spritesheet_index = part.spritesheet_index;
+				part_record.region_index = part.region_index;
+				composite_parts.push_back(part_record);
+			}
+		}
+		if (object.emitter) {
+			const SceneComponentEmitter &emitter = *object.emitter;
+			record.flags |= kCompiledObjectEmitter;
+			if (emitter.random_frame) {
+				record.flags |= kCompiledObjectEmitterRandomFrame;
+			}
+			record.emitter_spritesheet = strings.Add(
+				AtomName(emitter.spritesheet_id));
+			record.emitter_sequence = strings.Add(
+				AtomName(emitter.sequence));
+			record.emitter_spritesheet_index = emitter.spritesheet_index;
+			record.emitter_first_frame = add_frames(
+				emitter.frames, emitter.frame_count);
+			record.emitter_frame_count =
+				static_cast<uint32_t>(emitter.frame_count);
+			record.emitter_rate = emitter.rate;
+			record.emitter_burst = emitter.burst;
+			record.emitter_capacity = emitter.capacity;
+			record.emitter_life_min = emitter.life_min;
+			record.emitter_life_max = emitter.life_max;
+			record.emitter_speed_min = emitter.speed_min;
+			record.emitter_speed_max = emitter.speed_max;
+			record.emitter_angle = emitter.angle;
+			record.emitter_spread = emitter.spread;
+			record.emitter_offset_x = emitter.offset_x;
+			record.emitter_offset_y = emitter.offset_y;
+		}
+		if (object.transform) {
+			record.flags |= kCompiledObjectTransform;
+			record.rotation = object.transform->rotation;
+			record.scale_x = object.transform->scale_x;
+			record.scale_y = object.transform->scale_y;
+			record.pivot_x = object.transform->pivot_x;
+			record.pivot_y = object.transform->pivot_y;
+		}
+		objects.push_back(record);
+	}
+
+	vector<char> out(sizeof(header));
+	header.strings = AppendTable(out, strings.chars());
+	header.sources = AppendTable(out, sources);
+	header.textures = AppendTable(out, textures);
+	header.spritesheets = AppendTable(out, spritesheets);
+	header.regions = AppendTable(out, regions);
+	header.objects = AppendTable(out, objects);
+	header.frames = AppendTable(out, frames);
+	header.composite_parts = AppendTable(out, composite_parts);
+	header.file_size = static_cast<uint32_t>(out.size());
+	memcpy(out.data(), &header, sizeof(header));
+
+	FILE *file = fopen(out_file_name, "wb");
+	if (!file) {
+		SDL_LogError(
+			SDL_LOG_CATEGORY_SYSTEM,
+			"Failed to open %s for writing\n",
+			out_file_name);
+		throw runtime_error("Failed to open compiled scene for writing");
+	}
+	size_t written = fwrite(out.data(), 1, out.size(), file);
+	bool closed = 0 == fclose(file);
+	if (written != out.size() || !closed) {
+		SDL_LogError(
+			SDL_LOG_CATEGORY_SYSTEM,
+			"Failed to write %s\n",
+			out_file_name);
+		throw runtime_error("Failed to write compiled scene");
+	}
+
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_SYSTEM,
+		"Compiled %s into %s: %lu bytes, %lu objects, %lu regions\n",
+		scene_file_name,
+		out_file_name,
+		static_cast<unsigned long>(out.size()),
+		static_cast<unsigned long>(objects.size()),
+		static_cast<unsigned long>(regions.size()));
+}
+
+const CompiledSceneHeader*
+GetCompiledScene(const MappedFile &file) {
+	if (file.size() < sizeof(CompiledSceneHeader)) {
+		return nullptr;
+	}
+
+	auto header = reinterpret_cast<const CompiledSceneHeader*>(
+		file.data());
+	if (header->magic != kCompiledSceneMagic
+			|| header->version != kCompiledSceneVersion
+			|| header->file_size != file.size()
+			|| !IsTableInBounds<char>(header->strings, file.size())
+			|| !IsTableInBounds<CompiledSource>(
+				header->sources, file.size())
+			|| !IsTableInBounds<CompiledTexture>(
+				header->textures, file.size())
+			|| !IsTableInBounds<CompiledSpritesheet>(
+				header->spritesheets, file.size())
+			|| !IsTableInBounds<CompiledRegion>(
+				header->regions, file.size())
+			|| !IsTableInBounds<CompiledObject>(
+				header->objects, file.size())
+			|| !IsTableInBounds<int32_t>(header->frames, file.size())
+			|| !IsTableInBounds<CompiledCompositePart>(
+				header->composite_parts, file.size())) {
+		return nullptr;
+	}
+
+	// Everything below only compares integers, so checking the whole
+	// file stays cheap next to actually touching its pages.
+	const uint32_t string_bytes = header->strings.count;
+	if (string_bytes > 0 && file.data()[
+			header->strings.offset + string_bytes - 1] != '\0') {
+		return nullptr;
+	}
+	if (!IsStringInBounds(header->id, string_bytes)
+			|| !IsStringInBounds(header->title, string_bytes)) {
+		return nullptr;
+	}
+
+	auto sources = CompiledRecords<CompiledSource>(file, header->sources);
+	for (uint32_t i = 0; i < header->sources.count; ++i) {
+		if (!IsStringInBounds(sources[i].path, string_bytes)) {
+			return nullptr;
+		}
+	}
+
+	auto textures = CompiledRecords<CompiledTexture>(
+		file, header->textures);
+	for (uint32_t i = 0; i < header->textures.count; ++i) {
+		if (!IsStringInBounds(textures[i].id, string_bytes)
+				|| !IsStringInBounds(textures[i].path, string_bytes)) {
+			return nullptr;
+		}
+	}
+
+	auto sheets = CompiledRecords<CompiledSpritesheet>(
+		file, header->spritesheets);
+	for (uint32_t i = 0; i < header->spritesheets.count; ++i) {
+		const CompiledSpritesheet &sheet = sheets[i];
+		if (!IsStringInBounds(sheet.id, string_bytes)
+				|| !IsStringInBounds(sheet.path, string_bytes)
+				|| !IsStringInBounds(sheet.image_path, string_bytes)
+				|| sheet.first_region > header->regions.count
+				|| sheet.region_count
+					> header->regions.count - sheet.first_region) {
+			return nullptr;
+		}
+	}
+
+	auto regions = CompiledRecords<CompiledRegion>(file, header->regions);
+	for (uint32_t i = 0; i < header->regions.count; ++i) {
+		if (!IsStringInBounds(regions[i].name, string_bytes)) {
+			return nullptr;
+		}
+	}
+
+	auto parts = CompiledRecords<CompiledCompositePart>(
+		file, header->composite_parts);
+	for (uint32_t i = 0; i < header->composite_parts.count; ++i) {
+		const CompiledCompositePart &part = parts[i];
+		if (!IsStringInBounds(part.texture_id, string_bytes)
+				|| !IsStringInBounds(part.region_id, string_bytes)
+				|| !IsIndexValid(
+					part.spritesheet_index, header->spritesheets.count)) {
+			return nullptr;
+		}
+		if (part.spritesheet_index >= 0 && (part.region_index < 0
+				|| !IsIndexValid(
+					part.region_index,
+					sheets[part.spritesheet_index].region_count))) {
+			return nullptr;
+		}
+	}
+
+	auto objects = CompiledRecords<CompiledObject>(file, header->objects);
+	for (uint32_t i = 0; i < header->objects.count; ++i) {
+		const CompiledObject &object = objects[i];
+		if ((object.flags & kCompiledObjectComposite)
+				&& (object.composite_first_part
+						> header->composite_parts.count
+					|| object.composite_part_count
+						> header->composite_parts.count
+							- object.composite_first_part)) {
+			return nullptr;
+		}
+		if (!IsStringInBounds(object.id, string_bytes)
+				|| !IsStringInBounds(object.texture_id, string_bytes)
+				|| !IsStringInBounds(object.region_id, string_bytes)
+				|| !IsIndexValid(
+					object.texture_index, header->textures.count)
+				|| !IsIndexValid(
+					object.spritesheet_index,
+					header->spritesheets.count)) {
+			return nullptr;
+		}
+		if (object.spritesheet_index >= 0 && !IsIndexValid(
+				object.region_index,
+				sheets[object.spritesheet_index].region_count)) {
+			return nullptr;
+		}
+		if ((object.flags & kCompiledObjectAnimation)
+				&& (!IsStringInBounds(
+						object.animation_sequence, string_bytes)
+					|| !AreFramesValid(
+						file,
+						*header,
+						sheets,
+						object.spritesheet_index,
+						object.animation_first_frame,
+						object.animation_frame_count))) {
+			return nullptr;
+		}
+		if ((object.flags & kCompiledObjectEmitter)
+				&& (!IsStringInBounds(
+						object.emitter_spritesheet, string_bytes)
+					|| !IsStringInBounds(
+						object.emitter_sequence, string_bytes)
+					|| !IsIndexValid(
+						object.emitter_spritesheet_index,
+						header->spritesheets.count)
+					|| !AreFramesValid(
+						file,
+						*header,
+						sheets,
+						object.emitter_spritesheet_index,
+						object.emitter_first_frame,
+						object.emitter_frame_count))) {
+			return nullptr;
+		}
+	}
+
+	return header;
+}
+
+bool
+AreCompiledSourcesCurrent(
+		const MappedFile &file,
+		const string &prefix) {
+	const CompiledSceneHeader *header = GetCompiledScene(file);
+	if (!header) {
+		return false;
+	}
+
+	auto sources = CompiledRecords<CompiledSource>(file, header->sources);
+	string path;
+	for (uint32_t i = 0; i < header->sources.count; ++i) {
+		const CompiledSource &source = sources[i];
+		path.assign(prefix);
+		path.append(CompiledChars(file, *header, source.path),
+			source.path.length);
+
+		FileStamp stamp;
+		stamp.modified = source.modified;
+		stamp.size = source.size;
+		stamp.hash = source.hash;
+		if (!IsFileUnchanged(path, stamp)) {
+			SDL_LogInfo(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"%s changed since the scene was compiled\n",
+				path.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace foo
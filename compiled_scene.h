@@ -0,0 +1,221 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_COMPILED_SCENE_H_
+#define FOO_ASTEROIDS_COMPILED_SCENE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "mapped_file.h"
+
+// Layout of scenes baked by foo-asteroids-scene-compiler. A compiled scene
+// is a header followed by flat tables of fixed-size records; every string
+// lives in one NUL-terminated string table and is referenced by offset.
+// Tables are 8-byte aligned so records can be read straight out of a
+// memory mapping. Integers are stored in host byte order: compiled scenes
+// are build artifacts, not an interchange format.
+
+namespace foo {
+
+class Scene;
+
+const uint32_t kCompiledSceneMagic = 0x4e435346; // "FSCN"
+// Bump whenever a record below changes.
+const uint32_t kCompiledSceneVersion = 8;
+
+struct CompiledString {
+	uint32_t offset;
+	uint32_t length;
+};
+
+struct CompiledTable {
+	uint32_t offset;
+	uint32_t count;
+};
+
+struct CompiledSceneHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t file_size;
+	int32_t width;
+	int32_t height;
+	CompiledString id;
+	CompiledString title;
+	CompiledTable strings;
+	CompiledTable sources;
+	CompiledTable textures;
+	CompiledTable spritesheets;
+	CompiledTable regions;
+	CompiledTable objects;
+	// Region indices of animation frames, as int32_t.
+	CompiledTable frames;
+	CompiledTable composite_parts;
+};
+
+// A file the compiled scene was built from. Paths are relative to the
+// directory of the compiled scene, like the paths in scene.json.
+struct CompiledSource {
+	CompiledString path;
+	int64_t modified;
+	int64_t size;
+	uint64_t hash;
+};
+
+struct CompiledTexture {
+	CompiledString id;
+	CompiledString path;
+};
+
+struct CompiledSpritesheet {
+	CompiledString id;
+	CompiledString path;
+	CompiledString image_path;
+	uint32_t first_region;
+	uint32_t region_count;
+};
+
+struct CompiledRegion {
+	CompiledString name;
+	int32_t x;
+	int32_t y;
+	int32_t width;
+	int32_t height;
+};
+
+enum CompiledObjectFlags {
+	kCompiledObjectTexture = 1 << 0,
+	kCompiledObjectTextureRepeat = 1 << 1,
+	kCompiledObjectVelocity = 1 << 2,
+	kCompiledObjectCollider = 1 << 3,
+	kCompiledObjectAnimation = 1 << 4,
+	kCompiledObjectAnimationLoop = 1 << 5,
+	kCompiledObjectComposite = 1 << 6,
+	kCompiledObjectTransform = 1 << 7,
+	kCompiledObjectEmitter = 1 << 8,
+	kCompiledObjectEmitterRandomFrame = 1 << 9,
+};
+
+enum CompiledCompositePartFlags {
+	kCompiledCompositePartFlip = 1 << 0,
+};
+
+struct CompiledCompositePart {
+	CompiledString texture_id;
+	CompiledString region_id;
+	int32_t x;
+	int32_t y;
+	uint32_t flags;
+	int32_t spritesheet_index;
+	int32_t region_index;
+};
+
+struct CompiledObject {
+	CompiledString id;
+	// The two halves of a "sheet:region" texture id; region_id is empty
+	// for plain textures.
+	CompiledString texture_id;
+	CompiledString region_id;
+	int32_t x;
+	int32_t y;
+	uint32_t flags;
+	int32_t texture_index;
+	int32_t spritesheet_index;
+	int32_t region_index;
+	int32_t repeat_x;
+	int32_t repeat_y;
+	float velocity_x;
+	float velocity_y;
+	float angular_velocity;
+	float collider_radius;
+	CompiledString animation_sequence;
+	float animation_fps;
+	// Frames of the animation in the frames table.
+	uint32_t animation_first_frame;
+	uint32_t animation_frame_count;
+	// Parts of the composite in the composite_parts table.
+	uint32_t composite_first_part;
+	uint32_t composite_part_count;
+	float rotation;
+	float scale_x;
+	float scale_y;
+	float pivot_x;
+	float pivot_y;
+	CompiledString emitter_spritesheet;
+	CompiledString emitter_sequence;
+	int32_t emitter_spritesheet_index;
+	// Frames of the emitter's particles in the frames table.
+	uint32_t emitter_first_frame;
+	uint32_t emitter_frame_count;
+	float emitter_rate;
+	int32_t emitter_burst;
+	int32_t emitter_capacity;
+	float emitter_life_min;
+	float emitter_life_max;
+	float emitter_speed_min;
+	float emitter_speed_max;
+	float emitter_angle;
+	float emitter_spread;
+	float emitter_offset_x;
+	float emitter_offset_y;
+};
+
+// Bakes scene, loaded from scene_file_name, into out_file_name. The
+// scene file and every atlas are recorded as sources so the runtime can
+// tell when the compiled scene is stale. Throws runtime_error on failure.
+void
+WriteCompiledScene(
+	const Scene &scene,
+	const char *scene_file_name,
+	const char *out_file_name);
+
+// Returns the header of the compiled scene in file, or nullptr if the
+// file is truncated, from another version, or has tables out of bounds.
+const CompiledSceneHeader*
+GetCompiledScene(const MappedFile &file);
+
+// Returns true if every source recorded in the compiled scene is still
+// unchanged on disk. prefix is the directory of the compiled scene.
+bool
+AreCompiledSourcesCurrent(
+	const MappedFile &file,
+	const std::string &prefix);
+
+// Records of table, read in place from the mapping.
+template <typename T>
+inline const T*
+CompiledRecords(const MappedFile &file, const CompiledTable &table) {
+	return reinterpret_cast<const T*>(file.data() + table.offset);
+}
+
+// NUL-terminated characters of string, read in place.
+inline const char*
+CompiledChars(
+		const MappedFile &file,
+		const CompiledSceneHeader &header,
+		const CompiledString &string) {
+	return file.data() + header.strings.offset + string.offset;
+}
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_COMPILED_SCENE_H_
@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_COMPONENT_POOL_H_
+#define FOO_ASTEROIDS_COMPONENT_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace foo {
+
+// Handle to an entity of a World. index is reused once the entity is
+// destroyed; generation changes every time it is, so stale handles never
+// match a newer entity.
+struct Entity {
+	uint32_t index;
+	uint32_t generation;
+};
+
+inline bool
+operator==(const Entity &lhs, const Entity &rhs) {
+	return lhs.index == rhs.index && lhs.generation == rhs.generation;
+}
+
+inline bool
+operator!=(const Entity &lhs, const Entity &rhs) {
+	return !(lhs == rhs);
+}
+
+const Entity kNoEntity = { UINT32_MAX, UINT32_MAX };
+
+// Marks entity indices without a component in ComponentPool.
+const uint32_t kNoComponentSlot = UINT32_MAX;
+
+// Components of type T stored as a sparse set: dense arrays of components
+// and their owners that systems iterate without gaps, plus a table from
+// entity index to dense slot for lookups. Removal moves the last
+// component into the hole, so dense order is insertion order only until
+// something is removed.
+//
+// version() changes on every non-const access, which lets consumers skip
+// work while nothing has been written.
+template <typename T>
+class ComponentPool {
+	std::vector<uint32_t> slots_;
+	std::vector<Entity> entities_;
+	std::vector<T> components_;
+	unsigned int version_;
+
+public:
+	ComponentPool() : version_(0) {}
+
+	// Gives entity a component, replacing the one it had.
+	T&
+	Add(Entity entity, const T &value) {
+		++version_;
+		if (entity.index >= slots_.size()) {
+			slots_.resize(entity.index + 1, kNoComponentSlot);
+		}
+
+		uint32_t &slot = slots_[entity.index];
+		if (kNoComponentSlot != slot) {
+			entities_[slot] = entity;
+			components_[slot] = value;
+			return components_[slot];
+		}
+
+		slot = static_cast<uint32_t>(entities_.size());
+		entities_.push_back(entity);
+		components_.push_back(value);
+		return components_.back();
+	}
+
+	void
+	Remove(Entity entity) {
+		if (!Has(entity)) {
+			return;
+		}
+
+		++version_;
+		uint32_t slot = slots_[entity.index];
+		uint32_t last = static_cast<uint32_t>(entities_.size() - 1);
+		if (slot != last) {
+			entities_[slot] = entities_[last];
+			components_[slot] = std::move(components_[last]);
+			slots_[entities_[slot].index] = slot;
+		}
+		entities_.pop_back();
+		components_.pop_back();
+		slots_[entity.index] = kNoComponentSlot;
+	}
+
+	void
+	Clear() {
+		++version_;
+		slots_.clear();
+		entities_.clear();
+		components_.clear();
+	}
+
+	void
+	Reserve(size_t count) {
+		entities_.reserve(count);
+		components_.reserve(count);
+	}
+
+	inline bool
+	Has(Entity entity) const {
+		return entity.index < slots_.size()
+			&& kNoComponentSlot != slots_[entity.index]
+			&& entities_[slots_[entity.index]] == entity;
+	}
+
+	// Returns the component of entity, or null.
+	inline const T*
+	Find(Entity entity) const {
+		return Has(entity) ? &components_[slots_[entity.index]] : nullptr;
+	}
+
+	inline T*
+	Find(Entity entity) {
+		if (!Has(entity)) {
+			return nullptr;
+		}
+		++version_;
+		return &components_[slots_[entity.index]];
+	}
+
+	inline size_t
+	size() const { return entities_.size(); }
+
+	inline bool
+	empty() const { return entities_.empty(); }
+
+	// Owner of every component, parallel to components().
+	inline const std::vector<Entity>&
+	entities() const { return entities_; }
+
+	inline const std::vector<T>&
+	components() const { return components_; }
+
+	inline std::vector<T>&
+	components() {
+		++version_;
+		return components_;
+	}
+
+	inline unsigned int
+	version() const { return version_; }
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_COMPONENT_POOL_H_
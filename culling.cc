@@ -0,0 +1,350 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "culling.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FOO_ASTEROIDS_CULL_SSE2 1
+#endif
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+// Grids with more cells than this per sprite cost more to build and clear
+// than testing every sprite, which happens when a few sprites are far
+// from the rest.
+const int64_t kMaxCellsPerSprite = 16;
+
+inline int
+FloorDivide(int numerator, int denominator) {
+	int quotient = numerator / denominator;
+	if (numerator % denominator != 0
+			&& (numerator < 0) != (denominator < 0)) {
+		--quotient;
+	}
+	return quotient;
+}
+
+// Makes room for size elements in values, doubling its capacity at least,
+// so buffers rebuilt every frame stop allocating once sizes settle.
+inline void
+Grow(vector<int> &values, size_t size) {
+	if (size > values.capacity()) {
+		values.reserve(max(size, values.capacity() * 2));
+	}
+}
+
+inline bool
+Intersects(int x, int y, int w, int h, const SDL_Rect &viewport) {
+	return x < viewport.x + viewport.w
+		&& x + w > viewport.x
+		&& y < viewport.y + viewport.h
+		&& y + h > viewport.y;
+}
+
+} // namespace
+
+void
+CullRenderList(
+		const RenderList &list,
+		const SDL_Rect &viewport,
+		vector<int> &visible) {
+	const int *xs = list.x.data();
+	const int *ys = list.y.data();
+	const int *ws = list.w.data();
+	const int *hs = list.h.data();
+	int count = static_cast<int>(list.size());
+	int i = 0;
+
+#ifdef FOO_ASTEROIDS_CULL_SSE2
+	const __m128i left = _mm_set1_epi32(viewport.x);
+	const __m128i top = _mm_set1_epi32(viewport.y);
+	const __m128i right = _mm_set1_epi32(viewport.x + viewport.w);
+	const __m128i bottom = _mm_set1_epi32(viewport.y + viewport.h);
+	for (; i + 4 <= count; i += 4) {
+		__m128i x = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(xs + i));
+		__m128i y = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(ys + i));
+		__m128i w = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(ws + i));
+		__m128i h = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(hs + i));
+
+		__m128i inside = _mm_and_si128(
+			_mm_and_si128(
+				_mm_cmplt_epi32(x, right),
+				_mm_cmpgt_epi32(_mm_add_epi32(x, w), left)),
+			_mm_and_si128(
+				_mm_cmplt_epi32(y, bottom),
+				_mm_cmpgt_epi32(_mm_add_epi32(y, h), top)));
+
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(inside));
+		for (int lane = 0; mask; ++lane, mask >>= 1) {
+			if (mask & 1) {
+				visible.push_back(i + lane);
+			}
+		}
+	}
+#endif
+
+	for (; i < count; ++i) {
+		if (Intersects(xs[i], ys[i], ws[i], hs[i], viewport)) {
+			visible.push_back(i);
+		}
+	}
+}
+
+void
+CullQuads(
+		const QuadCorners &quads,
+		const SDL_Rect &viewport,
+		vector<int> &visible) {
+	const float *lefts = quads.left.data();
+	const float *tops = quads.top.data();
+	const float *rights = quads.right.data();
+	const float *bottoms = quads.bottom.data();
+	const float left = static_cast<float>(viewport.x);
+	const float top = static_cast<float>(viewport.y);
+	const float right = static_cast<float>(viewport.x + viewport.w);
+	const float bottom = static_cast<float>(viewport.y + viewport.h);
+	int count = static_cast<int>(quads.size());
+	int i = 0;
+
+#ifdef FOO_ASTEROIDS_CULL_SSE2
+	const __m128 left4 = _mm_set1_ps(left);
+	const __m128 top4 = _mm_set1_ps(top);
+	const __m128 right4 = _mm_set1_ps(right);
+	const __m128 bottom4 = _mm_set1_ps(bottom);
+	for (; i + 4 <= count; i += 4) {
+		__m128 inside = _mm_and_ps(
+			_mm_and_ps(
+				_mm_cmplt_ps(_mm_loadu_ps(lefts + i), right4),
+				_mm_cmpgt_ps(_mm_loadu_ps(rights + i), left4)),
+			_mm_and_ps(
+				_mm_cmplt_ps(_mm_loadu_ps(tops + i), bottom4),
+				_mm_cmpgt_ps(_mm_loadu_ps(bottoms + i), top4)));
+
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; mask; ++lane, mask >>= 1) {
+			if (mask & 1) {
+				visible.push_back(i + lane);
+			}
+		}
+	}
+#endif
+
+	for (; i < count; ++i) {
+		if (lefts[i] < right
+				&& rights[i] > left
+				&& tops[i] < bottom
+				&& bottoms[i] > top) {
+			visible.push_back(i);
+		}
+	}
+}
+
+bool
+ClipRepeatRange(
+		int x,
+		int y,
+		int w,
+		int h,
+		int repeat_x,
+		int repeat_y,
+		const SDL_Rect &viewport,
+		RepeatRange &range) {
+	if (w <= 0 || h <= 0 || repeat_x <= 0 || repeat_y <= 0) {
+		return false;
+	}
+
+	range.first_x = max(0, FloorDivide(viewport.x - x, w));
+	range.last_x = min(
+		repeat_x - 1,
+		FloorDivide(viewport.x + viewport.w - 1 - x, w));
+	range.first_y = max(0, FloorDivide(viewport.y - y, h));
+	range.last_y = min(
+		repeat_y - 1,
+		FloorDivide(viewport.y + viewport.h - 1 - y, h));
+
+	return range.first_x <= range.last_x && range.first_y <= range.last_y;
+}
+
+SpatialGrid::SpatialGrid()
+	: cell_size_(1)
+	, origin_x_(0)
+	, origin_y_(0)
+	, columns_(0)
+	, rows_(0)
+	, mark_(0) {
+}
+
+void SpatialGrid::Clear() {
+	columns_ = 0;
+	rows_ = 0;
+	cell_start_.clear();
+	items_.clear();
+	marks_.clear();
+}
+
+void SpatialGrid::Build(const RenderList &list, int cell_size) {
+	Clear();
+	if (list.empty()) {
+		return;
+	}
+
+	int min_x = INT_MAX;
+	int min_y = INT_MAX;
+	int max_x = INT_MIN;
+	int max_y = INT_MIN;
+	for (size_t i = 0; i < list.size(); ++i) {
+		min_x = min(min_x, list.x[i]);
+		min_y = min(min_y, list.y[i]);
+		max_x = max(max_x, list.x[i] + list.w[i]);
+		max_y = max(max_y, list.y[i] + list.h[i]);
+	}
+
+	int64_t columns = (static_cast<int64_t>(max_x) - min_x) / cell_size + 1;
+	int64_t rows = (static_cast<int64_t>(max_y) - min_y) / cell_size + 1;
+	if (columns * rows
+			> kMaxCellsPerSprite * static_cast<int64_t>(list.size())) {
+		return;
+	}
+
+	cell_size_ = cell_size;
+	origin_x_ = min_x;
+	origin_y_ = min_y;
+	columns_ = static_cast<int>(columns);
+	rows_ = static_cast<int>(rows);
+
+	// Counting sort: count the entries of every cell, turn the counts into
+	// offsets, then scatter the sprite indices.
+	Grow(cell_start_, columns_ * rows_ + 1);
+	cell_start_.assign(columns_ * rows_ + 1, 0);
+	int first_column, last_column, first_row, last_row;
+	for (size_t i = 0; i < list.size(); ++i) {
+		CellRange(list.x[i], list.y[i], list.w[i], list.h[i],
+			first_column, last_column, first_row, last_row);
+		for (int row = first_row; row <= last_row; ++row) {
+			for (int column = first_column;
+					column <= last_column;
+					++column) {
+				++cell_start_[row * columns_ + column + 1];
+			}
+		}
+	}
+
+	for (size_t cell = 1; cell < cell_start_.size(); ++cell) {
+		cell_start_[cell] += cell_start_[cell - 1];
+	}
+
+	Grow(items_, cell_start_.back());
+	items_.resize(cell_start_.back());
+	Grow(cursor_, cell_start_.size() - 1);
+	cursor_.assign(begin(cell_start_), end(cell_start_) - 1);
+	for (size_t i = 0; i < list.size(); ++i) {
+		CellRange(list.x[i], list.y[i], list.w[i], list.h[i],
+			first_column, last_column, first_row, last_row);
+		for (int row = first_row; row <= last_row; ++row) {
+			for (int column = first_column;
+					column <= last_column;
+					++column) {
+				items_[cursor_[row * columns_ + column]++] =
+					static_cast<int>(i);
+			}
+		}
+	}
+
+	marks_.assign(list.size(), 0);
+	mark_ = 0;
+}
+
+void SpatialGrid::Query(
+		const RenderList &list,
+		const SDL_Rect &viewport,
+		vector<int> &visible) const {
+	if (items_.empty()) {
+		return;
+	}
+
+	int first_column, last_column, first_row, last_row;
+	CellRange(viewport.x, viewport.y, viewport.w, viewport.h,
+		first_column, last_column, first_row, last_row);
+
+	if (++mark_ == 0) {
+		fill(begin(marks_), end(marks_), 0);
+		mark_ = 1;
+	}
+
+	size_t first_visible = visible.size();
+	for (int row = first_row; row <= last_row; ++row) {
+		for (int column = first_column; column <= last_column; ++column) {
+			int cell = row * columns_ + column;
+			for (int item = cell_start_[cell];
+					item < cell_start_[cell + 1];
+					++item) {
+				int i = items_[item];
+				if (marks_[i] == mark_) {
+					continue;
+				}
+				marks_[i] = mark_;
+				if (Intersects(
+						list.x[i], list.y[i], list.w[i], list.h[i],
+						viewport)) {
+					visible.push_back(i);
+				}
+			}
+		}
+	}
+
+	// Keep the painter's order of the render list.
+	sort(begin(visible) + first_visible, end(visible));
+}
+
+void SpatialGrid::CellRange(
+		int x,
+		int y,
+		int w,
+		int h,
+		int &first_column,
+		int &last_column,
+		int &first_row,
+		int &last_row) const {
+	first_column = max(0, FloorDivide(x - origin_x_, cell_size_));
+	last_column = min(
+		columns_ - 1,
+		FloorDivide(x + max(w, 1) - 1 - origin_x_, cell_size_));
+	first_row = max(0, FloorDivide(y - origin_y_, cell_size_));
+	last_row = min(
+		rows_ - 1,
+		FloorDivide(y + max(h, 1) - 1 - origin_y_, cell_size_));
+}
+
+} // namespace foo
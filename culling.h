@@ -0,0 +1,126 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_CULLING_H_
+#define FOO_ASTEROIDS_CULLING_H_
+
+#include "render_list.h"
+#include "transform.h"
+#include "SDL_rect.h"
+#include <vector>
+
+namespace foo {
+
+// Appends to visible, in ascending order, the indices of the sprites in
+// list that intersect viewport. Tests four sprites at a time where SSE2
+// is available.
+void
+CullRenderList(
+	const RenderList &list,
+	const SDL_Rect &viewport,
+	std::vector<int> &visible);
+
+// Like CullRenderList, for transformed sprites, whose bounding boxes are
+// tested instead.
+void
+CullQuads(
+	const QuadCorners &quads,
+	const SDL_Rect &viewport,
+	std::vector<int> &visible);
+
+// Range of tiles of a repeated sprite that intersect a viewport, as
+// inclusive tile indices.
+struct RepeatRange {
+	int first_x;
+	int last_x;
+	int first_y;
+	int last_y;
+};
+
+// Computes the visible tiles of a sprite of size w by h at (x, y) that is
+// repeated repeat_x by repeat_y times. Returns false if none are visible.
+bool
+ClipRepeatRange(
+	int x,
+	int y,
+	int w,
+	int h,
+	int repeat_x,
+	int repeat_y,
+	const SDL_Rect &viewport,
+	RepeatRange &range);
+
+// Uniform grid over the bounds of a render list, for lists too large to
+// test every sprite each frame. Sprites are registered in every cell they
+// overlap; cells are stored contiguously, one range per cell.
+class SpatialGrid {
+	int cell_size_;
+	int origin_x_;
+	int origin_y_;
+	int columns_;
+	int rows_;
+	std::vector<int> cell_start_;
+	std::vector<int> items_;
+	// Next free entry of every cell while building; kept so rebuilding
+	// every frame does not allocate.
+	std::vector<int> cursor_;
+	mutable std::vector<unsigned int> marks_;
+	mutable unsigned int mark_;
+
+public:
+	SpatialGrid();
+
+	// Leaves the grid empty if list is spread so thinly that the grid
+	// would have many more cells than sprites; test every sprite then.
+	void
+	Build(const RenderList &list, int cell_size);
+
+	void
+	Clear();
+
+	inline bool
+	empty() const { return items_.empty(); }
+
+	// Appends to visible, in ascending order, the indices of the sprites
+	// that intersect viewport.
+	void
+	Query(
+		const RenderList &list,
+		const SDL_Rect &viewport,
+		std::vector<int> &visible) const;
+
+private:
+	void
+	CellRange(
+		int x,
+		int y,
+		int w,
+		int h,
+		int &first_column,
+		int &last_column,
+		int &first_row,
+		int &last_row) const;
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_CULLING_H_
@@ -0,0 +1,95 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "file_stamp.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <cstdio>
+
+namespace foo {
+
+namespace {
+
+const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+bool
+StatFile(const std::string &path, long long &modified, long long &size) {
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) {
+		return false;
+	}
+	modified = static_cast<long long>(info.st_mtime);
+	size = static_cast<long long>(info.st_size);
+	return true;
+}
+
+} // namespace
+
+FileStamp
+StampFile(const std::string &path) {
+	FileStamp stamp;
+	if (!StatFile(path, stamp.modified, stamp.size)) {
+		return FileStamp();
+	}
+	stamp.hash = HashFileContents(path);
+	return stamp;
+}
+
+bool
+IsFileUnchanged(const std::string &path, const FileStamp &stamp) {
+	long long modified;
+	long long size;
+	if (stamp.size < 0 || !StatFile(path, modified, size)) {
+		return false;
+	}
+	if (size != stamp.size) {
+		return false;
+	}
+	if (modified == stamp.modified) {
+		return true;
+	}
+	return HashFileContents(path) == stamp.hash;
+}
+
+uint64_t
+HashFileContents(const std::string &path) {
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file) {
+		return 0;
+	}
+
+	uint64_t hash = kFnvOffsetBasis;
+	unsigned char buffer[16 * 1024];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		for (size_t i = 0; i < read; ++i) {
+			hash ^= buffer[i];
+			hash *= kFnvPrime;
+		}
+	}
+
+	fclose(file);
+	return hash;
+}
+
+} // namespace foo
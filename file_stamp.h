@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_FILE_STAMP_H_
+#define FOO_ASTEROIDS_FILE_STAMP_H_
+
+#include <string>
+#include <cstdint>
+
+namespace foo {
+
+// Identifies a version of a file on disk. Modification time and size are
+// cheap to query; the content hash settles the cases where a file was
+// touched or rewritten without actually changing.
+struct FileStamp {
+	long long modified;
+	long long size;
+	uint64_t hash;
+
+	FileStamp() : modified(-1), size(-1), hash(0) {}
+};
+
+// Fills modified, size and hash. Returns an empty stamp if the file
+// cannot be read.
+FileStamp
+StampFile(const std::string &path);
+
+// Returns true if the file at path still has the contents described by
+// stamp. Only hashes the file when the modification time or size moved.
+bool
+IsFileUnchanged(const std::string &path, const FileStamp &stamp);
+
+uint64_t
+HashFileContents(const std::string &path);
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_FILE_STAMP_H_
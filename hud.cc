@@ -0,0 +1,180 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "hud.h"
+#include "sprite_batch.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+// Pixels between the icon, the "x" and the value.
+const int kGlyphSpacing = 6;
+const int kDigitSpacing = 1;
+
+} // namespace
+
+Hud::Hud() : spritesheet_index_(-1) {
+	Unbind();
+}
+
+int Hud::AddCounter(int x, int y, Atom icon, bool times) {
+	Counter counter;
+	counter.x = x;
+	counter.y = y;
+	counter.icon = icon;
+	counter.times = times;
+	counter.visible = false;
+	counter.value = 0;
+	counter.icon_glyph.clip = -1;
+	counter.icon_glyph.width = 0;
+	counter.icon_glyph.height = 0;
+	counter.stale = true;
+	counters_.emplace_back(move(counter));
+	return static_cast<int>(counters_.size() - 1);
+}
+
+void Hud::SetValue(int counter, unsigned long value) {
+	Counter &target = counters_[counter];
+	if (target.visible && target.value == value) {
+		return;
+	}
+	target.value = value;
+	target.visible = true;
+	target.stale = true;
+}
+
+void Hud::Move(int counter, int x, int y) {
+	Counter &target = counters_[counter];
+	if (target.x != x || target.y != y) {
+		target.x = x;
+		target.y = y;
+		target.stale = true;
+	}
+}
+
+bool Hud::Bind(
+		const SceneSpritesheet &sheet,
+		int spritesheet_index,
+		const vector<int> &region_clips) {
+	auto find_glyph = [&](Atom name, Glyph &glyph) {
+		int region = sheet.FindRegion(name);
+		if (region < 0) {
+			glyph.clip = -1;
+			glyph.width = 0;
+			glyph.height = 0;
+			return false;
+		}
+		glyph.clip = region_clips[region];
+		glyph.width = sheet.regions[region].width;
+		glyph.height = sheet.regions[region].height;
+		return true;
+	};
+
+	char name[] = "numeral0.png";
+	for (int i = 0; i < 10; ++i) {
+		name[7] = static_cast<char>('0' + i);
+		if (!find_glyph(FindAtom(name), digits_[i])) {
+			Unbind();
+			return false;
+		}
+	}
+	find_glyph(FindAtom("numeralX.png"), times_);
+	for (auto &counter: counters_) {
+		find_glyph(counter.icon, counter.icon_glyph);
+		counter.stale = true;
+	}
+	spritesheet_index_ = spritesheet_index;
+	return true;
+}
+
+void Hud::Unbind() {
+	spritesheet_index_ = -1;
+	for (auto &digit: digits_) {
+		digit.clip = -1;
+		digit.width = 0;
+		digit.height = 0;
+	}
+	times_ = digits_[0];
+}
+
+void Hud::Submit(SpriteBatch &batch, const ClipTable &clips) {
+	if (spritesheet_index_ < 0) {
+		return;
+	}
+	for (auto &counter: counters_) {
+		if (!counter.visible) {
+			continue;
+		}
+		if (counter.stale) {
+			Layout(counter);
+			counter.stale = false;
+		}
+		batch.Add(counter.glyphs, clips);
+	}
+}
+
+void Hud::Layout(Counter &counter) const {
+	// Digits of the value, least significant first.
+	char digits[24];
+	int digit_count = 0;
+	unsigned long value = counter.value;
+	do {
+		digits[digit_count++] = static_cast<char>(value % 10);
+		value /= 10;
+	} while (value != 0);
+
+	const Glyph *icon = counter.icon_glyph.clip >= 0
+		? &counter.icon_glyph
+		: nullptr;
+	const Glyph *times = counter.times && times_.clip >= 0
+		? &times_
+		: nullptr;
+	int line_height = digits_[0].height;
+	if (icon) {
+		line_height = max(line_height, icon->height);
+	}
+
+	RenderList &glyphs = counter.glyphs;
+	glyphs.Clear();
+	int pen = counter.x;
+	auto add_glyph = [&](const Glyph &glyph, int advance) {
+		int top = counter.y + (line_height - glyph.height) / 2;
+		glyphs.Add(pen, top, glyph.width, glyph.height, glyph.clip);
+		pen += glyph.width + advance;
+	};
+	if (icon) {
+		add_glyph(*icon, kGlyphSpacing);
+	}
+	if (times) {
+		add_glyph(*times, kGlyphSpacing);
+	}
+	for (int i = digit_count; i > 0; --i) {
+		add_glyph(digits_[static_cast<int>(digits[i - 1])], kDigitSpacing);
+	}
+}
+
+} // namespace foo
@@ -0,0 +1,117 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef FOO_ASTEROIDS_HUD_H_
+#define FOO_ASTEROIDS_HUD_H_
+
+#include "atom.h"
+#include "render_list.h"
+#include "scene.h"
+#include <vector>
+
+namespace foo {
+
+class SpriteBatch;
+
+// Counters drawn over the scene with the numeral glyphs of a spritesheet,
+// numeral0.png to numeral9.png and numeralX.png. A counter shows, left to
+// right from its top-left corner and centred on one line, an optional
+// icon region, an optional "x" and its value.
+//
+// The glyphs of every counter are laid out into a render list that is
+// kept until its value or position changes, so a steady HUD is a few
+// quads per frame with nothing to format or allocate.
+class Hud {
+	struct Glyph {
+		int clip;
+		int width;
+		int height;
+	};
+	struct Counter {
+		int x;
+		int y;
+		Atom icon;
+		bool times;
+		bool visible;
+		unsigned long value;
+		Glyph icon_glyph;
+		// Set when glyphs no longer match value, position or font.
+		bool stale;
+		RenderList glyphs;
+	};
+
+	std::vector<Counter> counters_;
+	Glyph digits_[10];
+	Glyph times_;
+	// Index of the spritesheet in the current scene, or -1 if it has no
+	// numerals.
+	int spritesheet_index_;
+
+public:
+	Hud();
+
+	// Returns the handle of a new counter at (x, y). icon is the name of
+	// a region of the numeral spritesheet, such as "playerLife1_blue.png",
+	// or kNoAtom, looked up by the next Bind(). The counter is hidden
+	// until its value is set.
+	int
+	AddCounter(int x, int y, Atom icon = kNoAtom, bool times = false);
+
+	void
+	SetValue(int counter, unsigned long value);
+
+	void
+	Move(int counter, int x, int y);
+
+	// Takes the glyphs from sheet, spritesheet_index of the current
+	// scene, whose regions are drawn with region_clips. Returns false,
+	// leaving the HUD unbound, if sheet has no numerals.
+	bool
+	Bind(
+		const SceneSpritesheet &sheet,
+		int spritesheet_index,
+		const std::vector<int> &region_clips);
+
+	// Hides every counter until the next Bind().
+	void
+	Unbind();
+
+	// Adds every visible counter to batch, whose texture must be that of
+	// the bound spritesheet, laying out those that are stale first.
+	void
+	Submit(SpriteBatch &batch, const ClipTable &clips);
+
+	inline int
+	spritesheet_index() const { return spritesheet_index_; }
+
+	inline size_t
+	size() const { return counters_.size(); }
+
+private:
+	void
+	Layout(Counter &counter) const;
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_HUD_H_
@@ -0,0 +1,454 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "json_pull_reader.h"
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include "SDL_log.h"
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+inline bool
+IsDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+int
+HexDigit(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+void
+AppendUtf8(string &out, unsigned code_point) {
+	if (code_point < 0x80) {
+		out.push_back(static_cast<char>(code_point));
+	} else if (code_point < 0x800) {
+		out.push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+		out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+	} else if (code_point < 0x10000) {
+		out.push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+		out.push_back(static_cast<char>(
+			0x80 | ((code_point >> 6) & 0x3f)));
+		out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+	} else {
+		out.push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+		out.push_back(static_cast<char>(
+			0x80 | ((code_point >> 12) & 0x3f)));
+		out.push_back(static_cast<char>(
+			0x80 | ((code_point >> 6) & 0x3f)));
+		out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+	}
+}
+
+} // namespace
+
+JsonPullReader::JsonPullReader(const char *begin, const char *end)
+	: begin_(begin)
+	, current_(begin)
+	, end_(end)
+	, read_root_(false)
+	, is_int_(false)
+	, int_(0)
+	, number_(0.0) {
+}
+
+JsonPullReader::Token JsonPullReader::Next() {
+	SkipWhitespace();
+
+	if (states_.empty()) {
+		if (read_root_) {
+			if (current_ != end_) {
+				Fail("Unexpected characters after the document");
+			}
+			return kEnd;
+		}
+		read_root_ = true;
+		return ReadValue();
+	}
+
+	State &state = states_.back();
+	switch (state) {
+	case kObjectKeyOrEnd:
+		if (current_ != end_ && '}' == *current_) {
+			++current_;
+			states_.pop_back();
+			return kEndObject;
+		}
+		ReadKey();
+		state = kObjectValue;
+		return kKey;
+
+	case kObjectCommaOrEnd:
+		if (current_ == end_) {
+			Fail("Unterminated object");
+		}
+		if ('}' == *current_) {
+			++current_;
+			states_.pop_back();
+			return kEndObject;
+		}
+		if (',' != *current_) {
+			Fail("Expected , or } in object");
+		}
+		++current_;
+		SkipWhitespace();
+		ReadKey();
+		state = kObjectValue;
+		return kKey;
+
+	case kObjectValue:
+		state = kObjectCommaOrEnd;
+		return ReadValue();
+
+	case kArrayValueOrEnd:
+		if (current_ != end_ && ']' == *current_) {
+			++current_;
+			states_.pop_back();
+			return kEndArray;
+		}
+		state = kArrayCommaOrEnd;
+		return ReadValue();
+
+	case kArrayCommaOrEnd:
+		if (current_ == end_) {
+			Fail("Unterminated array");
+		}
+		if (']' == *current_) {
+			++current_;
+			states_.pop_back();
+			return kEndArray;
+		}
+		if (',' != *current_) {
+			Fail("Expected , or ] in array");
+		}
+		++current_;
+		SkipWhitespace();
+		return ReadValue();
+	}
+
+	Fail("Invalid reader state");
+	return kEnd;
+}
+
+void JsonPullReader::Skip(Token token) {
+	if (token != kBeginObject && token != kBeginArray) {
+		return;
+	}
+
+	size_t depth = states_.size();
+	while (states_.size() >= depth) {
+		if (kEnd == Next()) {
+			Fail("Unexpected end of document");
+		}
+	}
+}
+
+bool JsonPullReader::ReadIntPair(Token token, int &first, int &second) {
+	if (token != kBeginArray) {
+		Skip(token);
+		return false;
+	}
+
+	int values[2];
+	int count = 0;
+	bool valid = true;
+	for (Token item = Next(); item != kEndArray; item = Next()) {
+		if (kNumber == item && is_int_ && count < 2) {
+			values[count] = int_;
+		} else {
+			valid = false;
+			Skip(item);
+		}
+		++count;
+	}
+
+	if (!valid || count != 2) {
+		return false;
+	}
+	first = values[0];
+	second = values[1];
+	return true;
+}
+
+bool JsonPullReader::ReadNumberPair(
+		Token token,
+		double &first,
+		double &second) {
+	if (token != kBeginArray) {
+		Skip(token);
+		return false;
+	}
+
+	double values[2];
+	int count = 0;
+	bool valid = true;
+	for (Token item = Next(); item != kEndArray; item = Next()) {
+		if (kNumber == item && count < 2) {
+			values[count] = number_;
+		} else {
+			valid = false;
+			Skip(item);
+		}
+		++count;
+	}
+
+	if (!valid || count != 2) {
+		return false;
+	}
+	first = values[0];
+	second = values[1];
+	return true;
+}
+
+JsonPullReader::Token JsonPullReader::ReadValue() {
+	if (current_ == end_) {
+		Fail("Expected a value");
+	}
+
+	switch (*current_) {
+	case '{':
+		++current_;
+		states_.push_back(kObjectKeyOrEnd);
+		return kBeginObject;
+	case '[':
+		++current_;
+		states_.push_back(kArrayValueOrEnd);
+		return kBeginArray;
+	case '"':
+		ReadString();
+		return kString;
+	case 't':
+		ReadLiteral("true");
+		return kTrue;
+	case 'f':
+		ReadLiteral("false");
+		return kFalse;
+	case 'n':
+		ReadLiteral("null");
+		return kNull;
+	default:
+		ReadNumber();
+		return kNumber;
+	}
+}
+
+void JsonPullReader::ReadKey() {
+	if (current_ == end_ || '"' != *current_) {
+		Fail("Expected an object key");
+	}
+	ReadString();
+
+	SkipWhitespace();
+	if (current_ == end_ || ':' != *current_) {
+		Fail("Expected : after object key");
+	}
+	++current_;
+}
+
+void JsonPullReader::ReadString() {
+	++current_;
+	string_.clear();
+
+	// Copy runs of plain characters at once; only escapes are decoded one
+	// by one.
+	for (;;) {
+		const char *run = current_;
+		while (current_ != end_
+				&& '"' != *current_
+				&& '\\' != *current_
+				&& static_cast<unsigned char>(*current_) >= 0x20) {
+			++current_;
+		}
+		string_.append(run, current_);
+
+		if (current_ == end_) {
+			Fail("Unterminated string");
+		}
+		if ('"' == *current_) {
+			++current_;
+			return;
+		}
+		if ('\\' != *current_) {
+			Fail("Control character in string");
+		}
+
+		++current_;
+		if (current_ == end_) {
+			Fail("Unterminated string");
+		}
+		char escape = *current_++;
+		switch (escape) {
+		case '"': string_.push_back('"'); break;
+		case '\\': string_.push_back('\\'); break;
+		case '/': string_.push_back('/'); break;
+		case 'b': string_.push_back('\b'); break;
+		case 'f': string_.push_back('\f'); break;
+		case 'n': string_.push_back('\n'); break;
+		case 'r': string_.push_back('\r'); break;
+		case 't': string_.push_back('\t'); break;
+		case 'u': {
+			unsigned code_point = 0;
+			for (int pass = 0; pass < 2; ++pass) {
+				if (end_ - current_ < 4) {
+					Fail("Truncated \\u escape");
+				}
+				unsigned unit = 0;
+				for (int i = 0; i < 4; ++i) {
+					int digit = HexDigit(*current_++);
+					if (digit < 0) {
+						Fail("Invalid \\u escape");
+					}
+					unit = (unit << 4) | digit;
+				}
+
+				if (0 == pass) {
+					code_point = unit;
+					// A high surrogate must be followed by a low one.
+					if (unit < 0xd800 || unit > 0xdbff) {
+						break;
+					}
+					if (end_ - current_ < 2
+							|| '\\' != current_[0]
+							|| 'u' != current_[1]) {
+						Fail("Unpaired surrogate in \\u escape");
+					}
+					current_ += 2;
+				} else {
+					if (unit < 0xdc00 || unit > 0xdfff) {
+						Fail("Unpaired surrogate in \\u escape");
+					}
+					code_point = 0x10000
+						+ ((code_point - 0xd800) << 10)
+						+ (unit - 0xdc00);
+				}
+			}
+			AppendUtf8(string_, code_point);
+			break;
+		}
+		default:
+			Fail("Invalid escape in string");
+		}
+	}
+}
+
+void JsonPullReader::ReadNumber() {
+	const char *start = current_;
+	bool negative = false;
+	if ('-' == *current_) {
+		negative = true;
+		++current_;
+	}
+	if (current_ == end_ || !IsDigit(*current_)) {
+		Fail("Expected a value");
+	}
+
+	// Integers, which is almost every number in a scene, are accumulated
+	// directly; anything with a fraction or exponent goes through strtod.
+	long long magnitude = 0;
+	bool overflow = false;
+	while (current_ != end_ && IsDigit(*current_)) {
+		if (magnitude > numeric_limits<int>::max()) {
+			overflow = true;
+		} else {
+			magnitude = magnitude * 10 + (*current_ - '0');
+		}
+		++current_;
+	}
+
+	bool integral = true;
+	if (current_ != end_ && '.' == *current_) {
+		integral = false;
+		++current_;
+		if (current_ == end_ || !IsDigit(*current_)) {
+			Fail("Expected digits after decimal point");
+		}
+		while (current_ != end_ && IsDigit(*current_)) {
+			++current_;
+		}
+	}
+	if (current_ != end_ && ('e' == *current_ || 'E' == *current_)) {
+		integral = false;
+		++current_;
+		if (current_ != end_ && ('+' == *current_ || '-' == *current_)) {
+			++current_;
+		}
+		if (current_ == end_ || !IsDigit(*current_)) {
+			Fail("Expected digits in exponent");
+		}
+		while (current_ != end_ && IsDigit(*current_)) {
+			++current_;
+		}
+	}
+
+	long long value = negative ? -magnitude : magnitude;
+	if (integral && !overflow
+			&& value >= numeric_limits<int>::min()
+			&& value <= numeric_limits<int>::max()) {
+		is_int_ = true;
+		int_ = static_cast<int>(value);
+		number_ = static_cast<double>(value);
+		return;
+	}
+
+	is_int_ = false;
+	string_.assign(start, current_);
+	number_ = strtod(string_.c_str(), nullptr);
+}
+
+void JsonPullReader::ReadLiteral(const char *literal) {
+	size_t length = strlen(literal);
+	if (static_cast<size_t>(end_ - current_) < length
+			|| 0 != memcmp(current_, literal, length)) {
+		Fail("Invalid literal");
+	}
+	current_ += length;
+}
+
+void JsonPullReader::SkipWhitespace() {
+	while (current_ != end_
+			&& (' ' == *current_
+				|| '\n' == *current_
+				|| '\r' == *current_
+				|| '\t' == *current_)) {
+		++current_;
+	}
+}
+
+void JsonPullReader::Fail(const char *message) const {
+	SDL_LogError(
+		SDL_LOG_CATEGORY_SYSTEM,
+		"JSON error at byte %lu: %s\n",
+		static_cast<unsigned long>(current_ - begin_),
+		message);
+	throw runtime_error(message);
+}
+
+} // namespace foo
@@ -0,0 +1,131 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_JSON_PULL_READER_H_
+#define FOO_ASTEROIDS_JSON_PULL_READER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace foo {
+
+// Streaming JSON reader over a character range. Next() returns one token
+// at a time, so callers fill their own structures as the document is
+// read instead of building a Json::Value tree first. Strings and keys are
+// decoded into a buffer reused for the whole document. Malformed input
+// throws runtime_error.
+class JsonPullReader {
+public:
+	enum Token {
+		kEnd,
+		kBeginObject,
+		kEndObject,
+		kBeginArray,
+		kEndArray,
+		kKey,
+		kString,
+		kNumber,
+		kTrue,
+		kFalse,
+		kNull,
+	};
+
+private:
+	enum State {
+		kObjectKeyOrEnd,
+		kObjectCommaOrEnd,
+		kObjectValue,
+		kArrayValueOrEnd,
+		kArrayCommaOrEnd,
+	};
+
+	const char *begin_;
+	const char *current_;
+	const char *end_;
+	std::vector<State> states_;
+	bool read_root_;
+	std::string string_;
+	bool is_int_;
+	int int_;
+	double number_;
+
+public:
+	JsonPullReader(const char *begin, const char *end);
+
+	Token
+	Next();
+
+	// Skips the rest of the value that token starts: nested objects and
+	// arrays are read up to their matching end token.
+	void
+	Skip(Token token);
+
+	// Reads a value that must be an array of exactly two integers. Returns
+	// false, having skipped the value, if it is anything else.
+	bool
+	ReadIntPair(Token token, int &first, int &second);
+
+	// Like ReadIntPair, but accepts any two numbers.
+	bool
+	ReadNumberPair(Token token, double &first, double &second);
+
+	// Characters of the last kKey or kString token.
+	inline const std::string&
+	string() const { return string_; }
+
+	// True if the last kNumber token was an integer that fits in an int.
+	inline bool
+	is_int() const { return is_int_; }
+
+	inline int
+	int_value() const { return int_; }
+
+	inline double
+	number_value() const { return number_; }
+
+private:
+	Token
+	ReadValue();
+
+	void
+	ReadKey();
+
+	void
+	ReadString();
+
+	void
+	ReadNumber();
+
+	void
+	ReadLiteral(const char *literal);
+
+	void
+	SkipWhitespace();
+
+	void
+	Fail(const char *message) const;
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_JSON_PULL_READER_H_
@@ -0,0 +1,294 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "kinematics.h"
+#include "world.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FOO_ASTEROIDS_KINEMATICS_SSE2 1
+#endif
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+const float kFullTurn = 360.0f;
+
+// Advances count values of position by velocity * step and wraps them
+// into [low, low + span), moving previous along so interpolating across
+// the wrap stays on the new side. A single wrap is applied, which is
+// enough for anything moving less than span per step. Nothing wraps if
+// span is not positive.
+void
+IntegrateAxis(
+		float *position,
+		float *previous,
+		const float *velocity,
+		size_t count,
+		float step,
+		float low,
+		float span) {
+	if (span < 0.0f) {
+		span = 0.0f;
+	}
+	const float high = low + span;
+	size_t i = 0;
+
+#ifdef FOO_ASTEROIDS_KINEMATICS_SSE2
+	const __m128 step4 = _mm_set1_ps(step);
+	const __m128 low4 = _mm_set1_ps(low);
+	const __m128 high4 = _mm_set1_ps(high);
+	const __m128 span4 = _mm_set1_ps(span);
+	for (; i + 4 <= count; i += 4) {
+		__m128 p = _mm_loadu_ps(position + i);
+		__m128 v = _mm_loadu_ps(velocity + i);
+		__m128 next = _mm_add_ps(p, _mm_mul_ps(v, step4));
+
+		__m128 offset = _mm_sub_ps(
+			_mm_and_ps(_mm_cmplt_ps(next, low4), span4),
+			_mm_and_ps(_mm_cmpge_ps(next, high4), span4));
+		_mm_storeu_ps(position + i, _mm_add_ps(next, offset));
+		_mm_storeu_ps(previous + i, _mm_add_ps(p, offset));
+	}
+#endif
+
+	for (; i < count; ++i) {
+		float p = position[i];
+		float next = p + velocity[i] * step;
+		float offset = 0.0f;
+		if (next < low) {
+			offset = span;
+		} else if (next >= high) {
+			offset = -span;
+		}
+		position[i] = next + offset;
+		previous[i] = p + offset;
+	}
+}
+
+inline int
+Round(float value) {
+	return static_cast<int>(floor(value + 0.5f));
+}
+
+} // namespace
+
+void BodyArrays::Clear() {
+	x.clear();
+	y.clear();
+	previous_x.clear();
+	previous_y.clear();
+	velocity_x.clear();
+	velocity_y.clear();
+	rotation.clear();
+	previous_rotation.clear();
+	angular_velocity.clear();
+}
+
+void BodyArrays::Reserve(size_t count) {
+	x.reserve(count);
+	y.reserve(count);
+	previous_x.reserve(count);
+	previous_y.reserve(count);
+	velocity_x.reserve(count);
+	velocity_y.reserve(count);
+	rotation.reserve(count);
+	previous_rotation.reserve(count);
+	angular_velocity.reserve(count);
+}
+
+void BodyArrays::Add(const Body &body) {
+	x.push_back(body.x);
+	y.push_back(body.y);
+	previous_x.push_back(body.x);
+	previous_y.push_back(body.y);
+	velocity_x.push_back(body.velocity_x);
+	velocity_y.push_back(body.velocity_y);
+	rotation.push_back(body.rotation);
+	previous_rotation.push_back(body.rotation);
+	angular_velocity.push_back(body.angular_velocity);
+}
+
+void BodyArrays::SwapRemove(size_t index) {
+	size_t last = size() - 1;
+	x[index] = x[last];
+	y[index] = y[last];
+	previous_x[index] = previous_x[last];
+	previous_y[index] = previous_y[last];
+	velocity_x[index] = velocity_x[last];
+	velocity_y[index] = velocity_y[last];
+	rotation[index] = rotation[last];
+	previous_rotation[index] = previous_rotation[last];
+	angular_velocity[index] = angular_velocity[last];
+	x.pop_back();
+	y.pop_back();
+	previous_x.pop_back();
+	previous_y.pop_back();
+	velocity_x.pop_back();
+	velocity_y.pop_back();
+	rotation.pop_back();
+	previous_rotation.pop_back();
+	angular_velocity.pop_back();
+}
+
+void BodyPool::Add(Entity entity, const Body &body) {
+	Remove(entity);
+	if (entity.index >= slots_.size()) {
+		slots_.resize(entity.index + 1, kNoComponentSlot);
+	}
+	slots_[entity.index] = static_cast<uint32_t>(entities_.size());
+	entities_.push_back(entity);
+	bodies_.Add(body);
+}
+
+void BodyPool::Remove(Entity entity) {
+	if (!Has(entity)) {
+		return;
+	}
+
+	uint32_t slot = slots_[entity.index];
+	uint32_t last = static_cast<uint32_t>(entities_.size() - 1);
+	if (slot != last) {
+		entities_[slot] = entities_[last];
+		slots_[entities_[slot].index] = slot;
+	}
+	entities_.pop_back();
+	bodies_.SwapRemove(slot);
+	slots_[entity.index] = kNoComponentSlot;
+}
+
+void BodyPool::Clear() {
+	slots_.clear();
+	entities_.clear();
+	bodies_.Clear();
+}
+
+void BodyPool::Reserve(size_t count) {
+	entities_.reserve(count);
+	bodies_.Reserve(count);
+}
+
+KinematicsSystem::KinematicsSystem()
+	: left_(0.0f)
+	, top_(0.0f)
+	, right_(0.0f)
+	, bottom_(0.0f) {}
+
+void KinematicsSystem::set_bounds(
+		float left,
+		float top,
+		float right,
+		float bottom) {
+	left_ = left;
+	top_ = top;
+	right_ = right;
+	bottom_ = bottom;
+}
+
+void KinematicsSystem::Step(World &world, float step_seconds) const {
+	BodyArrays &bodies = world.bodies().bodies();
+	size_t count = bodies.size();
+	IntegrateAxis(
+		bodies.x.data(),
+		bodies.previous_x.data(),
+		bodies.velocity_x.data(),
+		count,
+		step_seconds,
+		left_,
+		right_ - left_);
+	IntegrateAxis(
+		bodies.y.data(),
+		bodies.previous_y.data(),
+		bodies.velocity_y.data(),
+		count,
+		step_seconds,
+		top_,
+		bottom_ - top_);
+	IntegrateAxis(
+		bodies.rotation.data(),
+		bodies.previous_rotation.data(),
+		bodies.angular_velocity.data(),
+		count,
+		step_seconds,
+		0.0f,
+		kFullTurn);
+}
+
+void KinematicsSystem::Publish(World &world, float alpha) const {
+	const BodyPool &pool = world.bodies();
+	if (pool.empty()) {
+		return;
+	}
+
+	// Lookups go through the const pools, and only components that change
+	// are written through the mutable ones, so the versions renderers
+	// watch stay put while bodies rest.
+	const BodyArrays &bodies = pool.bodies();
+	auto &positions = world.positions();
+	const auto &current_positions = positions;
+	for (size_t i = 0; i < pool.size(); ++i) {
+		Entity entity = pool.entities()[i];
+		const PositionComponent *position = current_positions.Find(entity);
+		if (!position) {
+			continue;
+		}
+
+		float x = bodies.previous_x[i]
+			+ (bodies.x[i] - bodies.previous_x[i]) * alpha;
+		float y = bodies.previous_y[i]
+			+ (bodies.y[i] - bodies.previous_y[i]) * alpha;
+		int rounded_x = Round(x);
+		int rounded_y = Round(y);
+		if (rounded_x != position->x || rounded_y != position->y) {
+			PositionComponent *moved = positions.Find(entity);
+			moved->x = rounded_x;
+			moved->y = rounded_y;
+		}
+	}
+
+	// Only spinning bodies have transforms, and rotation is not rounded.
+	auto &transforms = world.transforms();
+	const auto &current_transforms = transforms;
+	if (transforms.empty()) {
+		return;
+	}
+	for (size_t i = 0; i < pool.size(); ++i) {
+		Entity entity = pool.entities()[i];
+		const TransformComponent *transform =
+			current_transforms.Find(entity);
+		if (!transform) {
+			continue;
+		}
+		float rotation = bodies.previous_rotation[i]
+			+ (bodies.rotation[i] - bodies.previous_rotation[i]) * alpha;
+		if (rotation != transform->rotation) {
+			transforms.Find(entity)->rotation = rotation;
+		}
+	}
+}
+
+} // namespace foo
@@ -0,0 +1,156 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_KINEMATICS_H_
+#define FOO_ASTEROIDS_KINEMATICS_H_
+
+#include "component_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace foo {
+
+class World;
+
+// State of a body when it is added to a BodyPool. Positions are in
+// pixels, rotation in degrees, velocities per second.
+struct Body {
+	float x;
+	float y;
+	float velocity_x;
+	float velocity_y;
+	float rotation;
+	float angular_velocity;
+};
+
+// Moving bodies as parallel arrays, so integration streams through each
+// quantity four bodies at a time. previous_* hold the state before the
+// last step, for interpolating between steps.
+struct BodyArrays {
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> previous_x;
+	std::vector<float> previous_y;
+	std::vector<float> velocity_x;
+	std::vector<float> velocity_y;
+	std::vector<float> rotation;
+	std::vector<float> previous_rotation;
+	std::vector<float> angular_velocity;
+
+	inline size_t
+	size() const { return x.size(); }
+
+	void
+	Clear();
+
+	void
+	Reserve(size_t count);
+
+	void
+	Add(const Body &body);
+
+	// Removes the body at index by moving the last one into its place.
+	void
+	SwapRemove(size_t index);
+};
+
+// Sparse set of bodies, like ComponentPool but with the components
+// stored as BodyArrays.
+class BodyPool {
+	std::vector<uint32_t> slots_;
+	std::vector<Entity> entities_;
+	BodyArrays bodies_;
+
+public:
+	// Gives entity a body, replacing the one it had.
+	void
+	Add(Entity entity, const Body &body);
+
+	void
+	Remove(Entity entity);
+
+	void
+	Clear();
+
+	void
+	Reserve(size_t count);
+
+	inline bool
+	Has(Entity entity) const {
+		return entity.index < slots_.size()
+			&& kNoComponentSlot != slots_[entity.index]
+			&& entities_[slots_[entity.index]] == entity;
+	}
+
+	// Returns the index of the body of entity in bodies(), or -1.
+	inline int
+	IndexOf(Entity entity) const {
+		return Has(entity) ? static_cast<int>(slots_[entity.index]) : -1;
+	}
+
+	inline size_t
+	size() const { return entities_.size(); }
+
+	inline bool
+	empty() const { return entities_.empty(); }
+
+	// Owner of every body, parallel to bodies().
+	inline const std::vector<Entity>&
+	entities() const { return entities_; }
+
+	inline BodyArrays&
+	bodies() { return bodies_; }
+
+	inline const BodyArrays&
+	bodies() const { return bodies_; }
+};
+
+// Moves the bodies of a World at a fixed step and wraps them around the
+// playfield, as in the arcade game.
+class KinematicsSystem {
+	float left_;
+	float top_;
+	float right_;
+	float bottom_;
+
+public:
+	KinematicsSystem();
+
+	// Bodies leaving this rectangle reappear at the opposite edge. Without
+	// bounds, or along an empty axis, bodies move freely.
+	void
+	set_bounds(float left, float top, float right, float bottom);
+
+	void
+	Step(World &world, float step_seconds) const;
+
+	// Writes into world.positions() the position of every body alpha of
+	// the way from the previous step to the last one, and into
+	// world.transforms() the rotation of those that have a transform.
+	void
+	Publish(World &world, float alpha) const;
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_KINEMATICS_H_
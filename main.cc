@@ -21,24 +21,167 @@ THE SOFTWARE.
 */
 
 #include "scene.h"
+#include "collision.h"
 #include "renderer.h"
+#include "scene_diff.h"
+#include "kinematics.h"
+#include "animation.h"
+#include "particles.h"
+#include "timing.h"
+#include "world.h"
 #include "SDL.h"
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
 
 using namespace foo;
 
+namespace {
+
+const double kSimulationStepMilliseconds = 1000.0 / 60.0;
+const double kThroughputReportMilliseconds = 1000.0;
+const double kFpsUpdateMilliseconds = 500.0;
+const unsigned long kStartingLives = 3;
+// HUD counters keep this far from the edges of the window.
+const int kHudMargin = 16;
+// Height of the lives icon, the tallest glyph of the HUD, and room for it
+// with a few digits.
+const int kHudLineHeight = 26;
+const int kHudLivesWidth = 128;
+const char kSceneFile[] = "assets/scene.json";
+// Written by foo-asteroids-scene-compiler; preferred while it is current.
+const char kCompiledSceneFile[] = "assets/scene.bin";
+// Bodies wrap this far outside the window, so they are fully off screen
+// before they come back on the other side. Collisions wrap the same way.
+const float kWrapMargin = 128.0f;
+
+struct Options {
+	bool uncapped;
+	bool bake_repeats;
+	int texture_budget_megabytes;
+
+	Options()
+		: uncapped(false)
+		, bake_repeats(true)
+		, texture_budget_megabytes(-1) {}
+};
+
+// Milliseconds from the start of main() to the end of each startup phase.
+struct StartupReport {
+	double initialized;
+	double scene_loaded;
+	double scene_processed;
+	double first_frame;
+	bool reported;
+
+	StartupReport()
+		: initialized(0.0)
+		, scene_loaded(0.0)
+		, scene_processed(0.0)
+		, first_frame(0.0)
+		, reported(false) {}
+};
+
+// Systems that advance the world at the fixed simulation rate.
+struct Simulation {
+	KinematicsSystem kinematics;
+	AnimationSystem animation;
+	ParticleSystem particles;
+	Broadphase broadphase;
+	Narrowphase narrowphase;
+};
+
+// Handles of the counters shown by the HUD.
+struct HudCounters {
+	int score;
+	int lives;
+	int fps;
+};
+
+} // namespace
+
+void
+LogStartupReport(
+	const StartupReport &report,
+	double streamed,
+	const RenderSystem &render_system);
+
+Options
+ParseOptions(int argc, char **argv);
+
+void
+LoadScene(
+	Scene &scene,
+	RenderSystem &render_system);
+
 void
 ProcessScene(
 	const Scene &scene,
+	World &world,
+	Simulation &simulation,
 	RenderSystem &render_system);
 
+void
+SetWrapBounds(
+	const Scene &scene,
+	Simulation &simulation);
+
+void
+ReloadScene(
+	Scene &scene,
+	World &world,
+	Simulation &simulation,
+	RenderSystem &render_system);
+
+void
+Simulate(
+	World &world,
+	Simulation &simulation,
+	const CollisionMasks &masks,
+	float step_milliseconds);
+
+HudCounters
+AddHudCounters(Hud &hud);
+
+void
+PlaceHudCounters(
+	const Scene &scene,
+	const HudCounters &counters,
+	Hud &hud);
+
 int
 main(int argc, char** argv) {
+	FrameClock startup_clock;
+	StartupReport startup;
+	Options options = ParseOptions(argc, argv);
 	RenderSystem render_system;
 	Scene main_scene;
+	World world;
+	Simulation simulation;
 
 	render_system.Initialize();
-	main_scene.LoadFromFile("assets/scene.json");
-	ProcessScene(main_scene, render_system);
+	startup.initialized = startup_clock.Peek();
+	render_system.set_vsync(!options.uncapped);
+	render_system.set_bake_repeats(options.bake_repeats);
+	if (options.texture_budget_megabytes >= 0) {
+		render_system.texture_cache().set_budget_bytes(
+			static_cast<size_t>(options.texture_budget_megabytes)
+			* 1024 * 1024);
+	}
+	HudCounters hud_counters = AddHudCounters(render_system.hud());
+	LoadScene(main_scene, render_system);
+	startup.scene_loaded = startup_clock.Peek();
+	ProcessScene(main_scene, world, simulation, render_system);
+	PlaceHudCounters(main_scene, hud_counters, render_system.hud());
+	startup.scene_processed = startup_clock.Peek();
+
+	FrameClock frame_clock;
+	FixedTimestep timestep(kSimulationStepMilliseconds);
+	double report_milliseconds = 0.0;
+	double report_worst_milliseconds = 0.0;
+	unsigned long report_frames = 0;
+	double fps_milliseconds = 0.0;
+	unsigned long fps_frames = 0;
 
 	bool is_running = true;
 	while (is_running) {
@@ -47,25 +190,231 @@ main(int argc, char** argv) {
 			if (event.type == SDL_QUIT) {
 				is_running = false;
 				break;
+			} else if (event.type == SDL_RENDER_TARGETS_RESET) {
+				render_system.RestoreRenderTargets();
 			} else if (event.type == SDL_KEYDOWN) {
 				if (event.key.repeat) continue;
 				if (event.key.keysym.sym == SDLK_F5) {
-					main_scene.LoadFromFile("assets/scene.json");
-					ProcessScene(main_scene, render_system);
+					ReloadScene(
+						main_scene, world, simulation, render_system);
+					PlaceHudCounters(
+						main_scene, hud_counters, render_system.hud());
+
+					// Do not make the simulation catch up on the time
+					// spent reloading.
+					frame_clock.Reset();
+					timestep.Reset();
 				}
 			}
 		}
 
-		render_system.Update(0.0f);
+		double elapsed_milliseconds = frame_clock.Tick();
+		timestep.Accumulate(elapsed_milliseconds);
+		while (timestep.ConsumeStep()) {
+			Simulate(
+				world,
+				simulation,
+				render_system.collision_masks(),
+				timestep.step_milliseconds());
+		}
+		simulation.kinematics.Publish(world, timestep.alpha());
+
+		render_system.Update(
+			world,
+			static_cast<float>(elapsed_milliseconds),
+			timestep.alpha());
+
+		++fps_frames;
+		fps_milliseconds += elapsed_milliseconds;
+		if (fps_milliseconds >= kFpsUpdateMilliseconds) {
+			render_system.hud().SetValue(
+				hud_counters.fps,
+				static_cast<unsigned long>(
+					lround(fps_frames * 1000.0 / fps_milliseconds)));
+			fps_frames = 0;
+			fps_milliseconds = 0.0;
+		}
+
+		if (!startup.reported) {
+			if (0.0 == startup.first_frame) {
+				startup.first_frame = startup_clock.Peek();
+			}
+			if (!render_system.IsLoading()) {
+				LogStartupReport(
+					startup, startup_clock.Peek(), render_system);
+				startup.reported = true;
+			}
+		}
+
+		if (options.uncapped) {
+			++report_frames;
+			report_milliseconds += elapsed_milliseconds;
+			if (elapsed_milliseconds > report_worst_milliseconds) {
+				report_worst_milliseconds = elapsed_milliseconds;
+			}
+			if (report_milliseconds >= kThroughputReportMilliseconds) {
+				const RenderStats &stats = render_system.stats();
+				SDL_LogInfo(
+					SDL_LOG_CATEGORY_APPLICATION,
+					"%lu frames in %.1f ms: %.1f fps, avg %.3f ms,"
+					" worst %.3f ms, %u draw calls, %u quads,"
+					" %u culled\n",
+					report_frames,
+					report_milliseconds,
+					report_frames * 1000.0 / report_milliseconds,
+					report_milliseconds / report_frames,
+					report_worst_milliseconds,
+					stats.draw_calls,
+					stats.quads,
+					stats.culled);
+				report_frames = 0;
+				report_milliseconds = 0.0;
+				report_worst_milliseconds = 0.0;
+			}
+		}
 	}
 
 	return 0;
 }
 
+void
+LogStartupReport(
+		const StartupReport &report,
+		double streamed,
+		const RenderSystem &render_system) {
+	const TextureCacheStats &stats =
+		render_system.texture_cache().stats();
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_APPLICATION,
+		"Startup: initialize %.1f ms, load scene %.1f ms,"
+		" process scene %.1f ms, first frame at %.1f ms,"
+		" all textures at %.1f ms (%.1f ms decoding on workers,"
+		" %.1f ms uploading)\n",
+		report.initialized,
+		report.scene_loaded - report.initialized,
+		report.scene_processed - report.scene_loaded,
+		report.first_frame,
+		streamed,
+		stats.decode_milliseconds,
+		stats.upload_milliseconds);
+}
+
+Options
+ParseOptions(int argc, char **argv) {
+	Options options;
+	for (int i = 1; i < argc; ++i) {
+		if (0 == strcmp(argv[i], "--uncapped")) {
+			options.uncapped = true;
+		} else if (0 == strcmp(argv[i], "--no-bake-repeats")) {
+			options.bake_repeats = false;
+		} else if (0 == strcmp(argv[i], "--texture-budget-mb")
+				&& i + 1 < argc) {
+			options.texture_budget_megabytes = atoi(argv[++i]);
+		} else {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_APPLICATION,
+				"Unknown option %s: ignoring\n",
+				argv[i]);
+		}
+	}
+	return options;
+}
+
+void
+LoadScene(
+		Scene &scene,
+		RenderSystem &render_system) {
+	if (!scene.LoadFromCompiledFile(kCompiledSceneFile)) {
+		scene.LoadFromFile(
+			kSceneFile,
+			kSceneParserStream,
+			render_system.worker_pool());
+	}
+}
+
 void
 ProcessScene(
 		const Scene& scene,
+		World &world,
+		Simulation &simulation,
 		RenderSystem &render_system) {
+	InstantiateScene(scene, world);
+	SetWrapBounds(scene, simulation);
+	render_system.ProcessScene(scene, world);
+}
 
-	render_system.ProcessScene(scene);
+void
+ReloadScene(
+		Scene &scene,
+		World &world,
+		Simulation &simulation,
+		RenderSystem &render_system) {
+	Scene reloaded;
+	LoadScene(reloaded, render_system);
+
+	SceneDiff diff = DiffScenes(scene, reloaded);
+	scene = std::move(reloaded);
+	// Reloading starts the objects over from their positions in the file.
+	InstantiateScene(scene, world);
+	SetWrapBounds(scene, simulation);
+	render_system.ProcessScene(scene, world, diff);
+}
+
+void
+SetWrapBounds(
+		const Scene &scene,
+		Simulation &simulation) {
+	float left = -kWrapMargin;
+	float top = -kWrapMargin;
+	float right = scene.width() + kWrapMargin;
+	float bottom = scene.height() + kWrapMargin;
+	simulation.kinematics.set_bounds(left, top, right, bottom);
+	simulation.broadphase.set_bounds(left, top, right, bottom);
+	simulation.narrowphase.set_bounds(left, top, right, bottom);
+}
+
+void
+Simulate(
+		World &world,
+		Simulation &simulation,
+		const CollisionMasks &masks,
+		float step_milliseconds) {
+	// Gameplay systems tick from here at a fixed rate independent of the
+	// display refresh rate.
+	simulation.kinematics.Step(world, step_milliseconds / 1000.0f);
+	simulation.animation.Step(world, step_milliseconds / 1000.0f);
+	simulation.particles.Step(world, step_milliseconds / 1000.0f);
+	simulation.broadphase.Update(world);
+	simulation.narrowphase.Update(
+		world, masks, simulation.broadphase.pairs());
+}
+
+HudCounters
+AddHudCounters(Hud &hud) {
+	HudCounters counters;
+	counters.score = hud.AddCounter(0, 0);
+	counters.lives = hud.AddCounter(
+		0, 0, InternAtom("playerLife1_orange.png"), true);
+	counters.fps = hud.AddCounter(0, 0);
+	// Nothing scores or loses lives yet.
+	hud.SetValue(counters.score, 0);
+	hud.SetValue(counters.lives, kStartingLives);
+	return counters;
+}
+
+void
+PlaceHudCounters(
+		const Scene &scene,
+		const HudCounters &counters,
+		Hud &hud) {
+	// Score top left, lives top right and frame rate bottom left.
+	hud.Move(counters.score, kHudMargin, kHudMargin);
+	hud.Move(
+		counters.lives,
+		scene.width() - kHudMargin - kHudLivesWidth,
+		kHudMargin);
+	hud.Move(
+		counters.fps,
+		kHudMargin,
+		scene.height() - kHudMargin - kHudLineHeight);
 }
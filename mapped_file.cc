@@ -0,0 +1,182 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "mapped_file.h"
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace foo {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+	: data_(nullptr)
+	, size_(0)
+	, file_(INVALID_HANDLE_VALUE)
+	, mapping_(nullptr) {
+}
+
+bool MappedFile::Open(const char *file_name) {
+	Close();
+
+	file_ = CreateFileA(
+		file_name,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr);
+	if (file_ == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file_, &size)) {
+		Close();
+		return false;
+	}
+	size_ = static_cast<size_t>(size.QuadPart);
+	if (0 == size_) {
+		return true;
+	}
+
+	mapping_ = CreateFileMappingA(
+		file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping_) {
+		Close();
+		return false;
+	}
+
+	data_ = static_cast<const char*>(
+		MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+	if (!data_) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data_) {
+		UnmapViewOfFile(data_);
+	}
+	if (mapping_) {
+		CloseHandle(mapping_);
+	}
+	if (file_ != INVALID_HANDLE_VALUE) {
+		CloseHandle(file_);
+	}
+	data_ = nullptr;
+	size_ = 0;
+	mapping_ = nullptr;
+	file_ = INVALID_HANDLE_VALUE;
+}
+
+void swap(MappedFile &lhs, MappedFile &rhs) {
+	using std::swap;
+
+	swap(lhs.data_, rhs.data_);
+	swap(lhs.size_, rhs.size_);
+	swap(lhs.file_, rhs.file_);
+	swap(lhs.mapping_, rhs.mapping_);
+}
+
+#else
+
+MappedFile::MappedFile() : data_(nullptr), size_(0), file_(-1) {}
+
+bool MappedFile::Open(const char *file_name) {
+	Close();
+
+	file_ = open(file_name, O_RDONLY);
+	if (file_ < 0) {
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(file_, &info) != 0) {
+		Close();
+		return false;
+	}
+	size_ = static_cast<size_t>(info.st_size);
+	if (0 == size_) {
+		return true;
+	}
+
+	void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_, 0);
+	if (MAP_FAILED == data) {
+		Close();
+		return false;
+	}
+	data_ = static_cast<const char*>(data);
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data_) {
+		munmap(const_cast<char*>(data_), size_);
+	}
+	if (file_ >= 0) {
+		close(file_);
+	}
+	data_ = nullptr;
+	size_ = 0;
+	file_ = -1;
+}
+
+void swap(MappedFile &lhs, MappedFile &rhs) {
+	using std::swap;
+
+	swap(lhs.data_, rhs.data_);
+	swap(lhs.size_, rhs.size_);
+	swap(lhs.file_, rhs.file_);
+}
+
+#endif
+
+MappedFile::MappedFile(MappedFile &&other) : MappedFile() {
+	swap(*this, other);
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+MappedFile& MappedFile::operator=(MappedFile &&other) {
+	if (this != &other) {
+		Close();
+		swap(*this, other);
+	}
+	return *this;
+}
+
+} // namespace foo
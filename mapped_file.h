@@ -0,0 +1,71 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_MAPPED_FILE_H_
+#define FOO_ASTEROIDS_MAPPED_FILE_H_
+
+#include <cstddef>
+
+namespace foo {
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+	const char *data_;
+	size_t size_;
+#ifdef _WIN32
+	void *file_;
+	void *mapping_;
+#else
+	int file_;
+#endif
+
+public:
+	MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile(MappedFile &&other);
+	~MappedFile();
+
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile& operator=(MappedFile &&other);
+	friend void swap(MappedFile &lhs, MappedFile &rhs);
+
+	// Returns false if the file cannot be opened or mapped. Empty files
+	// open successfully with a null data().
+	bool
+	Open(const char *file_name);
+
+	void
+	Close();
+
+	inline const char*
+	data() const { return data_; }
+
+	inline size_t
+	size() const { return size_; }
+
+	inline bool
+	is_open() const { return data_ != nullptr; }
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_MAPPED_FILE_H_
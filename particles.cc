@@ -0,0 +1,410 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "particles.h"
+#include "thread_pool.h"
+#include "world.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FOO_ASTEROIDS_PARTICLES_SSE2 1
+#endif
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+const float kRadiansPerDegree = 3.14159265f / 180.0f;
+
+// Particles moved by one slice of the threaded step, so slices are long
+// enough to be worth handing over but still spread across workers.
+const size_t kParticlesPerSlice = 16384;
+
+// Returns a number in [0, 1) and advances state, which must not be zero.
+inline float
+NextRandom(uint32_t &state) {
+	uint32_t x = state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	state = x;
+	return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+inline float
+Between(float low, float high, uint32_t &state) {
+	return low + (high - low) * NextRandom(state);
+}
+
+// Moves and ages particles [first, last) by step seconds.
+void
+Integrate(ParticleArrays &particles, size_t first, size_t last, float step) {
+	float *x = particles.x.data();
+	float *y = particles.y.data();
+	const float *velocity_x = particles.velocity_x.data();
+	const float *velocity_y = particles.velocity_y.data();
+	float *life = particles.life.data();
+	const float *inverse_life = particles.inverse_life.data();
+	float *alpha = particles.alpha.data();
+	size_t i = first;
+
+#ifdef FOO_ASTEROIDS_PARTICLES_SSE2
+	const __m128 step4 = _mm_set1_ps(step);
+	const __m128 zero4 = _mm_setzero_ps();
+	for (; i + 4 <= last; i += 4) {
+		__m128 vx = _mm_loadu_ps(velocity_x + i);
+		__m128 vy = _mm_loadu_ps(velocity_y + i);
+		_mm_storeu_ps(
+			x + i,
+			_mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(vx, step4)));
+		_mm_storeu_ps(
+			y + i,
+			_mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(vy, step4)));
+		__m128 remaining = _mm_sub_ps(_mm_loadu_ps(life + i), step4);
+		_mm_storeu_ps(life + i, remaining);
+		_mm_storeu_ps(
+			alpha + i,
+			_mm_mul_ps(
+				_mm_max_ps(remaining, zero4),
+				_mm_loadu_ps(inverse_life + i)));
+	}
+#endif
+
+	for (; i < last; ++i) {
+		x[i] += velocity_x[i] * step;
+		y[i] += velocity_y[i] * step;
+		life[i] -= step;
+		alpha[i] = max(life[i], 0.0f) * inverse_life[i];
+	}
+}
+
+// Removes the particles whose life ran out. Survivors may change order.
+void
+RemoveDead(ParticleArrays &particles) {
+	const float *life = particles.life.data();
+	size_t i = 0;
+	while (i < particles.count) {
+		if (life[i] <= 0.0f) {
+			particles.SwapRemove(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+// Emits what emitter owes after step seconds, as far as its capacity
+// allows; the rest is dropped rather than carried over.
+void
+Emit(ParticleEmitter &emitter, float step) {
+	const Emitter &settings = emitter.settings;
+	ParticleArrays &particles = emitter.particles;
+
+	emitter.pending += settings.rate * step;
+	float whole = floor(emitter.pending);
+	emitter.pending -= whole;
+	size_t wanted = static_cast<size_t>(whole) + emitter.pending_burst;
+	emitter.pending_burst = 0;
+	size_t count = min(wanted, particles.capacity() - particles.count);
+
+	const float origin_x = emitter.origin_x;
+	const float origin_y = emitter.origin_y;
+	const float spread = settings.spread;
+	const float heading = emitter.heading - spread * 0.5f;
+	uint32_t random = emitter.random;
+	for (size_t n = 0; n < count; ++n) {
+		size_t i = particles.count++;
+		float angle = (heading + spread * NextRandom(random))
+			* kRadiansPerDegree;
+		float speed = Between(settings.speed_min, settings.speed_max, random);
+		float life = Between(settings.life_min, settings.life_max, random);
+		particles.x[i] = origin_x;
+		particles.y[i] = origin_y;
+		particles.velocity_x[i] = cos(angle) * speed;
+		particles.velocity_y[i] = sin(angle) * speed;
+		particles.life[i] = life;
+		particles.inverse_life[i] = life > 0.0f ? 1.0f / life : 0.0f;
+		particles.alpha[i] = 1.0f;
+		particles.frame[i] = settings.random_frame
+			? static_cast<uint32_t>(
+				NextRandom(random) * settings.frame_count)
+			: 0;
+	}
+	emitter.random = random;
+}
+
+void
+StepEmitter(ParticleEmitter &emitter, float step) {
+	Integrate(emitter.particles, 0, emitter.particles.count, step);
+	RemoveDead(emitter.particles);
+	Emit(emitter, step);
+}
+
+} // namespace
+
+void ParticleArrays::Allocate(size_t capacity) {
+	x.assign(capacity, 0.0f);
+	y.assign(capacity, 0.0f);
+	velocity_x.assign(capacity, 0.0f);
+	velocity_y.assign(capacity, 0.0f);
+	life.assign(capacity, 0.0f);
+	inverse_life.assign(capacity, 0.0f);
+	alpha.assign(capacity, 0.0f);
+	frame.assign(capacity, 0);
+	count = 0;
+}
+
+void ParticleArrays::SwapRemove(size_t index) {
+	size_t last = --count;
+	x[index] = x[last];
+	y[index] = y[last];
+	velocity_x[index] = velocity_x[last];
+	velocity_y[index] = velocity_y[last];
+	life[index] = life[last];
+	inverse_life[index] = inverse_life[last];
+	alpha[index] = alpha[last];
+	frame[index] = frame[last];
+}
+
+uint32_t ParticlePool::AddSequence(const int *frames, size_t count) {
+	uint32_t first = static_cast<uint32_t>(frames_.size());
+	frames_.insert(end(frames_), frames, frames + count);
+	return first;
+}
+
+void ParticlePool::Add(Entity entity, const Emitter &emitter) {
+	Remove(entity);
+	if (entity.index >= slots_.size()) {
+		slots_.resize(entity.index + 1, kNoComponentSlot);
+	}
+	slots_[entity.index] = static_cast<uint32_t>(entities_.size());
+	entities_.push_back(entity);
+
+	ParticleEmitter added;
+	added.settings = emitter;
+	added.particles.Allocate(emitter.capacity);
+	added.pending = 0.0f;
+	added.pending_burst = emitter.burst;
+	added.origin_x = 0.0f;
+	added.origin_y = 0.0f;
+	added.heading = emitter.angle;
+	// Seeded by entity so emitters of a scene do not move in lockstep.
+	added.random = 0x9e3779b9u ^ (entity.index * 0x85ebca6bu);
+	if (0 == added.random) {
+		added.random = 1;
+	}
+	emitters_.emplace_back(move(added));
+}
+
+void ParticlePool::Remove(Entity entity) {
+	if (!Has(entity)) {
+		return;
+	}
+
+	uint32_t slot = slots_[entity.index];
+	uint32_t last = static_cast<uint32_t>(entities_.size() - 1);
+	if (slot != last) {
+		entities_[slot] = entities_[last];
+		slots_[entities_[slot].index] = slot;
+		emitters_[slot] = move(emitters_[last]);
+	}
+	entities_.pop_back();
+	emitters_.pop_back();
+	slots_[entity.index] = kNoComponentSlot;
+}
+
+void ParticlePool::Clear() {
+	slots_.clear();
+	entities_.clear();
+	emitters_.clear();
+	frames_.clear();
+}
+
+void ParticlePool::Reserve(size_t count) {
+	entities_.reserve(count);
+	emitters_.reserve(count);
+}
+
+void ParticlePool::Burst(Entity entity, uint32_t count) {
+	int index = IndexOf(entity);
+	if (index >= 0) {
+		emitters_[index].pending_burst += count;
+	}
+}
+
+size_t ParticlePool::particle_count() const {
+	size_t count = 0;
+	for (const auto &emitter: emitters_) {
+		count += emitter.particles.count;
+	}
+	return count;
+}
+
+ParticleSystem::ParticleSystem()
+	: emitters_(nullptr)
+	, step_seconds_(0.0f)
+	, work_(nullptr)
+	, work_count_(0)
+	, next_work_(0)
+	, helpers_running_(0) {
+}
+
+void ParticleSystem::Step(
+		World &world,
+		float step_seconds,
+		ThreadPool *pool) {
+	ParticlePool &particles = world.particles();
+	vector<ParticleEmitter> &emitters = particles.emitters();
+	const World &owners = world;
+	const BodyArrays &bodies = owners.bodies().bodies();
+
+	for (size_t i = 0; i < emitters.size(); ++i) {
+		ParticleEmitter &emitter = emitters[i];
+		Entity owner = particles.entities()[i];
+		float x = 0.0f;
+		float y = 0.0f;
+		int body = owners.bodies().IndexOf(owner);
+		const PositionComponent *position = owners.positions().Find(owner);
+		if (body >= 0) {
+			x = bodies.x[body];
+			y = bodies.y[body];
+		} else if (position) {
+			x = static_cast<float>(position->x);
+			y = static_cast<float>(position->y);
+		}
+		const Emitter &settings = emitter.settings;
+		const TransformComponent *transform =
+			owners.transforms().Find(owner);
+		if (!transform) {
+			emitter.origin_x = x + settings.offset_x;
+			emitter.origin_y = y + settings.offset_y;
+			emitter.heading = settings.angle;
+			continue;
+		}
+
+		// Bodies are ahead of their published rotation, as of their
+		// position. The offset turns about the pivot as the sprite's
+		// corners do in TransformRenderList().
+		float rotation = body >= 0 ? bodies.rotation[body]
+			: transform->rotation;
+		float pivot_x = transform->pivot_x * settings.owner_width;
+		float pivot_y = transform->pivot_y * settings.owner_height;
+		float a = (settings.offset_x - pivot_x) * transform->scale_x;
+		float b = (settings.offset_y - pivot_y) * transform->scale_y;
+		float radians = rotation * kRadiansPerDegree;
+		float cosine = cos(radians);
+		float sine = sin(radians);
+		emitter.origin_x = x + pivot_x + a * cosine - b * sine;
+		emitter.origin_y = y + pivot_y + a * sine + b * cosine;
+		emitter.heading = settings.angle + rotation;
+	}
+
+	if (!pool || 0 == pool->size()) {
+		for (auto &emitter: emitters) {
+			StepEmitter(emitter, step_seconds);
+		}
+		return;
+	}
+
+	slices_.clear();
+	for (auto &emitter: emitters) {
+		size_t count = emitter.particles.count;
+		for (size_t first = 0; first < count; first += kParticlesPerSlice) {
+			Slice slice = {
+				&emitter,
+				first,
+				min(first + kParticlesPerSlice, count)
+			};
+			slices_.push_back(slice);
+		}
+	}
+	emitters_ = &emitters;
+	step_seconds_ = step_seconds;
+	RunOnPool(*pool, slices_.size(), &ParticleSystem::IntegrateSlice);
+	RunOnPool(*pool, emitters.size(), &ParticleSystem::FinishEmitter);
+	emitters_ = nullptr;
+}
+
+void ParticleSystem::IntegrateSlice(size_t index) {
+	const Slice &slice = slices_[index];
+	Integrate(
+		slice.emitter->particles,
+		slice.begin,
+		slice.end,
+		step_seconds_);
+}
+
+void ParticleSystem::FinishEmitter(size_t index) {
+	ParticleEmitter &emitter = (*emitters_)[index];
+	RemoveDead(emitter.particles);
+	Emit(emitter, step_seconds_);
+}
+
+void ParticleSystem::RunOnPool(
+		ThreadPool &pool,
+		size_t count,
+		void (ParticleSystem::*work)(size_t)) {
+	if (0 == count) {
+		return;
+	}
+
+	work_ = work;
+	work_count_ = count;
+	next_work_ = 0;
+	// Each helper takes items until none are left, so there is no point
+	// in more helpers than items besides the one this thread takes.
+	size_t helpers = min(pool.size(), count - 1);
+	{
+		lock_guard<mutex> lock(mutex_);
+		helpers_running_ = helpers;
+	}
+	for (size_t i = 0; i < helpers; ++i) {
+		pool.Post([this]() {
+			DrainWork();
+			lock_guard<mutex> lock(mutex_);
+			if (0 == --helpers_running_) {
+				helpers_done_.notify_one();
+			}
+		});
+	}
+
+	DrainWork();
+	unique_lock<mutex> lock(mutex_);
+	helpers_done_.wait(lock, [this]() { return 0 == helpers_running_; });
+}
+
+void ParticleSystem::DrainWork() {
+	for (;;) {
+		size_t index = next_work_.fetch_add(1);
+		if (index >= work_count_) {
+			return;
+		}
+		(this->*work_)(index);
+	}
+}
+
+} // namespace foo
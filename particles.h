@@ -0,0 +1,245 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef FOO_ASTEROIDS_PARTICLES_H_
+#define FOO_ASTEROIDS_PARTICLES_H_
+
+#include "component_pool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace foo {
+
+class World;
+class ThreadPool;
+
+// Settings of an emitter when it is added to a ParticlePool, as in
+// SceneComponentEmitter. Frames are spritesheet region indices stored in
+// the pool by AddSequence(). Angles are in degrees clockwise from the x
+// axis; the owner's rotation, if it has a transform, is added to angle.
+// The offset is from the top-left corner of the owner's sprite and turns
+// and scales with its transform about the pivot, which is at that corner
+// while the sprite's size is unknown.
+struct Emitter {
+	int spritesheet_index;
+	uint32_t first_frame;
+	uint32_t frame_count;
+	bool random_frame;
+	// Most particles alive at once; particles emitted past it are
+	// dropped.
+	uint32_t capacity;
+	float rate;
+	// Particles emitted at once by the first step after Add().
+	uint32_t burst;
+	float life_min;
+	float life_max;
+	float speed_min;
+	float speed_max;
+	float angle;
+	float spread;
+	float offset_x;
+	float offset_y;
+	float owner_width;
+	float owner_height;
+};
+
+// Live particles of one emitter as parallel arrays, allocated to the
+// emitter's capacity once so emitting never allocates. Only the first
+// count entries are alive. x and y are the centre of the particle, alpha
+// its remaining fraction of life and frame the index in the sequence of
+// random_frame emitters.
+struct ParticleArrays {
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> velocity_x;
+	std::vector<float> velocity_y;
+	std::vector<float> life;
+	std::vector<float> inverse_life;
+	std::vector<float> alpha;
+	std::vector<uint32_t> frame;
+	size_t count;
+
+	ParticleArrays() : count(0) {}
+
+	inline size_t
+	size() const { return count; }
+
+	inline size_t
+	capacity() const { return x.size(); }
+
+	void
+	Allocate(size_t capacity);
+
+	// Removes the particle at index by moving the last one into its place.
+	void
+	SwapRemove(size_t index);
+};
+
+// An emitter with its particles and the state of its emission.
+struct ParticleEmitter {
+	Emitter settings;
+	ParticleArrays particles;
+	// Particles owed by rate, carried over between steps.
+	float pending;
+	uint32_t pending_burst;
+	// Where the next particles leave from and their heading, in degrees.
+	float origin_x;
+	float origin_y;
+	float heading;
+	// xorshift state; never zero.
+	uint32_t random;
+};
+
+// Sparse set of emitters, like AnimationPool, plus the frame sequences
+// their particles show.
+class ParticlePool {
+	std::vector<uint32_t> slots_;
+	std::vector<Entity> entities_;
+	std::vector<ParticleEmitter> emitters_;
+	std::vector<int> frames_;
+
+public:
+	// Stores count region indices and returns where they start, for
+	// Emitter::first_frame.
+	uint32_t
+	AddSequence(const int *frames, size_t count);
+
+	// Gives entity an emitter with no particles, replacing the one it had.
+	// The sequence must not be empty.
+	void
+	Add(Entity entity, const Emitter &emitter);
+
+	void
+	Remove(Entity entity);
+
+	// Removes every emitter and sequence.
+	void
+	Clear();
+
+	void
+	Reserve(size_t count);
+
+	// Emits count more particles from the emitter of entity at the next
+	// step, if it has one.
+	void
+	Burst(Entity entity, uint32_t count);
+
+	inline bool
+	Has(Entity entity) const {
+		return entity.index < slots_.size()
+			&& kNoComponentSlot != slots_[entity.index]
+			&& entities_[slots_[entity.index]] == entity;
+	}
+
+	// Returns the index of the emitter of entity in emitters(), or -1.
+	inline int
+	IndexOf(Entity entity) const {
+		return Has(entity) ? static_cast<int>(slots_[entity.index]) : -1;
+	}
+
+	inline size_t
+	size() const { return entities_.size(); }
+
+	inline bool
+	empty() const { return entities_.empty(); }
+
+	// Owner of every emitter, parallel to emitters().
+	inline const std::vector<Entity>&
+	entities() const { return entities_; }
+
+	inline std::vector<ParticleEmitter>&
+	emitters() { return emitters_; }
+
+	inline const std::vector<ParticleEmitter>&
+	emitters() const { return emitters_; }
+
+	inline const std::vector<int>&
+	frames() const { return frames_; }
+
+	// Particles alive in every emitter.
+	size_t
+	particle_count() const;
+};
+
+// Moves, ages and emits the particles of a World at the fixed simulation
+// step. Emitters leave from the body of their owner if it has one, and
+// from its position otherwise.
+class ParticleSystem {
+	// Particles [begin, end) of an emitter, moved by one pool task.
+	struct Slice {
+		ParticleEmitter *emitter;
+		size_t begin;
+		size_t end;
+	};
+
+	// State of the threaded step, kept between steps so it does not
+	// allocate once it has been as large as it needs.
+	std::vector<Slice> slices_;
+	std::vector<ParticleEmitter> *emitters_;
+	float step_seconds_;
+	void (ParticleSystem::*work_)(size_t);
+	size_t work_count_;
+	std::atomic<size_t> next_work_;
+	size_t helpers_running_;
+	std::mutex mutex_;
+	std::condition_variable helpers_done_;
+
+public:
+	ParticleSystem();
+	ParticleSystem(const ParticleSystem&) = delete;
+
+	ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+	// With a pool, particles are moved in slices of a few thousand on its
+	// threads and this one, including those of a single large emitter;
+	// dead particles are then removed and new ones emitted an emitter at
+	// a time. Step() returns once all are done.
+	void
+	Step(World &world, float step_seconds, ThreadPool *pool = nullptr);
+
+private:
+	void
+	IntegrateSlice(size_t index);
+
+	void
+	FinishEmitter(size_t index);
+
+	// Runs (this->*work)(i) for every i in [0, count) on pool and this
+	// thread.
+	void
+	RunOnPool(
+		ThreadPool &pool,
+		size_t count,
+		void (ParticleSystem::*work)(size_t));
+
+	void
+	DrainWork();
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_PARTICLES_H_
@@ -0,0 +1,147 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "render_list.h"
+
+namespace foo {
+
+namespace {
+
+inline uint64_t
+PackRect(const SDL_Rect &rect) {
+	return (static_cast<uint64_t>(static_cast<uint16_t>(rect.x)) << 48)
+		| (static_cast<uint64_t>(static_cast<uint16_t>(rect.y)) << 32)
+		| (static_cast<uint64_t>(static_cast<uint16_t>(rect.w)) << 16)
+		| static_cast<uint64_t>(static_cast<uint16_t>(rect.h));
+}
+
+} // namespace
+
+int ClipTable::Intern(const SDL_Rect &rect) {
+	auto inserted = index_.emplace(
+		PackRect(rect),
+		static_cast<int>(rects_.size()));
+	if (inserted.second) {
+		rects_.push_back(rect);
+	}
+	return inserted.first->second;
+}
+
+void ClipTable::Clear() {
+	rects_.clear();
+	index_.clear();
+}
+
+void RenderList::Clear() {
+	x.clear();
+	y.clear();
+	w.clear();
+	h.clear();
+	clip.clear();
+	rotation.clear();
+	scale_x.clear();
+	scale_y.clear();
+	pivot_x.clear();
+	pivot_y.clear();
+}
+
+void RenderList::Reserve(size_t count) {
+	x.reserve(count);
+	y.reserve(count);
+	w.reserve(count);
+	h.reserve(count);
+	clip.reserve(count);
+	rotation.reserve(count);
+	scale_x.reserve(count);
+	scale_y.reserve(count);
+	pivot_x.reserve(count);
+	pivot_y.reserve(count);
+}
+
+size_t RenderList::Add(int x, int y, int w, int h, int clip) {
+	size_t index = size();
+	this->x.push_back(x);
+	this->y.push_back(y);
+	this->w.push_back(w);
+	this->h.push_back(h);
+	this->clip.push_back(clip);
+	rotation.push_back(0.0f);
+	scale_x.push_back(1.0f);
+	scale_y.push_back(1.0f);
+	pivot_x.push_back(0.5f);
+	pivot_y.push_back(0.5f);
+	return index;
+}
+
+void RenderList::SwapRemove(size_t index) {
+	size_t last = size() - 1;
+	x[index] = x[last];
+	y[index] = y[last];
+	w[index] = w[last];
+	h[index] = h[last];
+	clip[index] = clip[last];
+	rotation[index] = rotation[last];
+	scale_x[index] = scale_x[last];
+	scale_y[index] = scale_y[last];
+	pivot_x[index] = pivot_x[last];
+	pivot_y[index] = pivot_y[last];
+	x.pop_back();
+	y.pop_back();
+	w.pop_back();
+	h.pop_back();
+	clip.pop_back();
+	rotation.pop_back();
+	scale_x.pop_back();
+	scale_y.pop_back();
+	pivot_x.pop_back();
+	pivot_y.pop_back();
+}
+
+void RepeatList::Clear() {
+	tiles.Clear();
+	repeat_x.clear();
+	repeat_y.clear();
+}
+
+size_t RepeatList::Add(
+		int x,
+		int y,
+		int w,
+		int h,
+		int clip,
+		int repeat_x,
+		int repeat_y) {
+	this->repeat_x.push_back(repeat_x);
+	this->repeat_y.push_back(repeat_y);
+	return tiles.Add(x, y, w, h, clip);
+}
+
+void RepeatList::SwapRemove(size_t index) {
+	size_t last = size() - 1;
+	repeat_x[index] = repeat_x[last];
+	repeat_y[index] = repeat_y[last];
+	repeat_x.pop_back();
+	repeat_y.pop_back();
+	tiles.SwapRemove(index);
+}
+
+} // namespace foo
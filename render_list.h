@@ -0,0 +1,120 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_RENDER_LIST_H_
+#define FOO_ASTEROIDS_RENDER_LIST_H_
+
+#include "SDL_rect.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace foo {
+
+// Source rectangles of one texture. Identical rectangles share an index,
+// so render lists refer to clips by a small integer.
+class ClipTable {
+	std::vector<SDL_Rect> rects_;
+	std::unordered_map<uint64_t, int> index_;
+
+public:
+	// Returns the index of rect, adding it if it is new.
+	int
+	Intern(const SDL_Rect &rect);
+
+	void
+	Clear();
+
+	inline const SDL_Rect&
+	operator[](int index) const { return rects_[index]; }
+
+	inline const SDL_Rect*
+	data() const { return rects_.data(); }
+
+	inline size_t
+	size() const { return rects_.size(); }
+};
+
+// Sprites drawn with one texture, stored as parallel arrays so that
+// culling, sorting and transform passes only touch the fields they need
+// and can process several sprites per instruction.
+struct RenderList {
+	std::vector<int> x;
+	std::vector<int> y;
+	std::vector<int> w;
+	std::vector<int> h;
+	std::vector<int> clip;
+	// Rotation in degrees clockwise and scale about a pivot that is a
+	// fraction of the sprite's size. Sprites are added untransformed.
+	std::vector<float> rotation;
+	std::vector<float> scale_x;
+	std::vector<float> scale_y;
+	std::vector<float> pivot_x;
+	std::vector<float> pivot_y;
+
+	inline size_t
+	size() const { return x.size(); }
+
+	inline bool
+	empty() const { return x.empty(); }
+
+	void
+	Clear();
+
+	void
+	Reserve(size_t count);
+
+	// Returns the index of the new sprite.
+	size_t
+	Add(int x, int y, int w, int h, int clip);
+
+	// Removes the sprite at index by moving the last one into its place.
+	void
+	SwapRemove(size_t index);
+};
+
+// Sprites tiled repeat_x by repeat_y times. tiles holds the first tile of
+// each entry.
+struct RepeatList {
+	RenderList tiles;
+	std::vector<int> repeat_x;
+	std::vector<int> repeat_y;
+
+	inline size_t
+	size() const { return tiles.size(); }
+
+	inline bool
+	empty() const { return tiles.empty(); }
+
+	void
+	Clear();
+
+	size_t
+	Add(int x, int y, int w, int h, int clip, int repeat_x, int repeat_y);
+
+	void
+	SwapRemove(size_t index);
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_RENDER_LIST_H_
@@ -23,13 +23,75 @@ THE SOFTWARE.
 #include "renderer.h"
 #include "SDL.h"
 #include "SDL_image.h"
+#include "timing.h"
+#include "thread_pool.h"
 #include <algorithm>
+#include <stdexcept>
 
 using namespace std;
 
 namespace foo {
 
-RenderSystem::RenderSystem() {}
+namespace {
+
+// Render lists with at least this many sprites, none of them transformed,
+// get a spatial grid.
+const size_t kGridThreshold = 4096;
+const int kGridCellSize = 256;
+
+// Larger repeats are drawn tile by tile rather than baked.
+const int kMaxBakedPixels = 4096 * 4096;
+
+// Returns the node a sprite is drawn with.
+inline int
+SpriteNode(
+		const SpriteComponent &sprite,
+		const vector<int> &texture_nodes,
+		const vector<int> &spritesheet_nodes,
+		const vector<int> &composite_nodes) {
+	if (sprite.composite_index >= 0) {
+		return composite_nodes[sprite.composite_index];
+	}
+	return sprite.texture_index >= 0
+		? texture_nodes[sprite.texture_index]
+		: spritesheet_nodes[sprite.spritesheet_index];
+}
+
+// Blending for textures whose colours are already multiplied by their
+// alpha, such as baked composites.
+inline SDL_BlendMode
+PremultipliedBlendMode() {
+	return SDL_ComposeCustomBlendMode(
+		SDL_BLENDFACTOR_ONE,
+		SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+		SDL_BLENDOPERATION_ADD,
+		SDL_BLENDFACTOR_ONE,
+		SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+		SDL_BLENDOPERATION_ADD);
+}
+
+inline bool
+AreRectsEqual(const SDL_Rect &lhs, const SDL_Rect &rhs) {
+	return lhs.x == rhs.x
+		&& lhs.y == rhs.y
+		&& lhs.w == rhs.w
+		&& lhs.h == rhs.h;
+}
+
+} // namespace
+
+RenderSystem::RenderSystem()
+	: synced_positions_version_(0)
+	, synced_animations_version_(0)
+	, synced_transforms_version_(0)
+	, vsync_(true)
+	, bake_repeats_(true)
+	, headless_(false) {
+	viewport_.x = 0;
+	viewport_.y = 0;
+	viewport_.w = 0;
+	viewport_.h = 0;
+}
 
 RenderSystem::~RenderSystem() {}
 
@@ -38,170 +100,688 @@ void RenderSystem::Initialize() {
 
 	SDL_LogInfo(SDL_LOG_CATEGORY_RENDER, "Initializing RenderSystem...\n");
 
+	if (headless_) {
+		SDL_LogInfo(SDL_LOG_CATEGORY_RENDER, "Running headless\n");
+		SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+	}
+
 	sdl_api_.Create(SDL_INIT_VIDEO);
 	sdl_image_api_.Create(IMG_INIT_PNG);
 
+	decode_pool_.reset(new ThreadPool());
+	texture_cache_.set_decode_pool(decode_pool_.get());
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_RENDER,
+		"Decoding images on %lu thread(s)\n",
+		static_cast<unsigned long>(decode_pool_->size()));
+
 	SDL_LogInfo(SDL_LOG_CATEGORY_RENDER, "RenderSystem initialized.\n");
 }
 
 void RenderSystem::ProcessScene(
-		const Scene &scene) {
+		const Scene &scene,
+		const World &world) {
 	SDL_LogInfo(
 		SDL_LOG_CATEGORY_RENDER,
 		"RenderSystem: processing scene...\n");
-	if (window_) {
+	if (renderer_) {
 		UpdateWindowFromScene(scene);
+	} else if (headless_) {
+		CreateOffscreenRendererFromScene(scene);
 	} else {
 		CreateWindowFromScene(scene);
 		CreateRendererFromScene(scene);
 	}
 
-	UpdateNodesFromScene(scene);
+	UpdateViewportFromScene(scene);
+	UpdateNodesFromScene(scene, world, nullptr);
+	texture_cache_.LogStats();
 }
 
-void RenderSystem::UpdateNodesFromScene(const Scene &scene) {
-	nodes_.clear();
+void RenderSystem::ProcessScene(
+		const Scene &scene,
+		const World &world,
+		const SceneDiff &diff) {
+	if (!renderer_) {
+		ProcessScene(scene, world);
+		return;
+	}
 
-    for (const auto &scene_texture: scene.textures()) {
-        Node node = LoadNode(scene_texture.path);
-        for (const auto &scene_object: scene.objects()) {
-            ProcessObjectForTextureReferences(
-                scene_object, scene_texture, node);
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_RENDER,
+		"RenderSystem: processing scene changes...\n");
+	FrameClock clock;
+	if (diff.window_changed) {
+		UpdateWindowFromScene(scene);
+		UpdateViewportFromScene(scene);
+	}
+
+	UpdateNodesFromScene(scene, world, &diff);
+	texture_cache_.LogStats();
+
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_RENDER,
+		"RenderSystem: scene changes applied in %.3f ms\n",
+		clock.Tick());
+}
+
+void RenderSystem::UpdateNodesFromScene(
+		const Scene &scene,
+		const World &world,
+		const SceneDiff *diff) {
+    // The previous nodes hold their textures until the new ones have
+    // acquired them, so images shared by both versions stay in the cache.
+    vector<Node> previous;
+    swap(previous, nodes_);
+    collision_masks_.Clear();
+    nodes_.reserve(scene.textures().size()
+        + scene.spritesheets().size()
+        + scene.composites().size());
+
+    // Resolved texture and spritesheet handles index these tables to find
+    // the node an object is drawn with.
+    vector<int> texture_nodes(scene.textures().size());
+    vector<int> spritesheet_nodes(scene.spritesheets().size());
+    vector<bool> rebuild;
+    rebuild.reserve(texture_nodes.size() + spritesheet_nodes.size());
+
+    for (size_t i = 0; i < scene.textures().size(); ++i) {
+        const auto &scene_texture = scene.textures()[i];
+        Atom id = scene_texture.id;
+        Node *old = diff ? FindNode(previous, id, false) : nullptr;
+        Node node = LoadNode(scene_texture.path.str());
+        node.id = id;
+        node.from_spritesheet = false;
+        node.scene_index = static_cast<int>(i);
+
+        bool reuse = CanReuseRenders(old, node)
+            && !diff->IsTextureChanged(id)
+            && !diff->IsTextureDirty(id);
+        if (reuse) {
+            MoveRenders(*old, node);
+        } else {
+            FillTextureClips(node);
         }
 
-        if (!node.repeating_renders.empty()
-                || !node.simple_renders.empty()) {
-            SDL_LogInfo(SDL_LOG_CATEGORY_RENDER,
-                    "Adding node for %s\n",
-                    scene_texture.id.c_str());
-            nodes_.emplace_back(move(node));
+        UpdateCollisionMasks(node);
+
+        texture_nodes[i] = static_cast<int>(nodes_.size());
+        rebuild.push_back(!reuse);
+        nodes_.emplace_back(move(node));
+    }
+
+    for (size_t i = 0; i < scene.spritesheets().size(); ++i) {
+        const auto &scene_spritesheet = scene.spritesheets()[i];
+        Atom id = scene_spritesheet.id;
+        Node *old = diff ? FindNode(previous, id, true) : nullptr;
+        Node node = LoadNode(scene_spritesheet.image_path.str());
+        node.id = id;
+        node.from_spritesheet = true;
+        node.scene_index = static_cast<int>(i);
+
+        // A changed region table invalidates clip rectangles even if the
+        // image itself is the same.
+        bool reuse = CanReuseRenders(old, node)
+            && !diff->IsSpritesheetChanged(id)
+            && !diff->IsSpritesheetDirty(id);
+        if (reuse) {
+            MoveRenders(*old, node);
+        } else {
+            FillSpritesheetClips(scene_spritesheet, node);
         }
+
+        UpdateCollisionMasks(node);
+
+        spritesheet_nodes[i] = static_cast<int>(nodes_.size());
+        rebuild.push_back(!reuse);
+        nodes_.emplace_back(move(node));
     }
 
-    for (const auto &scene_spritesheet: scene.spritesheets()) {
-        Node node = LoadNode(scene_spritesheet.image_path);
-        string id_start = scene_spritesheet.id + ":";
-        for (const auto &scene_object: scene.objects()) {
-            ProcessObjectForSpritesheetReferences(
-                scene_object, scene_spritesheet, id_start, node);
+    // Composite nodes are few and cheap to bind, so they are always
+    // rebuilt; only their baked textures carry over, and those of
+    // composites the scene no longer uses are released with
+    // previous_composites.
+    map<string, BakedComposite> previous_composites;
+    swap(previous_composites, baked_composites_);
+    vector<int> composite_nodes(scene.composites().size());
+    for (size_t i = 0; i < scene.composites().size(); ++i) {
+        composite_nodes[i] = static_cast<int>(nodes_.size());
+        rebuild.push_back(true);
+        nodes_.emplace_back(LoadCompositeNode(
+            scene, static_cast<int>(i), previous_composites));
+    }
+    if (!composite_nodes.empty()
+            && !SDL_RenderTargetSupported(renderer_.get())) {
+        SDL_LogWarn(
+            SDL_LOG_CATEGORY_RENDER,
+            "Render targets not supported: drawing composites per part\n");
+    }
+
+    if (diff) {
+        AdoptRenders(
+            world,
+            texture_nodes,
+            spritesheet_nodes,
+            composite_nodes,
+            rebuild);
+    }
+    BindObjects(
+        world, texture_nodes, spritesheet_nodes, composite_nodes, rebuild);
+    synced_positions_version_ = world.positions().version();
+
+    // Sprites were bound at the region in their SpriteComponent, which
+    // for animations is the first frame rather than the current one.
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        nodes_[i].animated_stale = true;
+        SyncNodeAnimations(world.animations(), nodes_[i]);
+    }
+    synced_animations_version_ = world.animations().version();
+
+    // Reused render lists still hold the transforms of the previous
+    // instance, and bound sprites none.
+    for (auto &node: nodes_) {
+        node.transformed_stale = true;
+        SyncNodeTransforms(world.transforms(), node);
+        node.corners_stale = true;
+    }
+    synced_transforms_version_ = world.transforms().version();
+
+    // Sprites are now bound, animated and transformed.
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        UpdateGrid(nodes_[i]);
+        if (rebuild[i]) {
+            BakeRepeats(nodes_[i]);
         }
+    }
+    RefreshComposites();
 
-        if (!node.repeating_renders.empty()
-                || !node.simple_renders.empty()) {
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        if (rebuild[i]
+                && (!nodes_[i].sprites.empty()
+                    || !nodes_[i].repeats.empty())) {
             SDL_LogInfo(SDL_LOG_CATEGORY_RENDER,
-                    "Adding node for %s\n",
-                    scene_spritesheet.id.c_str());
-            nodes_.emplace_back(move(node));
+                    "Adding node for %s: %lu simple, %lu repeating,"
+                    " %lu clip(s)\n",
+                    AtomName(nodes_[i].id).c_str(),
+                    static_cast<unsigned long>(nodes_[i].sprites.size()),
+                    static_cast<unsigned long>(nodes_[i].repeats.size()),
+                    static_cast<unsigned long>(nodes_[i].clips.size()));
         }
     }
+
+    hud_.Unbind();
+    for (size_t i = 0; i < scene.spritesheets().size(); ++i) {
+        if (hud_.Bind(
+                scene.spritesheets()[i],
+                static_cast<int>(i),
+                nodes_[spritesheet_nodes[i]].region_clips)) {
+            break;
+        }
+    }
+    if (hud_.spritesheet_index() < 0 && hud_.size() > 0) {
+        SDL_LogWarn(
+            SDL_LOG_CATEGORY_RENDER,
+            "No spritesheet has numeral glyphs: hiding the HUD\n");
+    }
+
+    // Kept for particles and the HUD, which find their spritesheet every
+    // frame.
+    spritesheet_nodes_.swap(spritesheet_nodes);
 }
 
-void RenderSystem::ProcessObjectForSpritesheetReferences(
-        const SceneObject &scene_object,
-        const SceneSpritesheet &scene_spritesheet,
-        const string &id_start,
-        Node &node) const {
-    if (!scene_object.texture
-        || scene_object.texture->texture_id.find(id_start)
-            != 0) {
+void RenderSystem::BindObjects(
+        const World &world,
+        const vector<int> &texture_nodes,
+        const vector<int> &spritesheet_nodes,
+        const vector<int> &composite_nodes,
+        vector<bool> &rebuild) {
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        if (rebuild[i]) {
+            nodes_[i].sprites.Clear();
+            nodes_[i].repeats.Clear();
+            nodes_[i].sprite_owners.clear();
+            nodes_[i].repeat_owners.clear();
+        }
+    }
+
+    const auto &sprites = world.sprites();
+    for (size_t i = 0; i < sprites.size(); ++i) {
+        const SpriteComponent &sprite = sprites.components()[i];
+        int node_index = SpriteNode(
+            sprite, texture_nodes, spritesheet_nodes, composite_nodes);
+        if (!rebuild[node_index]) {
+            continue;
+        }
+
+        Entity entity = sprites.entities()[i];
+        const PositionComponent *position = world.positions().Find(entity);
+        if (!position) {
+            continue;
+        }
+
+        Node &node = nodes_[node_index];
+        BindSprite(
+            entity,
+            *position,
+            world.texture_repeats().Find(entity),
+            SpriteClip(sprite, node),
+            node);
+    }
+}
+
+void RenderSystem::AdoptRenders(
+        const World &world,
+        const vector<int> &texture_nodes,
+        const vector<int> &spritesheet_nodes,
+        const vector<int> &composite_nodes,
+        vector<bool> &rebuild) {
+    // Reused render lists were built for the previous instance of the
+    // same objects, in the same order. Walk the sprites in that order to
+    // hand each slot to its new entity, and rebuild any list that does not
+    // line up, such as after objects were only reordered.
+    vector<size_t> sprite_counts(nodes_.size(), 0);
+    vector<size_t> repeat_counts(nodes_.size(), 0);
+
+    const auto &sprites = world.sprites();
+    for (size_t i = 0; i < sprites.size(); ++i) {
+        const SpriteComponent &sprite = sprites.components()[i];
+        int node_index = SpriteNode(
+            sprite, texture_nodes, spritesheet_nodes, composite_nodes);
+        if (rebuild[node_index]) {
+            continue;
+        }
+
+        Entity entity = sprites.entities()[i];
+        const PositionComponent *position = world.positions().Find(entity);
+        if (!position) {
+            continue;
+        }
+
+        Node &node = nodes_[node_index];
+        int clip = SpriteClip(sprite, node);
+        auto repeat = world.texture_repeats().Find(entity);
+        RenderList *list;
+        size_t slot;
+        if (repeat) {
+            slot = repeat_counts[node_index]++;
+            list = &node.repeats.tiles;
+            if (slot >= list->size()
+                    || node.repeats.repeat_x[slot] != repeat->repeat_x
+                    || node.repeats.repeat_y[slot] != repeat->repeat_y) {
+                rebuild[node_index] = true;
+                continue;
+            }
+            node.repeat_owners[slot] = entity;
+        } else {
+            slot = sprite_counts[node_index]++;
+            list = &node.sprites;
+            if (slot >= list->size()) {
+                rebuild[node_index] = true;
+                continue;
+            }
+            node.sprite_owners[slot] = entity;
+        }
+
+        // Animated sprites show whatever frame they had reached; they are
+        // put back on the current one once binding is done.
+        if (list->clip[slot] != clip
+                && !world.animations().Has(entity)) {
+            rebuild[node_index] = true;
+            continue;
+        }
+        list->x[slot] = position->x;
+        list->y[slot] = position->y;
+    }
+
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        if (rebuild[i]) {
+            continue;
+        }
+        if (sprite_counts[i] != nodes_[i].sprites.size()
+                || repeat_counts[i] != nodes_[i].repeats.size()) {
+            rebuild[i] = true;
+        }
+    }
+}
+
+void RenderSystem::SyncPositions(const World &world) {
+    const auto &positions = world.positions();
+    if (positions.version() == synced_positions_version_) {
         return;
     }
+    synced_positions_version_ = positions.version();
 
-    string subtexture =
-        scene_object.texture->texture_id.substr(id_start.size());
+    for (auto &node: nodes_) {
+        if (!SyncNodePositions(positions, node)) {
+            continue;
+        }
+        node.corners_stale = true;
+        UpdateGrid(node);
+    }
+}
 
-    auto iter = find_if(
-        begin(scene_spritesheet.regions),
-        end(scene_spritesheet.regions),
-        [&subtexture](const SceneSceneSpritesheetRegion &r)
-        { return r.name == subtexture; });
+bool RenderSystem::SyncNodePositions(
+        const ComponentPool<PositionComponent> &positions,
+        Node &node) {
+    bool moved = false;
+    RenderList &sprites = node.sprites;
+    for (size_t i = 0; i < sprites.size();) {
+        const PositionComponent *position =
+            positions.Find(node.sprite_owners[i]);
+        if (!position) {
+            // The entity is gone; fill the slot with the last sprite and
+            // look at it again.
+            sprites.SwapRemove(i);
+            node.sprite_owners[i] = node.sprite_owners.back();
+            node.sprite_owners.pop_back();
+            node.animated_stale = true;
+            node.transformed_stale = true;
+            moved = true;
+            continue;
+        }
+        if (sprites.x[i] != position->x || sprites.y[i] != position->y) {
+            sprites.x[i] = position->x;
+            sprites.y[i] = position->y;
+            moved = true;
+        }
+        ++i;
+    }
 
-    if (end(scene_spritesheet.regions) == iter) {
-        SDL_LogWarn(SDL_LOG_CATEGORY_RENDER,
-            "%s: texture_id=%s. Found spritesheet %s, but"
-            " no sub-region matches %s\n",
-            scene_object.id.c_str(),
-            scene_object.texture->texture_id.c_str(),
-            scene_spritesheet.id.c_str(),
-            subtexture.c_str());
+    RenderList &tiles = node.repeats.tiles;
+    for (size_t i = 0; i < tiles.size();) {
+        const PositionComponent *position =
+            positions.Find(node.repeat_owners[i]);
+        if (!position) {
+            node.repeats.SwapRemove(i);
+            node.repeat_owners[i] = node.repeat_owners.back();
+            node.repeat_owners.pop_back();
+            if (i < node.baked_repeats.size()) {
+                swap(node.baked_repeats[i], node.baked_repeats.back());
+                node.baked_repeats.pop_back();
+            }
+            continue;
+        }
+        tiles.x[i] = position->x;
+        tiles.y[i] = position->y;
+        ++i;
+    }
+    return moved;
+}
+
+void RenderSystem::SyncAnimations(const World &world) {
+    const AnimationPool &animations = world.animations();
+    if (animations.version() == synced_animations_version_) {
         return;
     }
+    synced_animations_version_ = animations.version();
 
-    if (scene_object.texture_repeat) {
-        RepeatingRender render;
-        FillSheetSimple(iter, scene_object, render);
-        render.repeat_x = scene_object.texture_repeat->repeat_x;
-        render.repeat_y = scene_object.texture_repeat->repeat_y;
+    for (auto &node: nodes_) {
+        if (!SyncNodeAnimations(animations, node)) {
+            continue;
+        }
+        node.corners_stale = true;
+        UpdateGrid(node);
+    }
+}
 
-        SDL_LogInfo(SDL_LOG_CATEGORY_RENDER,
-            "Creating sprite repeating render\n");
-        node.repeating_renders.emplace_back(move(render));
-    } else {
-        SimpleRender render;
-        FillSheetSimple(iter, scene_object, render);
-
-        SDL_LogInfo(SDL_LOG_CATEGORY_RENDER,
-            "Creating sprite simple render\n");
-        node.simple_renders.emplace_back(move(render));
-    }
-}
-
-void RenderSystem::FillSheetSimple(
-        const std::vector<SceneSceneSpritesheetRegion>::const_iterator
-            &iter,
-        const SceneObject &scene_object,
-        SimpleRender &render) const {
-    render.destination.x = scene_object.x;
-    render.destination.y = scene_object.y;
-    render.destination.w = iter->width;
-    render.destination.h = iter->height;
-    render.clip.x = iter->x;
-    render.clip.y = iter->y;
-    render.clip.w = iter->width;
-    render.clip.h = iter->width;
-}
-
-void RenderSystem::ProcessObjectForTextureReferences(
-        const SceneObject &scene_object,
-        const SceneTexture &scene_texture,
-        Node &node) const {
-    if (!scene_object.texture
-            || scene_object.texture->texture_id
-                != scene_texture.id) {
+bool RenderSystem::SyncNodeAnimations(
+        const AnimationPool &animations,
+        Node &node) {
+    if (!node.from_spritesheet) {
+        return false;
+    }
+
+    RenderList &sprites = node.sprites;
+    if (node.animated_stale) {
+        node.animated_sprites.clear();
+        if (!animations.empty()) {
+            for (size_t i = 0; i < sprites.size(); ++i) {
+                if (animations.Has(node.sprite_owners[i])) {
+                    node.animated_sprites.push_back(
+                        static_cast<uint32_t>(i));
+                }
+            }
+        }
+        node.animated_stale = false;
+    }
+
+    // Frames may differ in size, which moves the sprite's bounds.
+    bool resized = false;
+    const vector<int> &regions = animations.animations().region;
+    for (uint32_t slot: node.animated_sprites) {
+        int index = animations.IndexOf(node.sprite_owners[slot]);
+        if (index < 0) {
+            continue;
+        }
+        int clip = node.region_clips[regions[index]];
+        if (sprites.clip[slot] == clip) {
+            continue;
+        }
+        const SDL_Rect &rect = node.clips[clip];
+        sprites.clip[slot] = clip;
+        if (sprites.w[slot] != rect.w || sprites.h[slot] != rect.h) {
+            sprites.w[slot] = rect.w;
+            sprites.h[slot] = rect.h;
+            resized = true;
+        }
+    }
+    return resized;
+}
+
+void RenderSystem::SyncTransforms(const World &world) {
+    const auto &transforms = world.transforms();
+    if (transforms.version() == synced_transforms_version_) {
         return;
     }
+    synced_transforms_version_ = transforms.version();
+
+    for (auto &node: nodes_) {
+        bool was_transformed = !node.transformed_sprites.empty();
+        if (!SyncNodeTransforms(transforms, node)) {
+            continue;
+        }
+        node.corners_stale = true;
+        if (was_transformed != !node.transformed_sprites.empty()) {
+            UpdateGrid(node);
+        }
+    }
+}
 
-    if (scene_object.texture_repeat) {
-        RepeatingRender render;
-        FillTextureSimple(node, scene_object, render);
-        render.repeat_x = scene_object.texture_repeat->repeat_x;
-        render.repeat_y = scene_object.texture_repeat->repeat_y;
+void RenderSystem::UpdateGrid(Node &node) {
+    // Nodes with transformed sprites are culled by their corners, so a
+    // grid would be rebuilt whenever they move and never queried.
+    if (node.sprites.size() >= kGridThreshold
+            && node.transformed_sprites.empty()) {
+        node.grid.Build(node.sprites, kGridCellSize);
+    } else if (!node.grid.empty()) {
+        node.grid.Clear();
+    }
+}
 
-        SDL_LogInfo(SDL_LOG_CATEGORY_RENDER,
-            "Creating texture repeating render\n");
-        node.repeating_renders.emplace_back(move(render));
-    } else {
-        SimpleRender render;
-        FillTextureSimple(node, scene_object, render);
+bool RenderSystem::SyncNodeTransforms(
+        const ComponentPool<TransformComponent> &transforms,
+        Node &node) {
+    RenderList &sprites = node.sprites;
+    bool changed = false;
+    if (node.transformed_stale) {
+        node.transformed_sprites.clear();
+        for (size_t i = 0; i < sprites.size(); ++i) {
+            if (transforms.Has(node.sprite_owners[i])) {
+                node.transformed_sprites.push_back(
+                    static_cast<uint32_t>(i));
+                continue;
+            }
+            // The slot may have been handed to an entity without one.
+            sprites.rotation[i] = 0.0f;
+            sprites.scale_x[i] = 1.0f;
+            sprites.scale_y[i] = 1.0f;
+            sprites.pivot_x[i] = 0.5f;
+            sprites.pivot_y[i] = 0.5f;
+        }
+        node.transformed_stale = false;
+        changed = true;
+    }
 
-        SDL_LogInfo(SDL_LOG_CATEGORY_RENDER,
-            "Creating texture simple render\n");
-        node.simple_renders.emplace_back(move(render));
+    for (uint32_t slot: node.transformed_sprites) {
+        const TransformComponent *transform =
+            transforms.Find(node.sprite_owners[slot]);
+        if (!transform) {
+            continue;
+        }
+        if (sprites.rotation[slot] != transform->rotation
+                || sprites.scale_x[slot] != transform->scale_x
+                || sprites.scale_y[slot] != transform->scale_y
+                || sprites.pivot_x[slot] != transform->pivot_x
+                || sprites.pivot_y[slot] != transform->pivot_y) {
+            sprites.rotation[slot] = transform->rotation;
+            sprites.scale_x[slot] = transform->scale_x;
+            sprites.scale_y[slot] = transform->scale_y;
+            sprites.pivot_x[slot] = transform->pivot_x;
+            sprites.pivot_y[slot] = transform->pivot_y;
+            changed = true;
+        }
     }
+    return changed;
 }
 
-void RenderSystem::FillTextureSimple(
-        const Node &node,
-        const SceneObject &scene_object,
-        SimpleRender &render) const {
-    render.destination.x = scene_object.x;
-    render.destination.y = scene_object.y;
-    render.destination.w = node.width;
-    render.destination.h = node.height;
-    render.clip.x = 0;
-    render.clip.y = 0;
-    render.clip.w = node.width;
-    render.clip.h = node.height;
+void RenderSystem::UpdateCorners() {
+    for (auto &node: nodes_) {
+        if (node.corners_stale && !node.transformed_sprites.empty()) {
+            TransformRenderList(node.sprites, node.corners);
+        }
+        node.corners_stale = false;
+    }
+}
+
+RenderSystem::Node* RenderSystem::FindNode(
+        vector<Node> &nodes,
+        Atom id,
+        bool from_spritesheet) {
+    for (auto &node: nodes) {
+        if (node.from_spritesheet == from_spritesheet
+                && node.id == id
+                && node.texture) {
+            return &node;
+        }
+    }
+    return nullptr;
+}
+
+bool RenderSystem::CanReuseRenders(
+        const Node *previous,
+        const Node &current) {
+    // The same cache entry, not reloaded since the previous render lists
+    // were built from its dimensions.
+    return previous
+        && previous->texture == current.texture
+        && previous->texture_generation == current.texture_generation;
+}
+
+void RenderSystem::MoveRenders(Node &from, Node &to) {
+    to.clips = move(from.clips);
+    to.region_clips = move(from.region_clips);
+    to.sprites = move(from.sprites);
+    to.repeats = move(from.repeats);
+    to.sprite_owners = move(from.sprite_owners);
+    to.repeat_owners = move(from.repeat_owners);
+    to.grid = move(from.grid);
+    to.corners = move(from.corners);
+    to.baked_repeats = move(from.baked_repeats);
+}
+
+void RenderSystem::UpdateCollisionMasks(const Node &node) {
+    // Regions are cut from the image mask once, rather than testing
+    // against the whole sheet with an offset on every check.
+    const CollisionMask &image = node.texture.collision_mask();
+    if (image.empty()) {
+        return;
+    }
+    if (!node.from_spritesheet) {
+        collision_masks_.SetTexture(node.scene_index, image);
+        return;
+    }
+
+    vector<CollisionMask> regions;
+    regions.reserve(node.region_clips.size());
+    for (int clip: node.region_clips) {
+        const SDL_Rect &rect = node.clips[clip];
+        regions.push_back(image.Cut(rect.x, rect.y, rect.w, rect.h));
+    }
+    collision_masks_.SetSpritesheet(node.scene_index, move(regions));
+}
+
+void RenderSystem::UpdateCompositeMask(const Node &node) {
+    // Built from the region masks, so only once every part's sheet has
+    // been decoded.
+    const BakedComposite &composite = *node.composite;
+    CollisionMask mask;
+    mask.Reset(composite.width, composite.height);
+    for (const auto &part: composite.parts) {
+        const CollisionMask *part_mask = collision_masks_.Find(
+            -1, part.spritesheet_index, part.region_index);
+        if (!part_mask) {
+            return;
+        }
+        mask.Paste(
+            *part_mask, part.destination.x, part.destination.y, part.flip);
+    }
+    collision_masks_.SetComposite(node.scene_index, move(mask));
+}
+
+void RenderSystem::FillTextureClips(Node &node) {
+    SDL_Rect whole = { 0, 0, node.width, node.height };
+    node.clips.Clear();
+    node.clips.Intern(whole);
+}
+
+void RenderSystem::FillSpritesheetClips(
+        const SceneSpritesheet &scene_spritesheet,
+        Node &node) {
+    node.clips.Clear();
+    node.region_clips.clear();
+    node.region_clips.reserve(scene_spritesheet.regions.size());
+    for (const auto &region: scene_spritesheet.regions) {
+        SDL_Rect rect = { region.x, region.y, region.width, region.height };
+        node.region_clips.push_back(node.clips.Intern(rect));
+    }
+}
+
+int RenderSystem::SpriteClip(
+        const SpriteComponent &sprite,
+        const Node &node) {
+    // Texture and composite nodes have a single clip covering the whole
+    // image.
+    return sprite.spritesheet_index >= 0
+        ? node.region_clips[sprite.region_index]
+        : 0;
+}
+
+void RenderSystem::BindSprite(
+        Entity entity,
+        const PositionComponent &position,
+        const TextureRepeatComponent *repeat,
+        int clip,
+        Node &node) {
+    const SDL_Rect &rect = node.clips[clip];
+    if (repeat) {
+        node.repeats.Add(
+            position.x,
+            position.y,
+            rect.w,
+            rect.h,
+            clip,
+            repeat->repeat_x,
+            repeat->repeat_y);
+        node.repeat_owners.push_back(entity);
+    } else {
+        node.sprites.Add(
+            position.x,
+            position.y,
+            rect.w,
+            rect.h,
+            clip);
+        node.sprite_owners.push_back(entity);
+    }
 }
 
 void RenderSystem::CreateRendererFromScene(const Scene &scene) {
@@ -209,10 +789,19 @@ void RenderSystem::CreateRendererFromScene(const Scene &scene) {
 		SDL_LOG_CATEGORY_RENDER,
 		"Creating renderer...\n");
 
+	Uint32 flags = SDL_RENDERER_ACCELERATED;
+	if (vsync_) {
+		flags |= SDL_RENDERER_PRESENTVSYNC;
+	} else {
+		SDL_LogInfo(
+			SDL_LOG_CATEGORY_RENDER,
+			"VSYNC disabled: presenting uncapped\n");
+	}
+
 	renderer_ = RendererPtr(SDL_CreateRenderer(
 		window_.get(),
 		-1,
-		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
+		flags));
 	if (!renderer_) {
 		auto error_message = SDL_GetError();
 		SDL_LogError(
@@ -221,6 +810,41 @@ void RenderSystem::CreateRendererFromScene(const Scene &scene) {
 			error_message);
 		throw runtime_error(error_message);
 	}
+
+	texture_cache_.set_renderer(renderer_.get());
+}
+
+void RenderSystem::CreateOffscreenRendererFromScene(const Scene &scene) {
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_RENDER,
+		"Creating offscreen renderer...\n");
+
+	offscreen_ = SurfacePtr(SDL_CreateRGBSurfaceWithFormat(
+		0,
+		scene.width(),
+		scene.height(),
+		32,
+		SDL_PIXELFORMAT_ARGB8888));
+	if (!offscreen_) {
+		auto error_message = SDL_GetError();
+		SDL_LogError(
+			SDL_LOG_CATEGORY_RENDER,
+			"Failed to create offscreen surface: %s\n",
+			error_message);
+		throw runtime_error(error_message);
+	}
+
+	renderer_ = RendererPtr(SDL_CreateSoftwareRenderer(offscreen_.get()));
+	if (!renderer_) {
+		auto error_message = SDL_GetError();
+		SDL_LogError(
+			SDL_LOG_CATEGORY_RENDER,
+			"Failed to create software renderer: %s\n",
+			error_message);
+		throw runtime_error(error_message);
+	}
+
+	texture_cache_.set_renderer(renderer_.get());
 }
 
 void RenderSystem::CreateWindowFromScene(const Scene &scene) {
@@ -245,7 +869,20 @@ void RenderSystem::CreateWindowFromScene(const Scene &scene) {
 	}
 }
 
+void RenderSystem::UpdateViewportFromScene(const Scene &scene) {
+	viewport_.x = 0;
+	viewport_.y = 0;
+	viewport_.w = scene.width();
+	viewport_.h = scene.height();
+}
+
 void RenderSystem::UpdateWindowFromScene(const Scene &scene) {
+	if (!window_) {
+		// The software renderer is bound to its surface; recreating both
+		// would drop every texture, so headless output keeps its size.
+		return;
+	}
+
 	SDL_LogInfo(
 		SDL_LOG_CATEGORY_RENDER,
 		"Updating window...\n");
@@ -258,73 +895,546 @@ void RenderSystem::UpdateWindowFromScene(const Scene &scene) {
 		SDL_WINDOWPOS_CENTERED);
 }
 
-RenderSystem::Node RenderSystem::LoadNode(const std::string &path) const {
-    SDL_LogInfo(
-        SDL_LOG_CATEGORY_RENDER,
-        "Loading %s...\n",
-        path.c_str());
+RenderSystem::Node RenderSystem::LoadNode(const std::string &path) {
+    Node node;
+    node.id = kNoAtom;
+    node.from_spritesheet = false;
+    node.scene_index = -1;
+    node.composite = nullptr;
+    node.animated_stale = true;
+    node.transformed_stale = true;
+    node.corners_stale = true;
+    node.texture = texture_cache_.Acquire(path);
+    node.texture_generation = node.texture.generation();
+    node.width = node.texture.info().width;
+    node.height = node.texture.info().height;
+    return node;
+}
+
+RenderSystem::Node RenderSystem::LoadCompositeNode(
+        const Scene &scene,
+        int composite_index,
+        map<string, BakedComposite> &previous) {
+    const SceneComposite &scene_composite =
+        scene.composites()[composite_index];
+    vector<BakedComposite::Part> parts(scene_composite.part_count);
+    for (int i = 0; i < scene_composite.part_count; ++i) {
+        const SceneCompositePart &scene_part = scene_composite.parts[i];
+        const SceneSpritesheet &sheet =
+            scene.spritesheets()[scene_part.spritesheet_index];
+        const SceneSceneSpritesheetRegion &region =
+            sheet.regions[scene_part.region_index];
 
-    SurfacePtr cpu_mem(IMG_Load(path.c_str()));
-    if (!cpu_mem) {
-        auto error_message = IMG_GetError();
-        SDL_LogError(
-            SDL_LOG_CATEGORY_RENDER,
-            "Failed to load image: %s\n",
-            error_message);
-        throw runtime_error(error_message);
+        BakedComposite::Part &part = parts[i];
+        part.source = texture_cache_.Acquire(sheet.image_path.str());
+        part.source_generation = part.source.generation();
+        part.spritesheet_index = scene_part.spritesheet_index;
+        part.region_index = scene_part.region_index;
+        part.clip.x = region.x;
+        part.clip.y = region.y;
+        part.clip.w = region.width;
+        part.clip.h = region.height;
+        part.destination.x = scene_part.x;
+        part.destination.y = scene_part.y;
+        part.destination.w = region.width;
+        part.destination.h = region.height;
+        part.flip = scene_part.flip;
     }
 
-    Node node;
-    node.width = cpu_mem->w;
-    node.height = cpu_mem->h;
-    node.texture = TexturePtr(SDL_CreateTextureFromSurface(
-        renderer_.get(), cpu_mem.get()));
-    if (!node.texture) {
-        auto error_message = SDL_GetError();
-        SDL_LogError(
-            SDL_LOG_CATEGORY_RENDER,
-            "Failed to create texture: %s\n",
-            error_message);
-        throw runtime_error(error_message);
+    BakedComposite composite;
+    composite.width = 0;
+    composite.height = 0;
+    composite.baked = false;
+    string key = scene_composite.key.str();
+    auto iter = previous.find(key);
+    if (iter != end(previous)) {
+        composite = move(iter->second);
+        previous.erase(iter);
+    }
+
+    // Keys name the regions of the parts, not where they are in their
+    // sheet, so a reused composite is baked again if any part moved.
+    bool same_parts = composite.parts.size() == parts.size();
+    for (size_t i = 0; same_parts && i < parts.size(); ++i) {
+        const BakedComposite::Part &baked = composite.parts[i];
+        same_parts = baked.source == parts[i].source
+            && AreRectsEqual(baked.clip, parts[i].clip)
+            && AreRectsEqual(baked.destination, parts[i].destination)
+            && baked.flip == parts[i].flip;
+        parts[i].source_generation = baked.source_generation;
+    }
+    if (!same_parts) {
+        composite.baked = false;
+    }
+    if (composite.width != scene_composite.width
+            || composite.height != scene_composite.height) {
+        composite.texture.reset();
+        composite.baked = false;
     }
+    composite.parts = move(parts);
+    composite.width = scene_composite.width;
+    composite.height = scene_composite.height;
 
-    return move(node);
+    Node node;
+    node.id = InternAtom(scene_composite.key);
+    node.from_spritesheet = false;
+    node.scene_index = composite_index;
+    node.composite = &baked_composites_.emplace(
+        key, move(composite)).first->second;
+    node.texture_generation = 0;
+    node.width = scene_composite.width;
+    node.height = scene_composite.height;
+    node.animated_stale = true;
+    node.transformed_stale = true;
+    node.corners_stale = true;
+    FillTextureClips(node);
+    return node;
 }
 
-void RenderSystem::Update(float /*elapsed_milliseconds*/) const {
+void RenderSystem::Update(
+		const World &world,
+		float /*elapsed_milliseconds*/,
+		float /*interpolation_alpha*/) {
+	if (texture_cache_.Pump()) {
+		RefreshStreamedNodes();
+	}
+	SyncPositions(world);
+	SyncAnimations(world);
+	SyncTransforms(world);
+	UpdateCorners();
+
 	SDL_RenderClear(renderer_.get());
+	batch_.Begin(renderer_.get());
 
 	for (const auto &node: nodes_) {
-		for (const auto &simple: node.simple_renders) {
+		SubmitNode(node);
+	}
+	SubmitParticles(world.particles());
+	SubmitHud();
+
+	batch_.Flush();
+	SDL_RenderPresent(renderer_.get());
+}
+
+void RenderSystem::SubmitNode(const Node &node) {
+	if ((!node.texture.get() && !node.composite)
+			|| (node.sprites.empty() && node.repeats.empty())) {
+		return;
+	}
+
+	bool transformed = !node.transformed_sprites.empty();
+	visible_.clear();
+	if (transformed) {
+		CullQuads(node.corners, viewport_, visible_);
+	} else if (!node.grid.empty()) {
+		node.grid.Query(node.sprites, viewport_, visible_);
+	} else {
+		CullRenderList(node.sprites, viewport_, visible_);
+	}
+	batch_.AddCulled(
+		static_cast<unsigned int>(node.sprites.size() - visible_.size()));
+
+	if (node.composite && !node.composite->baked) {
+		SubmitCompositeParts(node);
+		return;
+	}
+
+	batch_.SetTexture(
+		node.composite
+			? node.composite->texture.get()
+			: node.texture.get(),
+		node.width,
+		node.height);
+	if (transformed) {
+		batch_.Add(node.corners, node.sprites, node.clips, visible_);
+	} else {
+		batch_.Add(node.sprites, node.clips, visible_);
+	}
+
+	SubmitRepeats(node);
+}
+
+void RenderSystem::SubmitParticles(const ParticlePool &particles) {
+	const int *frames = particles.frames().data();
+	for (const auto &emitter: particles.emitters()) {
+		int spritesheet = emitter.settings.spritesheet_index;
+		if (0 == emitter.particles.size()
+				|| spritesheet < 0
+				|| spritesheet >= static_cast<int>(
+					spritesheet_nodes_.size())) {
+			continue;
+		}
+		const Node &node = nodes_[spritesheet_nodes_[spritesheet]];
+		if (!node.texture.get()) {
+			continue;
+		}
+
+		batch_.SetTexture(node.texture.get(), node.width, node.height);
+		batch_.Add(
+			emitter.particles,
+			emitter.settings,
+			frames,
+			node.region_clips,
+			node.clips);
+	}
+}
+
+void RenderSystem::SubmitHud() {
+	int spritesheet = hud_.spritesheet_index();
+	if (spritesheet < 0) {
+		return;
+	}
+	const Node &node = nodes_[spritesheet_nodes_[spritesheet]];
+	if (!node.texture.get()) {
+		return;
+	}
+
+	batch_.SetTexture(node.texture.get(), node.width, node.height);
+	hud_.Submit(batch_, node.clips);
+}
+
+void RenderSystem::FinishLoading() {
+	texture_cache_.WaitAll();
+	RefreshStreamedNodes();
+}
+
+void RenderSystem::RefreshStreamedNodes() {
+	for (auto &node: nodes_) {
+		if (node.texture.generation() != node.texture_generation) {
+			RefreshNodeTexture(node);
+		}
+	}
+	RefreshComposites();
+}
+
+void RenderSystem::RefreshNodeTexture(Node &node) {
+	node.texture_generation = node.texture.generation();
+	node.width = node.texture.info().width;
+	node.height = node.texture.info().height;
+
+	// Texture sprites are sized after the whole image, which is only known
+	// once it has been decoded. Spritesheet sprites use region sizes.
+	if (!node.from_spritesheet) {
+		FillTextureClips(node);
+		fill(begin(node.sprites.w), end(node.sprites.w), node.width);
+		fill(begin(node.sprites.h), end(node.sprites.h), node.height);
+		fill(begin(node.repeats.tiles.w), end(node.repeats.tiles.w),
+			node.width);
+		fill(begin(node.repeats.tiles.h), end(node.repeats.tiles.h),
+			node.height);
+		UpdateGrid(node);
+		node.corners_stale = true;
+	}
+
+	UpdateCollisionMasks(node);
+	BakeRepeats(node);
+}
+
+void RenderSystem::SubmitRepeats(const Node &node) {
+	const RenderList &tiles = node.repeats.tiles;
+	for (size_t i = 0; i < node.repeats.size(); ++i) {
+		int repeat_x = node.repeats.repeat_x[i];
+		int repeat_y = node.repeats.repeat_y[i];
+
+		SDL_Texture *baked = i < node.baked_repeats.size()
+			? node.baked_repeats[i].get()
+			: nullptr;
+		if (baked) {
+			// One quad showing the part of the baked texture that is on
+			// screen.
+			SDL_Rect bounds = {
+				tiles.x[i],
+				tiles.y[i],
+				tiles.w[i] * repeat_x,
+				tiles.h[i] * repeat_y
+			};
+			SDL_Rect destination;
+			if (!SDL_IntersectRect(&bounds, &viewport_, &destination)) {
+				batch_.AddCulled(1);
+				continue;
+			}
+
+			SDL_Rect clip = {
+				destination.x - bounds.x,
+				destination.y - bounds.y,
+				destination.w,
+				destination.h
+			};
+			batch_.SetTexture(baked, bounds.w, bounds.h);
+			batch_.Add(clip, destination);
+			continue;
+		}
+
+		RepeatRange range;
+		if (!ClipRepeatRange(
+				tiles.x[i], tiles.y[i], tiles.w[i], tiles.h[i],
+				repeat_x, repeat_y, viewport_, range)) {
+			batch_.AddCulled(static_cast<unsigned int>(repeat_x * repeat_y));
+			continue;
+		}
+
+		int visible_x = range.last_x - range.first_x + 1;
+		int visible_y = range.last_y - range.first_y + 1;
+		batch_.AddCulled(static_cast<unsigned int>(
+			repeat_x * repeat_y - visible_x * visible_y));
+
+		batch_.SetTexture(node.texture.get(), node.width, node.height);
+		SDL_Rect destination = { 0, 0, tiles.w[i], tiles.h[i] };
+		const SDL_Rect &clip = node.clips[tiles.clip[i]];
+		for (int y = range.first_y; y <= range.last_y; ++y) {
+			destination.y = tiles.y[i] + tiles.h[i] * y;
+			for (int x = range.first_x; x <= range.last_x; ++x) {
+				destination.x = tiles.x[i] + tiles.w[i] * x;
+				batch_.Add(clip, destination);
+			}
+		}
+	}
+}
+
+void RenderSystem::SubmitCompositeParts(const Node &node) {
+	// Until the composite is baked, or where it cannot be, every part is
+	// a quad of its own. Flipped parts get a mirrored quad.
+	const RenderList &sprites = node.sprites;
+	for (int i: visible_) {
+		for (const auto &part: node.composite->parts) {
+			if (!part.source.get()) {
+				continue;
+			}
+
+			SDL_Rect destination = {
+				sprites.x[i] + part.destination.x,
+				sprites.y[i] + part.destination.y,
+				part.destination.w,
+				part.destination.h
+			};
+			if (part.flip) {
+				destination.x += destination.w;
+				destination.w = -destination.w;
+			}
+			batch_.SetTexture(
+				part.source.get(),
+				part.source.info().width,
+				part.source.info().height);
+			batch_.Add(part.clip, destination);
+		}
+	}
+}
+
+void RenderSystem::RefreshComposites() {
+	for (const auto &node: nodes_) {
+		if (!node.composite) {
+			continue;
+		}
+
+		BakedComposite &composite = *node.composite;
+		bool stale = !composite.baked;
+		for (const auto &part: composite.parts) {
+			if (part.source.generation() != part.source_generation) {
+				stale = true;
+			}
+		}
+		if (stale) {
+			BakeComposite(composite);
+		}
+		UpdateCompositeMask(node);
+	}
+}
+
+bool RenderSystem::BakeComposite(BakedComposite &composite) {
+	for (const auto &part: composite.parts) {
+		if (!part.source.get()) {
+			return false;
+		}
+	}
+	if (!SDL_RenderTargetSupported(renderer_.get())) {
+		return false;
+	}
+
+	if (!composite.texture) {
+		composite.texture = TexturePtr(SDL_CreateTexture(
+			renderer_.get(),
+			SDL_PIXELFORMAT_ARGB8888,
+			SDL_TEXTUREACCESS_TARGET,
+			composite.width,
+			composite.height));
+		if (!composite.texture) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_RENDER,
+				"Failed to create composite target: %s\n",
+				SDL_GetError());
+			return false;
+		}
+
+		// Renderers without custom blend modes draw the composite with
+		// slightly dark translucent edges instead.
+		if (SDL_SetTextureBlendMode(
+				composite.texture.get(),
+				PremultipliedBlendMode()) != 0) {
+			SDL_SetTextureBlendMode(
+				composite.texture.get(), SDL_BLENDMODE_BLEND);
+		}
+	}
+
+	RenderCompositeParts(composite);
+	for (auto &part: composite.parts) {
+		part.source_generation = part.source.generation();
+	}
+	composite.baked = true;
+
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_RENDER,
+		"Baked %lu part(s) into a %dx%d composite\n",
+		static_cast<unsigned long>(composite.parts.size()),
+		composite.width,
+		composite.height);
+	return true;
+}
+
+void RenderSystem::RenderCompositeParts(const BakedComposite &composite) {
+	SDL_SetRenderTarget(renderer_.get(), composite.texture.get());
+	SDL_SetRenderDrawColor(renderer_.get(), 0, 0, 0, 0);
+	SDL_RenderClear(renderer_.get());
+
+	// Unlike repeat tiles, parts overlap and so are blended. Blending onto
+	// the transparent target leaves colours multiplied by alpha, which is
+	// what the composite's blend mode expects.
+	for (const auto &part: composite.parts) {
+		SDL_RenderCopyEx(
+			renderer_.get(),
+			part.source.get(),
+			&part.clip,
+			&part.destination,
+			0.0,
+			nullptr,
+			part.flip ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE);
+	}
+
+	SDL_SetRenderTarget(renderer_.get(), nullptr);
+	SDL_SetRenderDrawColor(renderer_.get(), 0, 0, 0, 255);
+}
+
+void RenderSystem::BakeRepeats(Node &node) {
+	node.baked_repeats.clear();
+	if (!bake_repeats_ || node.repeats.empty() || !node.texture.get()) {
+		return;
+	}
+
+	if (!SDL_RenderTargetSupported(renderer_.get())) {
+		SDL_LogWarn(
+			SDL_LOG_CATEGORY_RENDER,
+			"Render targets not supported: drawing repeats per tile\n");
+		return;
+	}
+
+	node.baked_repeats.reserve(node.repeats.size());
+	for (size_t i = 0; i < node.repeats.size(); ++i) {
+		node.baked_repeats.emplace_back(BakeRepeat(node, i));
+	}
+}
+
+TexturePtr RenderSystem::BakeRepeat(const Node &node, size_t index) {
+	const RenderList &tiles = node.repeats.tiles;
+	int width = tiles.w[index] * node.repeats.repeat_x[index];
+	int height = tiles.h[index] * node.repeats.repeat_y[index];
+
+	SDL_RendererInfo info;
+	if (SDL_GetRendererInfo(renderer_.get(), &info) != 0
+			|| width <= 0
+			|| height <= 0
+			|| (info.max_texture_width > 0
+				&& width > info.max_texture_width)
+			|| (info.max_texture_height > 0
+				&& height > info.max_texture_height)
+			|| static_cast<long long>(width) * height > kMaxBakedPixels) {
+		SDL_LogInfo(
+			SDL_LOG_CATEGORY_RENDER,
+			"%s: %dx%d repeat too large to bake\n",
+			AtomName(node.id).c_str(),
+			width,
+			height);
+		return TexturePtr();
+	}
+
+	TexturePtr target(SDL_CreateTexture(
+		renderer_.get(),
+		SDL_PIXELFORMAT_ARGB8888,
+		SDL_TEXTUREACCESS_TARGET,
+		width,
+		height));
+	if (!target) {
+		SDL_LogWarn(
+			SDL_LOG_CATEGORY_RENDER,
+			"Failed to create repeat target: %s\n",
+			SDL_GetError());
+		return TexturePtr();
+	}
+
+	SDL_SetTextureBlendMode(target.get(), SDL_BLENDMODE_BLEND);
+	RenderRepeatTiles(node, index, target.get());
+
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_RENDER,
+		"%s: baked %dx%d repeat into a %dx%d texture\n",
+		AtomName(node.id).c_str(),
+		node.repeats.repeat_x[index],
+		node.repeats.repeat_y[index],
+		width,
+		height);
+	return target;
+}
+
+void RenderSystem::RenderRepeatTiles(
+		const Node &node,
+		size_t index,
+		SDL_Texture *target) {
+	const RenderList &tiles = node.repeats.tiles;
+	const SDL_Rect &clip = node.clips[tiles.clip[index]];
+
+	SDL_SetRenderTarget(renderer_.get(), target);
+	SDL_SetRenderDrawColor(renderer_.get(), 0, 0, 0, 0);
+	SDL_RenderClear(renderer_.get());
+
+	// Copy the pixels as they are; blending against the transparent target
+	// would darken translucent edges.
+	SDL_BlendMode blend_mode;
+	SDL_GetTextureBlendMode(node.texture.get(), &blend_mode);
+	SDL_SetTextureBlendMode(node.texture.get(), SDL_BLENDMODE_NONE);
+
+	SDL_Rect destination = { 0, 0, tiles.w[index], tiles.h[index] };
+	for (int y = 0; y < node.repeats.repeat_y[index]; ++y) {
+		destination.y = tiles.h[index] * y;
+		for (int x = 0; x < node.repeats.repeat_x[index]; ++x) {
+			destination.x = tiles.w[index] * x;
 			SDL_RenderCopy(
 				renderer_.get(),
 				node.texture.get(),
-				&simple.clip,
-				&simple.destination);
+				&clip,
+				&destination);
 		}
+	}
 
-		for (const auto &repeating: node.repeating_renders) {
-			for (int y = 0; y < repeating.repeat_y; ++y) {
-				SDL_Rect rt2 = repeating.destination;
-				rt2.y =
-					repeating.destination.y
-					+ repeating.destination.h * y;
-
-				for (int x = 0; x < repeating.repeat_x; ++x) {
-					rt2.x =
-						repeating.destination.x
-						+ repeating.destination.w * x;
-					SDL_RenderCopy(
-						renderer_.get(),
-						node.texture.get(),
-						&repeating.clip,
-						&rt2);
-				}
+	SDL_SetTextureBlendMode(node.texture.get(), blend_mode);
+	SDL_SetRenderTarget(renderer_.get(), nullptr);
+	SDL_SetRenderDrawColor(renderer_.get(), 0, 0, 0, 255);
+}
+
+void RenderSystem::RestoreRenderTargets() {
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_RENDER,
+		"Restoring render targets...\n");
+
+	for (const auto &node: nodes_) {
+		for (size_t i = 0; i < node.baked_repeats.size(); ++i) {
+			if (node.baked_repeats[i]) {
+				RenderRepeatTiles(node, i, node.baked_repeats[i].get());
 			}
 		}
 	}
-
-	SDL_RenderPresent(renderer_.get());
+	for (const auto &entry: baked_composites_) {
+		if (entry.second.baked) {
+			RenderCompositeParts(entry.second);
+		}
+	}
 }
 
 void RenderSystem::SdlApiTraits::Create(Uint32 flags) {
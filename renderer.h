@@ -24,18 +24,29 @@ THE SOFTWARE.
 #define FOO_ASTEROIDS_RENDERER_H_
 
 #include "scene.h"
+#include "scene_diff.h"
+#include "texture_cache.h"
 #include "handle.h"
 #include "smart_pointers.h"
+#include "sprite_batch.h"
+#include "render_list.h"
+#include "culling.h"
+#include "collision_mask.h"
+#include "hud.h"
+#include "world.h"
 #include "SDL_rect.h"
 #include <vector>
 #include <utility>
 #include <map>
+#include <memory>
 
 struct SDL_Renderer;
 struct SDL_Texture;
 
 namespace foo {
 
+class ThreadPool;
+
 class RenderSystem {
 	struct SdlApiTraits {
 		void Create(unsigned int flags);
@@ -45,27 +56,95 @@ class RenderSystem {
 		void Create(int flags);
 		void Destroy();
 	};
-	struct SimpleRender {
-		SDL_Rect destination;
-		SDL_Rect clip;
-	};
-	struct RepeatingRender : public SimpleRender {
-		int repeat_x;
-		int repeat_y;
+	// Parts of a composite rendered into a texture of its own. Baked
+	// pixels have their alpha premultiplied.
+	struct BakedComposite {
+		struct Part {
+			CachedTexture source;
+			unsigned int source_generation;
+			int spritesheet_index;
+			int region_index;
+			SDL_Rect clip;
+			SDL_Rect destination;
+			bool flip;
+		};
+		std::vector<Part> parts;
+		TexturePtr texture;
+		int width;
+		int height;
+		// Set once texture holds the current pixels of every part; until
+		// then the parts are drawn one by one.
+		bool baked;
 	};
 	struct Node {
-		TexturePtr texture;
+		Atom id;
+		bool from_spritesheet;
+		// Index in Scene::textures(), Scene::spritesheets() or
+		// Scene::composites().
+		int scene_index;
+		// Drawn instead of texture by the node of a composite.
+		BakedComposite *composite;
+		CachedTexture texture;
+		unsigned int texture_generation;
 		int width;
 		int height;
-		std::vector<SimpleRender> simple_renders;
-		std::vector<RepeatingRender> repeating_renders;
+		ClipTable clips;
+		// Clip index of every spritesheet region.
+		std::vector<int> region_clips;
+		RenderList sprites;
+		RepeatList repeats;
+		// Entity drawn by each sprite and repeat.
+		std::vector<Entity> sprite_owners;
+		std::vector<Entity> repeat_owners;
+		// Sprites whose owner is animated; rebuilt when stale because
+		// sprites were bound or removed.
+		std::vector<uint32_t> animated_sprites;
+		bool animated_stale;
+		// Sprites whose owner has a transform, kept like animated_sprites.
+		// Nodes with any are culled and drawn from corners, computed
+		// again when corners_stale because sprites moved, turned or
+		// changed size. Repeats and unbaked composites are drawn
+		// untransformed.
+		std::vector<uint32_t> transformed_sprites;
+		bool transformed_stale;
+		QuadCorners corners;
+		bool corners_stale;
+		// Built for large sprite lists only; smaller ones are culled by
+		// testing every sprite.
+		SpatialGrid grid;
+		// One entry per repeat: all tiles pre-rendered into a single
+		// texture, or null if the repeat is drawn tile by tile.
+		std::vector<TexturePtr> baked_repeats;
 	};
 
 	Handle<SdlApiTraits> sdl_api_;
 	Handle<SdlImageApiTraits> sdl_image_api_;
 	WindowPtr window_;
+	// Target of the software renderer in headless mode.
+	SurfacePtr offscreen_;
 	RendererPtr renderer_;
+	std::unique_ptr<ThreadPool> decode_pool_;
+	TextureCache texture_cache_;
 	std::vector<Node> nodes_;
+	// Node of every spritesheet of the current scene, by index.
+	std::vector<int> spritesheet_nodes_;
+	Hud hud_;
+	// Keyed by SceneComposite::key and kept while the scenes processed
+	// use it, so reloads do not bake unchanged composites again.
+	std::map<std::string, BakedComposite> baked_composites_;
+	CollisionMasks collision_masks_;
+	SpriteBatch batch_;
+	SDL_Rect viewport_;
+	std::vector<int> visible_;
+	// World::positions().version() last copied into the render lists.
+	unsigned int synced_positions_version_;
+	// World::animations().version() last copied into the render lists.
+	unsigned int synced_animations_version_;
+	// World::transforms().version() last copied into the render lists.
+	unsigned int synced_transforms_version_;
+	bool vsync_;
+	bool bake_repeats_;
+	bool headless_;
 
 public:
 	RenderSystem();
@@ -77,38 +156,210 @@ public:
 	RenderSystem& operator=(RenderSystem&&) = delete;
 
 	void Initialize();
-	void ProcessScene(const Scene &scene);
-	void Update(float elapsed_milliseconds) const;
+
+	// Loads the images of scene and builds render lists for the sprites
+	// of world, which must have been instantiated from it.
+	void ProcessScene(const Scene &scene, const World &world);
+
+	// Applies a reloaded version of the scene previously passed to
+	// ProcessScene(). Images whose files did not change are kept on the
+	// GPU, and render lists are rebuilt only for nodes referenced by
+	// changed objects.
+	void ProcessScene(
+		const Scene &scene,
+		const World &world,
+		const SceneDiff &diff);
+
+	// Draws a frame. Sprites follow the positions in world and disappear
+	// with their entities; sprites cannot be added without processing
+	// the scene again. Particles are drawn on top of every sprite, and
+	// the HUD on top of them.
+	void Update(
+		const World &world,
+		float elapsed_milliseconds,
+		float interpolation_alpha);
+
+	// Must be set before Initialize(). A headless RenderSystem uses SDL's
+	// dummy video driver and a software renderer drawing to an offscreen
+	// surface, so it runs on machines without a display or GPU.
+	inline void
+	set_headless(bool headless) { headless_ = headless; }
+
+	inline bool
+	headless() const { return headless_; }
+
+	// Must be set before the first call to ProcessScene(), which creates
+	// the renderer.
+	inline void
+	set_vsync(bool vsync) { vsync_ = vsync; }
+
+	inline bool
+	vsync() const { return vsync_; }
+
+	// When enabled, repeated sprites are rendered once into a target
+	// texture while the scene is processed and then drawn as one quad.
+	// Composites are baked regardless.
+	inline void
+	set_bake_repeats(bool bake_repeats) { bake_repeats_ = bake_repeats; }
+
+	inline bool
+	bake_repeats() const { return bake_repeats_; }
+
+	// Images are decoded on worker threads and uploaded as they become
+	// ready from Update(); nodes whose texture has not arrived yet are not
+	// drawn. Blocks until everything requested so far is resident.
+	void FinishLoading();
+
+	inline bool
+	IsLoading() const { return texture_cache_.pending_count() != 0; }
+
+	// Render target contents are lost when some drivers reset the device;
+	// call when SDL reports SDL_RENDER_TARGETS_RESET.
+	void RestoreRenderTargets();
+
+	inline TextureCache&
+	texture_cache() { return texture_cache_; }
+
+	inline const TextureCache&
+	texture_cache() const { return texture_cache_; }
+
+	// Draw calls and quads submitted by the last call to Update().
+	inline const RenderStats&
+	stats() const { return batch_.stats(); }
+
+	// Opaque pixels of every texture and spritesheet region of the
+	// current scene, available as soon as their image has been decoded.
+	inline const CollisionMasks&
+	collision_masks() const { return collision_masks_; }
+
+	// Drawn on top of everything with the numerals of the first
+	// spritesheet of the scene that has them.
+	inline Hud&
+	hud() { return hud_; }
+
+	inline const Hud&
+	hud() const { return hud_; }
+
+	// Worker threads created by Initialize(), shared with scene loading.
+	inline ThreadPool*
+	worker_pool() { return decode_pool_.get(); }
 
 private:
 	void UpdateWindowFromScene(const Scene &scene);
 	void CreateWindowFromScene(const Scene &scene);
 	void CreateRendererFromScene(const Scene &scene);
-	void UpdateNodesFromScene(const Scene &scene);
+	void CreateOffscreenRendererFromScene(const Scene &scene);
+	void UpdateNodesFromScene(
+		const Scene &scene,
+		const World &world,
+		const SceneDiff *diff);
+	void UpdateViewportFromScene(const Scene &scene);
 
-	Node LoadNode(const std::string &path) const;
+	Node LoadNode(const std::string &path);
 
-	void FillTextureSimple(
-		const Node &node,
-		const SceneObject &scene_object,
-		SimpleRender &render) const;
+	Node LoadCompositeNode(
+		const Scene &scene,
+		int composite_index,
+		std::map<std::string, BakedComposite> &previous);
 
-	void ProcessObjectForTextureReferences(
-		const SceneObject &scene_object,
-		const SceneTexture &scene_texture,
-		Node &node) const;
+	static Node* FindNode(
+		std::vector<Node> &nodes,
+		Atom id,
+		bool from_spritesheet);
 
-	void ProcessObjectForSpritesheetReferences(
-		const SceneObject &scene_object,
+	static bool CanReuseRenders(
+		const Node *previous,
+		const Node &current);
+
+	static void FillTextureClips(Node &node);
+
+	static void FillSpritesheetClips(
 		const SceneSpritesheet &scene_spritesheet,
-		const std::string &id_start,
-		Node &node) const;
-
-	void FillSheetSimple(
-		const std::vector<SceneSceneSpritesheetRegion>::const_iterator
-			&iter,
-		const SceneObject &scene_object,
-		SimpleRender &render) const;
+		Node &node);
+
+	static void MoveRenders(Node &from, Node &to);
+
+	void UpdateCollisionMasks(const Node &node);
+
+	void UpdateCompositeMask(const Node &node);
+
+	static int SpriteClip(const SpriteComponent &sprite, const Node &node);
+
+	void BindObjects(
+		const World &world,
+		const std::vector<int> &texture_nodes,
+		const std::vector<int> &spritesheet_nodes,
+		const std::vector<int> &composite_nodes,
+		std::vector<bool> &rebuild);
+
+	void AdoptRenders(
+		const World &world,
+		const std::vector<int> &texture_nodes,
+		const std::vector<int> &spritesheet_nodes,
+		const std::vector<int> &composite_nodes,
+		std::vector<bool> &rebuild);
+
+	void SyncPositions(const World &world);
+
+	static bool SyncNodePositions(
+		const ComponentPool<PositionComponent> &positions,
+		Node &node);
+
+	void SyncAnimations(const World &world);
+
+	static bool SyncNodeAnimations(
+		const AnimationPool &animations,
+		Node &node);
+
+	void SyncTransforms(const World &world);
+
+	static bool SyncNodeTransforms(
+		const ComponentPool<TransformComponent> &transforms,
+		Node &node);
+
+	void UpdateCorners();
+
+	// Builds the grid of node if it is large and has no transformed
+	// sprites, and clears it otherwise.
+	static void UpdateGrid(Node &node);
+
+	void SubmitNode(const Node &node);
+
+	// Particles are few pixels each and short-lived, so they are drawn
+	// after every node without culling.
+	void SubmitParticles(const ParticlePool &particles);
+
+	void SubmitHud();
+
+	void RefreshStreamedNodes();
+
+	void RefreshNodeTexture(Node &node);
+
+	void SubmitRepeats(const Node &node);
+
+	void SubmitCompositeParts(const Node &node);
+
+	void RefreshComposites();
+
+	bool BakeComposite(BakedComposite &composite);
+
+	void RenderCompositeParts(const BakedComposite &composite);
+
+	void BakeRepeats(Node &node);
+
+	TexturePtr BakeRepeat(const Node &node, size_t index);
+
+	void RenderRepeatTiles(
+		const Node &node,
+		size_t index,
+		SDL_Texture *target);
+
+	static void BindSprite(
+		Entity entity,
+		const PositionComponent &position,
+		const TextureRepeatComponent *repeat,
+		int clip,
+		Node &node);
 };
 
 } // namespace foo
@@ -21,68 +21,1633 @@ THE SOFTWARE.
 */
 
 #include "scene.h"
+#include "atlas_reader.h"
+#include "compiled_scene.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
 #include "json/json.h"
 #include "tinyxml2.h"
+#include <exception>
 #include <fstream>
+#include <future>
+#include <algorithm>
+#include <cstring>
 #include <memory>
+#include <unordered_map>
+#include <stdexcept>
 #include "SDL_log.h"
 
 using namespace std;
 
 namespace foo {
 
+namespace {
+
+// Atoms are sequential, so spread them over the table with a
+// multiplicative hash.
+inline size_t
+HashAtom(Atom atom) {
+	return static_cast<size_t>(atom * 2654435761u);
+}
+
+// Splits "sheet:region" ids into their two atoms; region_id is kNoAtom
+// for plain texture ids.
+void
+SplitTextureId(const StringRef &id, Atom &texture_id, Atom &region_id) {
+	auto separator = static_cast<const char*>(
+		memchr(id.data(), ':', id.size()));
+	if (separator) {
+		size_t sheet_size = separator - id.data();
+		texture_id = InternAtom(StringRef(id.data(), sheet_size));
+		region_id = InternAtom(
+			StringRef(separator + 1, id.size() - sheet_size - 1));
+	} else {
+		texture_id = InternAtom(id);
+		region_id = kNoAtom;
+	}
+}
+
+// Creates an unresolved texture component.
+SceneComponentTexture*
+NewTextureComponent(Arena &arena, const StringRef &texture_id) {
+	auto component = arena.New<SceneComponentTexture>();
+	SplitTextureId(
+		texture_id, component->texture_id, component->region_id);
+	component->texture_index = -1;
+	component->spritesheet_index = -1;
+	component->region_index = -1;
+	return component;
+}
+
+// Frame rate of animations that do not give one.
+const float kDefaultAnimationFps = 10.0f;
+
+SceneComponentAnimation*
+NewAnimationComponent(
+		Arena &arena,
+		Atom sequence,
+		float fps,
+		bool loop) {
+	auto component = arena.New<SceneComponentAnimation>();
+	component->sequence = sequence;
+	component->fps = fps;
+	component->loop = loop;
+	component->frames = nullptr;
+	component->frame_count = 0;
+	return component;
+}
+
+SceneComponentTransform*
+NewTransformComponent(
+		Arena &arena,
+		float rotation,
+		float scale_x,
+		float scale_y,
+		float pivot_x,
+		float pivot_y) {
+	auto component = arena.New<SceneComponentTransform>();
+	component->rotation = rotation;
+	component->scale_x = scale_x;
+	component->scale_y = scale_y;
+	component->pivot_x = pivot_x;
+	component->pivot_y = pivot_y;
+	return component;
+}
+
+// Creates an unresolved emitter component with the default settings.
+SceneComponentEmitter*
+NewEmitterComponent(
+		Arena &arena,
+		Atom spritesheet_id,
+		Atom sequence) {
+	auto component = arena.New<SceneComponentEmitter>();
+	component->spritesheet_id = spritesheet_id;
+	component->sequence = sequence;
+	component->rate = 0.0f;
+	component->burst = 0;
+	component->capacity = 0;
+	component->life_min = 1.0f;
+	component->life_max = 1.0f;
+	component->speed_min = 0.0f;
+	component->speed_max = 0.0f;
+	component->angle = 0.0f;
+	component->spread = 360.0f;
+	component->offset_x = 0.0f;
+	component->offset_y = 0.0f;
+	component->random_frame = false;
+	component->spritesheet_index = -1;
+	component->frames = nullptr;
+	component->frame_count = 0;
+	return component;
+}
+
+// Reads either one number, used for both, or a pair of numbers. Leaves
+// first and second alone otherwise.
+bool
+ReadNumberOrPair(const Json::Value &in, float &first, float &second) {
+	if (in.isNumeric()) {
+		first = in.asFloat();
+		second = first;
+		return true;
+	}
+	if (in.isArray()
+			&& in.size() == 2
+			&& in[0].isNumeric()
+			&& in[1].isNumeric()) {
+		first = in[0].asFloat();
+		second = in[1].asFloat();
+		return true;
+	}
+	return false;
+}
+
+// Creates an unresolved composite component; parts are copied into
+// arena.
+SceneComponentComposite*
+NewCompositeComponent(
+		Arena &arena,
+		const SceneCompositePart *parts,
+		size_t part_count) {
+	auto out_parts = static_cast<SceneCompositePart*>(arena.Allocate(
+		part_count * sizeof(SceneCompositePart),
+		alignof(SceneCompositePart)));
+	copy(parts, parts + part_count, out_parts);
+
+	auto component = arena.New<SceneComponentComposite>();
+	component->parts = out_parts;
+	component->part_count = static_cast<int>(part_count);
+	component->composite_index = -1;
+	return component;
+}
+
+// Fills part from the fields of a composite part in the scene file.
+// Offsets are from the object's position, which stays the top-left corner
+// of what is drawn, so they cannot be negative.
+bool
+MakeCompositePart(
+		const StringRef &texture_id,
+		int x,
+		int y,
+		bool flip,
+		SceneCompositePart &part) {
+	SplitTextureId(texture_id, part.texture_id, part.region_id);
+	part.x = x;
+	part.y = y;
+	part.flip = flip;
+	part.spritesheet_index = -1;
+	part.region_index = -1;
+	return kNoAtom != part.region_id && x >= 0 && y >= 0;
+}
+
+// Appends the canonical spelling of part to key, such as
+// "sheet:wingBlue_0.png@0,10~;" for a flipped part.
+void
+AppendCompositePartKey(const SceneCompositePart &part, string &key) {
+	key.append(AtomName(part.texture_id).str());
+	key += ':';
+	key.append(AtomName(part.region_id).str());
+	key += '@';
+	key.append(to_string(part.x));
+	key += ',';
+	key.append(to_string(part.y));
+	if (part.flip) {
+		key += '~';
+	}
+	key += ';';
+}
+
+// True if name is prefix followed by a frame number and optionally an
+// extension, as in fire07.png for prefix fire.
+bool
+ParseFrameName(
+		const StringRef &name,
+		const StringRef &prefix,
+		long &number) {
+	if (name.size() <= prefix.size()
+			|| 0 != memcmp(name.data(), prefix.data(), prefix.size())) {
+		return false;
+	}
+
+	size_t i = prefix.size();
+	number = 0;
+	for (; i < name.size() && name.data()[i] >= '0'
+			&& name.data()[i] <= '9'; ++i) {
+		number = number * 10 + (name.data()[i] - '0');
+	}
+	return i > prefix.size() && (i == name.size() || '.' == name.data()[i]);
+}
+
+// Fills sheet.region_slots for the regions already in sheet.regions.
+void
+IndexRegions(SceneSpritesheet &sheet) {
+	sheet.region_slots.clear();
+	if (sheet.regions.empty()) {
+		return;
+	}
+
+	// At most half full, so probe sequences stay short.
+	size_t slot_count = 1;
+	while (slot_count < sheet.regions.size() * 2) {
+		slot_count *= 2;
+	}
+	sheet.region_slots.assign(slot_count, -1);
+
+	const size_t mask = slot_count - 1;
+	for (size_t i = 0; i < sheet.regions.size(); ++i) {
+		Atom name = sheet.regions[i].name;
+		size_t slot = HashAtom(name) & mask;
+		while (sheet.region_slots[slot] >= 0
+				&& sheet.regions[sheet.region_slots[slot]].name != name) {
+			slot = (slot + 1) & mask;
+		}
+
+		if (sheet.region_slots[slot] >= 0) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"Duplicate SubTexture %s: keeping the first one\n",
+				AtomName(name).c_str());
+			continue;
+		}
+		sheet.region_slots[slot] = static_cast<int>(i);
+	}
+}
+
+} // namespace
+
 Scene::Scene() {}
 
-Scene::Scene(Scene &&other) {
-	swap(*this, other);
+Scene::Scene(Scene &&other) {
+	swap(*this, other);
+}
+
+Scene::~Scene() {}
+
+Scene& Scene::operator=(Scene &&other) {
+	if (this != &other) {
+		Clear();
+		swap(*this, other);
+	}
+	return *this;
+}
+
+void Scene::Clear() {
+	// Everything below points into the arena.
+	id_ = StringRef();
+	title_ = StringRef();
+	width_ = 0;
+	height_ = 0;
+	textures_.clear();
+	spritesheets_.clear();
+	objects_.clear();
+	composites_.clear();
+	arena_.Reset();
+}
+
+void Scene::LoadFromFile(
+		const char *file_name,
+		SceneParser parser,
+		ThreadPool *pool) {
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_SYSTEM,
+		"Loading scene from %s...\n",
+		file_name);
+
+	if (kSceneParserDom == parser) {
+		ifstream in_file(file_name);
+		LoadFromStream(in_file, ScenePathPrefix(file_name), pool);
+		return;
+	}
+
+	MappedFile file;
+	if (!file.Open(file_name)) {
+		SDL_LogError(
+			SDL_LOG_CATEGORY_SYSTEM,
+			"Failed to open scene %s\n",
+			file_name);
+		throw runtime_error("Failed to open scene file");
+	}
+	LoadFromBuffer(
+		file.data(), file.size(), ScenePathPrefix(file_name), pool);
+}
+
+string FormatTextureId(const SceneComponentTexture &component) {
+	string id(AtomName(component.texture_id).str());
+	if (kNoAtom != component.region_id) {
+		id += ':';
+		id.append(AtomName(component.region_id).str());
+	}
+	return id;
+}
+
+string ScenePathPrefix(const char *file_name) {
+	string prefix(file_name);
+	auto last_separator = prefix.find_last_of('\\');
+	if (string::npos == last_separator) {
+		last_separator = prefix.find_last_of('/');
+	}
+	if (string::npos == last_separator) {
+		return string();
+	}
+	prefix.erase(last_separator + 1, string::npos);
+	return prefix;
+}
+
+bool Scene::LoadFromCompiledFile(const char *file_name) {
+	MappedFile file;
+	if (!file.Open(file_name)) {
+		return false;
+	}
+
+	const CompiledSceneHeader *header = GetCompiledScene(file);
+	if (!header) {
+		SDL_LogWarn(
+			SDL_LOG_CATEGORY_SYSTEM,
+			"%s is not a compiled scene of version %u: ignoring\n",
+			file_name,
+			kCompiledSceneVersion);
+		return false;
+	}
+
+	string prefix = ScenePathPrefix(file_name);
+	if (!AreCompiledSourcesCurrent(file, prefix)) {
+		SDL_LogWarn(
+			SDL_LOG_CATEGORY_SYSTEM,
+			"%s is stale: ignoring\n",
+			file_name);
+		return false;
+	}
+
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_SYSTEM,
+		"Loading compiled scene from %s...\n",
+		file_name);
+
+	Clear();
+
+	// Records are copied out rather than used in place: the file names
+	// strings by offset and the scene by atoms, which are only meaningful
+	// within this process; paths gain the scene's directory; frames and
+	// parts move to the arena; and the mapping is closed on return.
+	auto ref = [&](const CompiledString &value) {
+		return StringRef(
+			CompiledChars(file, *header, value), value.length);
+	};
+	// The compiler stores each distinct string once, so each is interned
+	// once, on first use, instead of once per record that names it.
+	vector<Atom> atoms(header->strings.count, kNoAtom);
+	auto atom = [&](const CompiledString &value) {
+		Atom &interned = atoms[value.offset];
+		if (kNoAtom == interned) {
+			interned = InternAtom(ref(value));
+		}
+		return interned;
+	};
+	string path;
+	auto copy_path = [&](const CompiledString &value) {
+		path.assign(prefix);
+		path.append(CompiledChars(file, *header, value), value.length);
+		return arena_.CopyString(path);
+	};
+
+	arena_.Reserve(
+		header->objects.count * (sizeof(SceneComponentTexture)
+			+ sizeof(SceneComponentTextureRepeat)
+			+ sizeof(SceneComponentVelocity)
+			+ sizeof(SceneComponentCollider)
+			+ sizeof(SceneComponentAnimation)
+			+ sizeof(SceneComponentComposite)
+			+ sizeof(SceneComponentTransform)
+			+ sizeof(SceneComponentEmitter))
+		+ header->frames.count * sizeof(int)
+		+ header->composite_parts.count * (sizeof(SceneCompositePart) + 32)
+		+ (header->textures.count + header->spritesheets.count * 2)
+			* (prefix.size() + 64));
+
+	id_ = arena_.CopyString(ref(header->id));
+	title_ = arena_.CopyString(ref(header->title));
+	width_ = header->width;
+	height_ = header->height;
+
+	auto textures = CompiledRecords<CompiledTexture>(
+		file, header->textures);
+	textures_.resize(header->textures.count);
+	for (uint32_t i = 0; i < header->textures.count; ++i) {
+		textures_[i].id = atom(textures[i].id);
+		textures_[i].path = copy_path(textures[i].path);
+	}
+
+	auto sheets = CompiledRecords<CompiledSpritesheet>(
+		file, header->spritesheets);
+	auto regions = CompiledRecords<CompiledRegion>(
+		file, header->regions);
+	spritesheets_.resize(header->spritesheets.count);
+	for (uint32_t i = 0; i < header->spritesheets.count; ++i) {
+		const CompiledSpritesheet &in = sheets[i];
+		SceneSpritesheet &out = spritesheets_[i];
+		out.id = atom(in.id);
+		out.path = copy_path(in.path);
+		out.image_path = copy_path(in.image_path);
+
+		out.regions.resize(in.region_count);
+		for (uint32_t j = 0; j < in.region_count; ++j) {
+			const CompiledRegion &region = regions[in.first_region + j];
+			SceneSceneSpritesheetRegion &out_region = out.regions[j];
+			out_region.name = atom(region.name);
+			out_region.x = region.x;
+			out_region.y = region.y;
+			out_region.width = region.width;
+			out_region.height = region.height;
+		}
+		IndexRegions(out);
+	}
+
+	// Texture handles, animation frames and composite parts were resolved
+	// by the compiler, so unlike the JSON path there are no Resolve
+	// passes; only composites are grouped again.
+	auto objects = CompiledRecords<CompiledObject>(
+		file, header->objects);
+	auto frames_table = CompiledRecords<int32_t>(file, header->frames);
+	auto parts_table = CompiledRecords<CompiledCompositePart>(
+		file, header->composite_parts);
+	vector<SceneCompositePart> parts;
+	objects_.resize(header->objects.count);
+	for (uint32_t i = 0; i < header->objects.count; ++i) {
+		const CompiledObject &in = objects[i];
+		SceneObject &out = objects_[i];
+		out.id = atom(in.id);
+		out.x = in.x;
+		out.y = in.y;
+
+		if (in.flags & kCompiledObjectTexture) {
+			out.texture = arena_.New<SceneComponentTexture>();
+			out.texture->texture_id = atom(in.texture_id);
+			out.texture->region_id = atom(in.region_id);
+			out.texture->texture_index = in.texture_index;
+			out.texture->spritesheet_index = in.spritesheet_index;
+			out.texture->region_index = in.region_index;
+		}
+		if (in.flags & kCompiledObjectTextureRepeat) {
+			out.texture_repeat = arena_.New<SceneComponentTextureRepeat>();
+			out.texture_repeat->repeat_x = in.repeat_x;
+			out.texture_repeat->repeat_y = in.repeat_y;
+		}
+		if (in.flags & kCompiledObjectVelocity) {
+			out.velocity = arena_.New<SceneComponentVelocity>();
+			out.velocity->x = in.velocity_x;
+			out.velocity->y = in.velocity_y;
+			out.velocity->angular = in.angular_velocity;
+		}
+		if (in.flags & kCompiledObjectCollider) {
+			out.collider = arena_.New<SceneComponentCollider>();
+			out.collider->radius = in.collider_radius;
+		}
+		if (in.flags & kCompiledObjectAnimation) {
+			out.animation = NewAnimationComponent(
+				arena_,
+				atom(in.animation_sequence),
+				in.animation_fps,
+				0 != (in.flags & kCompiledObjectAnimationLoop));
+			if (in.animation_frame_count > 0) {
+				int *frames = static_cast<int*>(arena_.Allocate(
+					in.animation_frame_count * sizeof(int),
+					alignof(int)));
+				copy(
+					frames_table + in.animation_first_frame,
+					frames_table + in.animation_first_frame
+						+ in.animation_frame_count,
+					frames);
+				out.animation->frames = frames;
+				out.animation->frame_count =
+					static_cast<int>(in.animation_frame_count);
+			}
+		}
+		if (in.flags & kCompiledObjectTransform) {
+			out.transform = NewTransformComponent(
+				arena_,
+				in.rotation,
+				in.scale_x,
+				in.scale_y,
+				in.pivot_x,
+				in.pivot_y);
+		}
+		if (in.flags & kCompiledObjectEmitter) {
+			SceneComponentEmitter *emitter = NewEmitterComponent(
+				arena_,
+				atom(in.emitter_spritesheet),
+				atom(in.emitter_sequence));
+			emitter->rate = in.emitter_rate;
+			emitter->burst = in.emitter_burst;
+			emitter->capacity = in.emitter_capacity;
+			emitter->life_min = in.emitter_life_min;
+			emitter->life_max = in.emitter_life_max;
+			emitter->speed_min = in.emitter_speed_min;
+			emitter->speed_max = in.emitter_speed_max;
+			emitter->angle = in.emitter_angle;
+			emitter->spread = in.emitter_spread;
+			emitter->offset_x = in.emitter_offset_x;
+			emitter->offset_y = in.emitter_offset_y;
+			emitter->random_frame =
+				0 != (in.flags & kCompiledObjectEmitterRandomFrame);
+			emitter->spritesheet_index = in.emitter_spritesheet_index;
+			if (in.emitter_frame_count > 0) {
+				int *frames = static_cast<int*>(arena_.Allocate(
+					in.emitter_frame_count * sizeof(int),
+					alignof(int)));
+				copy(
+					frames_table + in.emitter_first_frame,
+					frames_table + in.emitter_first_frame
+						+ in.emitter_frame_count,
+					frames);
+				emitter->frames = frames;
+				emitter->frame_count =
+					static_cast<int>(in.emitter_frame_count);
+			}
+			out.emitter = emitter;
+		}
+		if (in.flags & kCompiledObjectComposite) {
+			parts.resize(in.composite_part_count);
+			for (uint32_t j = 0; j < in.composite_part_count; ++j) {
+				const CompiledCompositePart &in_part =
+					parts_table[in.composite_first_part + j];
+				SceneCompositePart &part = parts[j];
+				part.texture_id = atom(in_part.texture_id);
+				part.region_id = atom(in_part.region_id);
+				part.x = in_part.x;
+				part.y = in_part.y;
+				part.flip = 0 != (in_part.flags & kCompiledCompositePartFlip);
+				part.spritesheet_index = in_part.spritesheet_index;
+				part.region_index = in_part.region_index;
+			}
+			out.composite = NewCompositeComponent(
+				arena_, parts.data(), parts.size());
+		}
+	}
+	BuildComposites();
+
+	return true;
+}
+
+void Scene::LoadFromStream(
+		istream &in_stream,
+		const string &prefix,
+		ThreadPool *pool) {
+	Json::Value in;
+	in_stream >> in;
+
+	Clear();
+
+	const Json::Value &json_id = in["id"];
+	if (!json_id.isNull()) {
+		id_ = arena_.CopyString(json_id.asString());
+	}
+
+	title_ = arena_.CopyString(in["title"].asString());
+	width_ = in["width"].asInt();
+	height_ = in["height"].asInt();
+
+	ProcessSpritesheets(prefix, in["spritesheets"]);
+	ProcessTextureAtlases(prefix, pool);
+	ProcessTextures(prefix, in["textures"]);
+	ProcessSceneObjects(prefix, in["objects"]);
+	ResolveTextureReferences();
+	ResolveAnimationFrames();
+	ResolveEmitters();
+	ResolveCompositeParts();
+	BuildComposites();
+}
+
+namespace {
+
+// Fields of one entry of a composite component's parts array.
+struct StreamedPart {
+	bool has_texture_id;
+	bool has_offset;
+	string texture_id;
+	int x;
+	int y;
+	bool flip;
+
+	void
+	Reset() {
+		has_texture_id = false;
+		has_offset = false;
+		texture_id.clear();
+		x = 0;
+		y = 0;
+		flip = false;
+	}
+};
+
+// Fields of one entry of an object's components array. Components are
+// applied once the whole object has been read, so warnings come out in
+// the same order as with the DOM reader whatever the key order.
+struct StreamedComponent {
+	bool has_type;
+	bool has_texture_id;
+	bool has_repeat;
+	bool has_velocity;
+	bool has_angular_velocity;
+	bool has_radius;
+	bool has_sequence;
+	bool has_fps;
+	bool has_loop;
+	bool has_parts;
+	bool has_rotation;
+	bool has_scale;
+	bool has_pivot;
+	bool has_spritesheet;
+	string type;
+	string texture_id;
+	string sequence;
+	string spritesheet;
+	int repeat_x;
+	int repeat_y;
+	double velocity_x;
+	double velocity_y;
+	double angular_velocity;
+	double radius;
+	double fps;
+	bool loop;
+	double rotation;
+	double scale_x;
+	double scale_y;
+	double pivot_x;
+	double pivot_y;
+	double rate;
+	double burst;
+	double capacity;
+	double life_min;
+	double life_max;
+	double speed_min;
+	double speed_max;
+	double angle;
+	double spread;
+	double offset_x;
+	double offset_y;
+	bool random_frame;
+	// Like components, parts are reused; only the first part_count are
+	// live.
+	vector<StreamedPart> parts;
+	size_t part_count;
+
+	void
+	Reset() {
+		has_type = false;
+		has_texture_id = false;
+		has_repeat = false;
+		has_velocity = false;
+		has_angular_velocity = false;
+		has_radius = false;
+		has_sequence = false;
+		has_fps = false;
+		has_loop = false;
+		has_parts = false;
+		has_rotation = false;
+		has_scale = false;
+		has_pivot = false;
+		has_spritesheet = false;
+		type.clear();
+		texture_id.clear();
+		sequence.clear();
+		spritesheet.clear();
+		repeat_x = 0;
+		repeat_y = 0;
+		velocity_x = 0.0;
+		velocity_y = 0.0;
+		angular_velocity = 0.0;
+		radius = 0.0;
+		fps = 0.0;
+		loop = true;
+		rotation = 0.0;
+		scale_x = 1.0;
+		scale_y = 1.0;
+		pivot_x = 0.5;
+		pivot_y = 0.5;
+		rate = 0.0;
+		burst = 0.0;
+		capacity = 0.0;
+		life_min = 1.0;
+		life_max = 1.0;
+		speed_min = 0.0;
+		speed_max = 0.0;
+		angle = 0.0;
+		spread = 360.0;
+		offset_x = 0.0;
+		offset_y = 0.0;
+		random_frame = false;
+		part_count = 0;
+	}
+};
+
+// Reads the next value into out if it is a string; skips it otherwise.
+bool
+StreamString(JsonPullReader &in, string &out) {
+	JsonPullReader::Token token = in.Next();
+	if (JsonPullReader::kString == token) {
+		out = in.string();
+		return true;
+	}
+	in.Skip(token);
+	return false;
+}
+
+bool
+StreamString(JsonPullReader &in, Arena &arena, StringRef &out) {
+	JsonPullReader::Token token = in.Next();
+	if (JsonPullReader::kString == token) {
+		out = arena.CopyString(in.string());
+		return true;
+	}
+	in.Skip(token);
+	return false;
+}
+
+bool
+StreamAtom(JsonPullReader &in, Atom &out) {
+	JsonPullReader::Token token = in.Next();
+	if (JsonPullReader::kString == token) {
+		out = InternAtom(in.string());
+		return true;
+	}
+	in.Skip(token);
+	return false;
+}
+
+bool
+StreamNumber(JsonPullReader &in, double &out) {
+	JsonPullReader::Token token = in.Next();
+	if (JsonPullReader::kNumber == token) {
+		out = in.number_value();
+		return true;
+	}
+	in.Skip(token);
+	return false;
+}
+
+bool
+StreamBool(JsonPullReader &in, bool &out) {
+	JsonPullReader::Token token = in.Next();
+	if (JsonPullReader::kTrue == token || JsonPullReader::kFalse == token) {
+		out = JsonPullReader::kTrue == token;
+		return true;
+	}
+	in.Skip(token);
+	return false;
+}
+
+// Reads either one number, used for both, or a pair of numbers. Leaves
+// first and second alone otherwise.
+bool
+StreamNumberOrPair(JsonPullReader &in, double &first, double &second) {
+	JsonPullReader::Token token = in.Next();
+	if (JsonPullReader::kNumber == token) {
+		first = in.number_value();
+		second = first;
+		return true;
+	}
+	return in.ReadNumberPair(token, first, second);
+}
+
+int
+StreamInt(JsonPullReader &in) {
+	JsonPullReader::Token token = in.Next();
+	if (JsonPullReader::kNumber == token) {
+		return in.is_int()
+			? in.int_value()
+			: static_cast<int>(in.number_value());
+	}
+	in.Skip(token);
+	return 0;
+}
+
+void
+StreamCompositePart(
+		JsonPullReader &in,
+		JsonPullReader::Token token,
+		StreamedPart &out) {
+	if (token != JsonPullReader::kBeginObject) {
+		in.Skip(token);
+		return;
+	}
+
+	while (in.Next() != JsonPullReader::kEndObject) {
+		if (in.string() == "texture_id") {
+			out.has_texture_id = StreamString(in, out.texture_id);
+		} else if (in.string() == "offset") {
+			out.has_offset = in.ReadIntPair(in.Next(), out.x, out.y);
+		} else if (in.string() == "flip") {
+			StreamBool(in, out.flip);
+		} else {
+			in.Skip(in.Next());
+		}
+	}
+}
+
+void
+StreamComponent(
+		JsonPullReader &in,
+		JsonPullReader::Token token,
+		StreamedComponent &out) {
+	if (token != JsonPullReader::kBeginObject) {
+		in.Skip(token);
+		return;
+	}
+
+	while (in.Next() != JsonPullReader::kEndObject) {
+		if (in.string() == "type") {
+			out.has_type = StreamString(in, out.type);
+		} else if (in.string() == "texture_id") {
+			out.has_texture_id = StreamString(in, out.texture_id);
+		} else if (in.string() == "repeat") {
+			out.has_repeat = in.ReadIntPair(
+				in.Next(), out.repeat_x, out.repeat_y);
+		} else if (in.string() == "velocity") {
+			out.has_velocity = in.ReadNumberPair(
+				in.Next(), out.velocity_x, out.velocity_y);
+		} else if (in.string() == "angular_velocity") {
+			out.has_angular_velocity = StreamNumber(
+				in, out.angular_velocity);
+		} else if (in.string() == "radius") {
+			out.has_radius = StreamNumber(in, out.radius);
+		} else if (in.string() == "sequence") {
+			out.has_sequence = StreamString(in, out.sequence);
+		} else if (in.string() == "fps") {
+			out.has_fps = StreamNumber(in, out.fps);
+		} else if (in.string() == "loop") {
+			out.has_loop = StreamBool(in, out.loop);
+		} else if (in.string() == "rotation") {
+			out.has_rotation = StreamNumber(in, out.rotation);
+		} else if (in.string() == "scale") {
+			out.has_scale = StreamNumberOrPair(
+				in, out.scale_x, out.scale_y);
+		} else if (in.string() == "spritesheet") {
+			out.has_spritesheet = StreamString(in, out.spritesheet);
+		} else if (in.string() == "rate") {
+			StreamNumber(in, out.rate);
+		} else if (in.string() == "burst") {
+			StreamNumber(in, out.burst);
+		} else if (in.string() == "capacity") {
+			StreamNumber(in, out.capacity);
+		} else if (in.string() == "life") {
+			StreamNumberOrPair(in, out.life_min, out.life_max);
+		} else if (in.string() == "speed") {
+			StreamNumberOrPair(in, out.speed_min, out.speed_max);
+		} else if (in.string() == "angle") {
+			StreamNumber(in, out.angle);
+		} else if (in.string() == "spread") {
+			StreamNumber(in, out.spread);
+		} else if (in.string() == "offset") {
+			in.ReadNumberPair(in.Next(), out.offset_x, out.offset_y);
+		} else if (in.string() == "random_frame") {
+			StreamBool(in, out.random_frame);
+		} else if (in.string() == "pivot") {
+			out.has_pivot = in.ReadNumberPair(
+				in.Next(), out.pivot_x, out.pivot_y);
+		} else if (in.string() == "parts") {
+			token = in.Next();
+			if (token != JsonPullReader::kBeginArray) {
+				in.Skip(token);
+				continue;
+			}
+			out.has_parts = true;
+			for (token = in.Next();
+					token != JsonPullReader::kEndArray;
+					token = in.Next()) {
+				if (out.part_count == out.parts.size()) {
+					out.parts.emplace_back();
+				}
+				StreamedPart &part = out.parts[out.part_count++];
+				part.Reset();
+				StreamCompositePart(in, token, part);
+			}
+		} else {
+			in.Skip(in.Next());
+		}
+	}
+}
+
+void
+ApplyStreamedComponents(
+		const vector<StreamedComponent> &components,
+		size_t count,
+		Arena &arena,
+		SceneObject &out) {
+	vector<SceneCompositePart> parts;
+	for (size_t i = 0; i < count; ++i) {
+		const StreamedComponent &component = components[i];
+		if (!component.has_type) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"Missing or malformatted component type for"
+				" %s: skipping\n",
+				AtomName(out.id).c_str());
+			continue;
+		}
+
+		if (component.type == "texture") {
+			if (out.texture) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined texture component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+			if (!component.has_texture_id) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Missing texture_id for texture component "
+					"in %s\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.texture = NewTextureComponent(arena, component.texture_id);
+		} else if (component.type == "texture_repeat") {
+			if (out.texture_repeat) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined texture_repeat component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+			if (!component.has_repeat) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Missing or malformated repeat texture_repeat "
+					"comonent in %s\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.texture_repeat = arena.New<SceneComponentTextureRepeat>();
+			out.texture_repeat->repeat_x = component.repeat_x;
+			out.texture_repeat->repeat_y = component.repeat_y;
+		} else if (component.type == "velocity") {
+			if (out.velocity) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined velocity component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+			if (!component.has_velocity) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Missing or malformatted velocity for velocity "
+					"component in %s\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.velocity = arena.New<SceneComponentVelocity>();
+			out.velocity->x = static_cast<float>(component.velocity_x);
+			out.velocity->y = static_cast<float>(component.velocity_y);
+			out.velocity->angular =
+				static_cast<float>(component.angular_velocity);
+		} else if (component.type == "collider") {
+			if (out.collider) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined collider component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.collider = arena.New<SceneComponentCollider>();
+			out.collider->radius = component.has_radius
+				&& component.radius > 0.0
+				? static_cast<float>(component.radius)
+				: 0.0f;
+		} else if (component.type == "animation") {
+			if (out.animation) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined animation component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+			if (!component.has_sequence || component.sequence.empty()) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Missing sequence for animation component in %s\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.animation = NewAnimationComponent(
+				arena,
+				InternAtom(component.sequence),
+				component.has_fps
+					? static_cast<float>(component.fps)
+					: kDefaultAnimationFps,
+				!component.has_loop || component.loop);
+		} else if (component.type == "composite") {
+			if (out.composite) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined composite component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			parts.clear();
+			for (size_t j = 0; j < component.part_count; ++j) {
+				const StreamedPart &in_part = component.parts[j];
+				SceneCompositePart part;
+				if (!in_part.has_texture_id
+						|| !in_part.has_offset
+						|| !MakeCompositePart(
+							in_part.texture_id,
+							in_part.x,
+							in_part.y,
+							in_part.flip,
+							part)) {
+					SDL_LogWarn(
+						SDL_LOG_CATEGORY_SYSTEM,
+						"Malformatted part %lu of composite component"
+						" in %s: skipping\n",
+						static_cast<unsigned long>(j),
+						AtomName(out.id).c_str());
+					continue;
+				}
+				parts.push_back(part);
+			}
+			if (parts.empty()) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Missing parts for composite component in %s\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.composite = NewCompositeComponent(
+				arena, parts.data(), parts.size());
+		} else if (component.type == "transform") {
+			if (out.transform) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined transform component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.transform = NewTransformComponent(
+				arena,
+				component.has_rotation
+					? static_cast<float>(component.rotation)
+					: 0.0f,
+				component.has_scale
+					? static_cast<float>(component.scale_x)
+					: 1.0f,
+				component.has_scale
+					? static_cast<float>(component.scale_y)
+					: 1.0f,
+				component.has_pivot
+					? static_cast<float>(component.pivot_x)
+					: 0.5f,
+				component.has_pivot
+					? static_cast<float>(component.pivot_y)
+					: 0.5f);
+		} else if (component.type == "emitter") {
+			if (out.emitter) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined emitter component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+			if (!component.has_spritesheet
+					|| !component.has_sequence
+					|| component.sequence.empty()) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Missing spritesheet or sequence for emitter"
+					" component in %s\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			SceneComponentEmitter *emitter = NewEmitterComponent(
+				arena,
+				InternAtom(component.spritesheet),
+				InternAtom(component.sequence));
+			emitter->rate = static_cast<float>(component.rate);
+			emitter->burst = static_cast<int>(component.burst);
+			emitter->capacity = static_cast<int>(component.capacity);
+			emitter->life_min = static_cast<float>(component.life_min);
+			emitter->life_max = static_cast<float>(component.life_max);
+			emitter->speed_min = static_cast<float>(component.speed_min);
+			emitter->speed_max = static_cast<float>(component.speed_max);
+			emitter->angle = static_cast<float>(component.angle);
+			emitter->spread = static_cast<float>(component.spread);
+			emitter->offset_x = static_cast<float>(component.offset_x);
+			emitter->offset_y = static_cast<float>(component.offset_y);
+			emitter->random_frame = component.random_frame;
+			out.emitter = emitter;
+		} else {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"Unknown component type %s for %s: ignoring\n",
+				component.type.c_str(),
+				AtomName(out.id).c_str());
+		}
+	}
+}
+
+} // namespace
+
+void Scene::LoadFromBuffer(
+		const char *data,
+		size_t size,
+		const string &prefix,
+		ThreadPool *pool) {
+	JsonPullReader in(data, data + size);
+	if (in.Next() != JsonPullReader::kBeginObject) {
+		SDL_LogError(
+			SDL_LOG_CATEGORY_SYSTEM,
+			"Scene document is not a JSON object\n");
+		throw runtime_error("Scene document is not a JSON object");
+	}
+
+	Clear();
+	// Strings and components take up less room than their JSON text, so
+	// this is usually the only block the scene needs.
+	arena_.Reserve(size);
+
+	while (in.Next() != JsonPullReader::kEndObject) {
+		const string &key = in.string();
+		if (key == "id") {
+			StreamString(in, arena_, id_);
+		} else if (key == "title") {
+			StreamString(in, arena_, title_);
+		} else if (key == "width") {
+			width_ = StreamInt(in);
+		} else if (key == "height") {
+			height_ = StreamInt(in);
+		} else if (key == "spritesheets") {
+			StreamSpritesheets(prefix, in);
+		} else if (key == "textures") {
+			StreamTextures(prefix, in);
+		} else if (key == "objects") {
+			StreamSceneObjects(in);
+		} else {
+			in.Skip(in.Next());
+		}
+	}
+	// Fails on anything but whitespace after the document.
+	in.Next();
+
+	ProcessTextureAtlases(prefix, pool);
+	ResolveTextureReferences();
+	ResolveAnimationFrames();
+	ResolveEmitters();
+	ResolveCompositeParts();
+	BuildComposites();
+}
+
+void Scene::StreamSpritesheets(
+		const string &prefix,
+		JsonPullReader &in) {
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_SYSTEM,
+		"Processing scene spritesheets...\n");
+
+	spritesheets_.clear();
+
+	JsonPullReader::Token token = in.Next();
+	if (token != JsonPullReader::kBeginArray) {
+		in.Skip(token);
+		return;
+	}
+
+	string path;
+	for (token = in.Next();
+			token != JsonPullReader::kEndArray;
+			token = in.Next()) {
+		if (token != JsonPullReader::kBeginObject) {
+			in.Skip(token);
+			continue;
+		}
+
+		SceneSpritesheet sheet;
+		path.clear();
+		while (in.Next() != JsonPullReader::kEndObject) {
+			if (in.string() == "id") {
+				StreamAtom(in, sheet.id);
+			} else if (in.string() == "path") {
+				StreamString(in, path);
+			} else {
+				in.Skip(in.Next());
+			}
+		}
+
+		sheet.path = arena_.CopyString(prefix + path);
+		spritesheets_.emplace_back(move(sheet));
+	}
+}
+
+void Scene::StreamTextures(
+		const string &prefix,
+		JsonPullReader &in) {
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_SYSTEM,
+		"Processing scene textures...\n");
+
+	textures_.clear();
+
+	JsonPullReader::Token token = in.Next();
+	if (token != JsonPullReader::kBeginArray) {
+		in.Skip(token);
+		return;
+	}
+
+	string path;
+	for (token = in.Next();
+			token != JsonPullReader::kEndArray;
+			token = in.Next()) {
+		if (token != JsonPullReader::kBeginObject) {
+			in.Skip(token);
+			continue;
+		}
+
+		SceneTexture texture;
+		path.clear();
+		while (in.Next() != JsonPullReader::kEndObject) {
+			if (in.string() == "id") {
+				StreamAtom(in, texture.id);
+			} else if (in.string() == "path") {
+				StreamString(in, path);
+			} else {
+				in.Skip(in.Next());
+			}
+		}
+
+		texture.path = arena_.CopyString(prefix + path);
+		textures_.push_back(texture);
+	}
+}
+
+void Scene::StreamSceneObjects(JsonPullReader &in) {
+	SDL_LogInfo(SDL_LOG_CATEGORY_SYSTEM, "Processing scene objects...\n");
+	objects_.clear();
+
+	JsonPullReader::Token token = in.Next();
+	if (token != JsonPullReader::kBeginArray) {
+		in.Skip(token);
+		return;
+	}
+
+	// Slots are reused across objects so their strings keep their
+	// capacity; only the first component_count are live.
+	vector<StreamedComponent> components;
+	for (token = in.Next();
+			token != JsonPullReader::kEndArray;
+			token = in.Next()) {
+		SceneObject object;
+		bool has_position = false;
+		size_t component_count = 0;
+
+		if (token != JsonPullReader::kBeginObject) {
+			in.Skip(token);
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"Empty object id: skipping\n");
+			continue;
+		}
+
+		while (in.Next() != JsonPullReader::kEndObject) {
+			if (in.string() == "id") {
+				StreamAtom(in, object.id);
+			} else if (in.string() == "position") {
+				has_position = in.ReadIntPair(
+					in.Next(), object.x, object.y);
+			} else if (in.string() == "components") {
+				token = in.Next();
+				if (token != JsonPullReader::kBeginArray) {
+					in.Skip(token);
+					continue;
+				}
+				for (token = in.Next();
+						token != JsonPullReader::kEndArray;
+						token = in.Next()) {
+					if (component_count == components.size()) {
+						components.emplace_back();
+					}
+					StreamedComponent &component =
+						components[component_count++];
+					component.Reset();
+					StreamComponent(in, token, component);
+				}
+			} else {
+				in.Skip(in.Next());
+			}
+		}
+
+		if (kNoAtom == object.id) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"Empty object id: skipping\n");
+			continue;
+		}
+		if (!has_position) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"Missing or malformatted position for %s: skipping\n",
+				AtomName(object.id).c_str());
+			continue;
+		}
+
+		ApplyStreamedComponents(
+			components, component_count, arena_, object);
+		objects_.push_back(object);
+	}
 }
 
-Scene::~Scene() {}
+void Scene::ResolveTextureReferences() {
+	unordered_map<Atom, int> texture_index;
+	for (size_t i = 0; i < textures_.size(); ++i) {
+		texture_index[textures_[i].id] = static_cast<int>(i);
+	}
 
-Scene& Scene::operator=(Scene &&other) {
-	if (this != &other) {
-		id_.clear();
-		title_.clear();
-		textures_.clear();
-		spritesheets_.clear();
-		objects_.clear();
+	unordered_map<Atom, int> spritesheet_index;
+	for (size_t i = 0; i < spritesheets_.size(); ++i) {
+		spritesheet_index[spritesheets_[i].id] = static_cast<int>(i);
+	}
 
-		swap(*this, other);
+	for (auto &object: objects_) {
+		if (!object.texture) {
+			continue;
+		}
+
+		SceneComponentTexture &texture = *object.texture;
+		if (kNoAtom == texture.region_id) {
+			auto iter = texture_index.find(texture.texture_id);
+			if (iter == end(texture_index)) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"%s: no texture matches texture_id=%s\n",
+					AtomName(object.id).c_str(),
+					FormatTextureId(texture).c_str());
+				continue;
+			}
+			texture.texture_index = iter->second;
+			continue;
+		}
+
+		auto iter = spritesheet_index.find(texture.texture_id);
+		if (iter == end(spritesheet_index)) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"%s: no spritesheet matches texture_id=%s\n",
+				AtomName(object.id).c_str(),
+				FormatTextureId(texture).c_str());
+			continue;
+		}
+
+		const SceneSpritesheet &sheet = spritesheets_[iter->second];
+		int region = sheet.FindRegion(texture.region_id);
+		if (region < 0) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"%s: texture_id=%s. Found spritesheet %s, but"
+				" no sub-region matches %s\n",
+				AtomName(object.id).c_str(),
+				FormatTextureId(texture).c_str(),
+				AtomName(sheet.id).c_str(),
+				AtomName(texture.region_id).c_str());
+			continue;
+		}
+
+		texture.spritesheet_index = iter->second;
+		texture.region_index = region;
 	}
-	return *this;
 }
 
-void Scene::LoadFromFile(const char *file_name) {
-	SDL_LogInfo(
-		SDL_LOG_CATEGORY_SYSTEM,
-		"Loading scene from %s...\n",
-		file_name);
+void Scene::ResolveAnimationFrames() {
+	// Objects playing the same sequence share its frames, so thousands of
+	// effects cost one scan of the regions.
+	unordered_map<uint64_t, SceneComponentAnimation*> resolved;
 
-	string prefix(file_name);
-	auto last_separator = prefix.find_last_of('\\');
-	if (string::npos == last_separator) {
-		last_separator = prefix.find_last_of('/');
+	for (auto &object: objects_) {
+		if (!object.animation) {
+			continue;
+		}
+
+		SceneComponentAnimation &animation = *object.animation;
+		const SceneComponentTexture *texture = object.texture;
+		if (!texture || texture->spritesheet_index < 0) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"%s: animation needs a texture from a spritesheet\n",
+				AtomName(object.id).c_str());
+			continue;
+		}
+
+		uint64_t key = (static_cast<uint64_t>(texture->spritesheet_index)
+			<< 32) | animation.sequence;
+		auto iter = resolved.find(key);
+		if (iter != end(resolved)) {
+			animation.frames = iter->second->frames;
+			animation.frame_count = iter->second->frame_count;
+			continue;
+		}
+		resolved.emplace(key, &animation);
+
+		animation.frames = FindSequenceFrames(
+			texture->spritesheet_index,
+			animation.sequence,
+			animation.frame_count);
+		if (!animation.frames) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"%s: no region of %s is a frame of %s\n",
+				AtomName(object.id).c_str(),
+				AtomName(spritesheets_[texture->spritesheet_index].id)
+					.c_str(),
+				AtomName(animation.sequence).c_str());
+		}
 	}
-	if (string::npos != last_separator) {
-		prefix.erase(last_separator + 1, string::npos);
+}
+
+void Scene::ResolveEmitters() {
+	unordered_map<Atom, int> spritesheet_index;
+	for (size_t i = 0; i < spritesheets_.size(); ++i) {
+		spritesheet_index[spritesheets_[i].id] = static_cast<int>(i);
 	}
+	unordered_map<uint64_t, SceneComponentEmitter*> resolved;
 
-	ifstream in_file(file_name);
-	Json::Value in;
-	in_file >> in;
+	for (auto &object: objects_) {
+		if (!object.emitter) {
+			continue;
+		}
 
-	const Json::Value &json_id = in["id"];
-	if (!json_id.isNull()) {
-		id_ = json_id.asString();
+		SceneComponentEmitter &emitter = *object.emitter;
+		auto sheet = spritesheet_index.find(emitter.spritesheet_id);
+		if (sheet == end(spritesheet_index)) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"%s: no spritesheet matches emitter spritesheet=%s\n",
+				AtomName(object.id).c_str(),
+				AtomName(emitter.spritesheet_id).c_str());
+			continue;
+		}
+		emitter.spritesheet_index = sheet->second;
+
+		uint64_t key = (static_cast<uint64_t>(sheet->second) << 32)
+			| emitter.sequence;
+		auto iter = resolved.find(key);
+		if (iter != end(resolved)) {
+			emitter.frames = iter->second->frames;
+			emitter.frame_count = iter->second->frame_count;
+			continue;
+		}
+		resolved.emplace(key, &emitter);
+
+		emitter.frames = FindSequenceFrames(
+			sheet->second, emitter.sequence, emitter.frame_count);
+		if (!emitter.frames) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"%s: no region of %s is a frame of %s\n",
+				AtomName(object.id).c_str(),
+				AtomName(emitter.spritesheet_id).c_str(),
+				AtomName(emitter.sequence).c_str());
+		}
 	}
+}
 
-	title_ = in["title"].asString();
-	width_ = in["width"].asInt();
-	height_ = in["height"].asInt();
+const int* Scene::FindSequenceFrames(
+		int spritesheet_index,
+		Atom sequence,
+		int &frame_count) {
+	const SceneSpritesheet &sheet = spritesheets_[spritesheet_index];
+	StringRef prefix = AtomName(sequence);
+	vector<pair<long, int>> matches;
+	for (size_t i = 0; i < sheet.regions.size(); ++i) {
+		long number;
+		if (ParseFrameName(
+				AtomName(sheet.regions[i].name), prefix, number)) {
+			matches.emplace_back(number, static_cast<int>(i));
+		}
+	}
+	frame_count = static_cast<int>(matches.size());
+	if (matches.empty()) {
+		return nullptr;
+	}
 
-	ProcessSpritesheets(prefix, in["spritesheets"]);
-	ProcessTextures(prefix, in["textures"]);
-	ProcessSceneObjects(prefix, in["objects"]);
+	sort(begin(matches), end(matches));
+	int *frames = static_cast<int*>(arena_.Allocate(
+		matches.size() * sizeof(int), alignof(int)));
+	for (size_t i = 0; i < matches.size(); ++i) {
+		frames[i] = matches[i].second;
+	}
+	return frames;
+}
+
+void Scene::ResolveCompositeParts() {
+	unordered_map<Atom, int> spritesheet_index;
+	for (size_t i = 0; i < spritesheets_.size(); ++i) {
+		spritesheet_index[spritesheets_[i].id] = static_cast<int>(i);
+	}
+
+	for (auto &object: objects_) {
+		if (!object.composite) {
+			continue;
+		}
+		if (object.texture) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"%s: drawing the composite instead of texture_id=%s\n",
+				AtomName(object.id).c_str(),
+				FormatTextureId(*object.texture).c_str());
+		}
+
+		for (int i = 0; i < object.composite->part_count; ++i) {
+			SceneCompositePart &part = object.composite->parts[i];
+			auto iter = spritesheet_index.find(part.texture_id);
+			int region = iter != end(spritesheet_index)
+				? spritesheets_[iter->second].FindRegion(part.region_id)
+				: -1;
+			if (region < 0) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"%s: no spritesheet region matches composite part"
+					" %s:%s\n",
+					AtomName(object.id).c_str(),
+					AtomName(part.texture_id).c_str(),
+					AtomName(part.region_id).c_str());
+				continue;
+			}
+			part.spritesheet_index = iter->second;
+			part.region_index = region;
+		}
+	}
+}
+
+void Scene::BuildComposites() {
+	composites_.clear();
+
+	unordered_map<string, int> composite_index;
+	string key;
+	for (auto &object: objects_) {
+		if (!object.composite) {
+			continue;
+		}
+
+		SceneComponentComposite &composite = *object.composite;
+		composite.composite_index = -1;
+		const SceneCompositePart *parts = composite.parts;
+		bool resolved = true;
+		int width = 0;
+		int height = 0;
+		key.clear();
+		for (int i = 0; i < composite.part_count; ++i) {
+			const SceneCompositePart &part = parts[i];
+			if (part.spritesheet_index < 0) {
+				resolved = false;
+				break;
+			}
+			const SceneSceneSpritesheetRegion &region =
+				spritesheets_[part.spritesheet_index]
+					.regions[part.region_index];
+			width = max(width, part.x + region.width);
+			height = max(height, part.y + region.height);
+			AppendCompositePartKey(part, key);
+		}
+		if (!resolved || width <= 0 || height <= 0) {
+			continue;
+		}
+
+		auto iter = composite_index.find(key);
+		if (iter == end(composite_index)) {
+			SceneComposite out;
+			out.key = arena_.CopyString(key);
+			out.parts = parts;
+			out.part_count = composite.part_count;
+			out.width = width;
+			out.height = height;
+			iter = composite_index.emplace(
+				key, static_cast<int>(composites_.size())).first;
+			composites_.push_back(out);
+		}
+		composite.composite_index = iter->second;
+	}
+}
+
+int SceneSpritesheet::FindRegion(Atom name) const {
+	if (region_slots.empty()) {
+		return -1;
+	}
+
+	const size_t mask = region_slots.size() - 1;
+	size_t slot = HashAtom(name) & mask;
+	for (;;) {
+		int index = region_slots[slot];
+		if (index < 0 || regions[index].name == name) {
+			return index;
+		}
+		slot = (slot + 1) & mask;
+	}
 }
 
 void Scene::ProcessTextures(
@@ -104,9 +1669,10 @@ void Scene::ProcessTextures(
 		const auto &json_object = in[i];
 
 		SceneTexture texture;
-		texture.id = json_object["id"].asString();
-		texture.path = prefix + json_object["path"].asString();
-		textures_.emplace_back(std::move(texture));
+		texture.id = InternAtom(json_object["id"].asString());
+		texture.path = arena_.CopyString(
+			prefix + json_object["path"].asString());
+		textures_.push_back(texture);
 	}
 }
 
@@ -129,22 +1695,105 @@ void Scene::ProcessSpritesheets(
 		const auto &json_object = in[i];
 
 		SceneSpritesheet sheet;
-		sheet.id = json_object["id"].asString();
-		sheet.path = prefix + json_object["path"].asString();
-		ProcessTextureAtlasXml(prefix, sheet);
-
+		sheet.id = InternAtom(json_object["id"].asString());
+		sheet.path = arena_.CopyString(
+			prefix + json_object["path"].asString());
 		spritesheets_.emplace_back(move(sheet));
 	}
 }
 
-void Scene::ProcessTextureAtlasXml(
+void Scene::ProcessTextureAtlases(
+		const string &prefix,
+		ThreadPool *pool) {
+	if (!pool || spritesheets_.size() < 2) {
+		for (auto &sheet: spritesheets_) {
+			ProcessTextureAtlas(prefix, sheet, arena_);
+		}
+		return;
+	}
+
+	// Every atlas but the first goes to the pool; this thread reads the
+	// first one instead of idling. Workers allocate region names from
+	// arenas of their own, which join arena_ once all of them are done.
+	vector<Arena> arenas(spritesheets_.size());
+	vector<future<void>> pending;
+	pending.reserve(spritesheets_.size() - 1);
+	for (size_t i = 1; i < spritesheets_.size(); ++i) {
+		SceneSpritesheet *sheet = &spritesheets_[i];
+		Arena *arena = &arenas[i];
+		pending.emplace_back(pool->Submit(
+			[this, &prefix, sheet, arena]() {
+				ProcessTextureAtlas(prefix, *sheet, *arena);
+			}));
+	}
+
+	exception_ptr error;
+	try {
+		ProcessTextureAtlas(prefix, spritesheets_[0], arena_);
+	} catch (...) {
+		error = current_exception();
+	}
+
+	// Tasks reference the sheets, so wait for all of them before
+	// reporting the first failure.
+	for (auto &result: pending) {
+		result.wait();
+	}
+	for (auto &result: pending) {
+		try {
+			result.get();
+		} catch (...) {
+			if (!error) {
+				error = current_exception();
+			}
+		}
+	}
+	for (auto &arena: arenas) {
+		arena_.Absorb(move(arena));
+	}
+	if (error) {
+		rethrow_exception(error);
+	}
+}
+
+void Scene::ProcessTextureAtlas(
 		const string &prefix,
-		SceneSpritesheet &out) const {
+		SceneSpritesheet &out,
+		Arena &arena) const {
 	SDL_LogInfo(
 		SDL_LOG_CATEGORY_SYSTEM,
-		"Processing XML texture atlas %s...\n",
+		"Processing texture atlas %s...\n",
 		out.path.c_str());
 
+	MappedFile file;
+	string image_path;
+	if (file.Open(out.path.c_str())
+			&& ReadTextureAtlas(
+				file.data(),
+				file.size(),
+				image_path,
+				out.regions)) {
+		out.image_path = arena.CopyString(prefix + image_path);
+	} else {
+		SDL_LogInfo(
+			SDL_LOG_CATEGORY_SYSTEM,
+			"Reading %s with tinyxml2\n",
+			out.path.c_str());
+		ProcessTextureAtlasXml(prefix, out, arena);
+	}
+
+	IndexRegions(out);
+
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_SYSTEM,
+		"Processed %lu SubTexture-s.\n",
+		static_cast<unsigned long>(out.regions.size()));
+}
+
+void Scene::ProcessTextureAtlasXml(
+		const string &prefix,
+		SceneSpritesheet &out,
+		Arena &arena) const {
 	using namespace tinyxml2;
 
 	out.regions.clear();
@@ -171,7 +1820,7 @@ void Scene::ProcessTextureAtlasXml(
 		throw runtime_error("Failed to get TextureAtlas.imagePath");
 	}
 
-	out.image_path = prefix + string(raw_path);
+	out.image_path = arena.CopyString(prefix + string(raw_path));
 
 	for (XMLElement *current = root->FirstChildElement("SubTexture");
 			current;
@@ -182,7 +1831,7 @@ void Scene::ProcessTextureAtlasXml(
 		if (!raw_name) {
 			throw runtime_error("Failed to get SubTexture.name");
 		}
-		region.name = raw_name;
+		region.name = InternAtom(raw_name);
 
 		if (current->QueryAttribute("x", &region.x)
 				!= XML_NO_ERROR) {
@@ -222,11 +1871,6 @@ void Scene::ProcessTextureAtlasXml(
 
 		out.regions.emplace_back(move(region));
 	}
-
-	SDL_LogInfo(
-		SDL_LOG_CATEGORY_SYSTEM,
-		"Processed %lu SubTexture-s.\n",
-		static_cast<unsigned long>(out.regions.size()));
 }
 
 void Scene::ProcessSceneObjects(
@@ -245,8 +1889,8 @@ void Scene::ProcessSceneObjects(
 		const auto &json_object = in[i];
 
 		SceneObject object;
-		object.id = json_object["id"].asString();
-		if (!object.id.size()) {
+		object.id = InternAtom(json_object["id"].asString());
+		if (kNoAtom == object.id) {
 			SDL_LogWarn(
 				SDL_LOG_CATEGORY_SYSTEM,
 				"Empty object id: skipping\n");
@@ -262,7 +1906,7 @@ void Scene::ProcessSceneObjects(
 			SDL_LogWarn(
 				SDL_LOG_CATEGORY_SYSTEM,
 				"Missing or malformatted position for %s: skipping\n",
-				object.id.c_str());
+				AtomName(object.id).c_str());
 			continue;
 		}
 		object.x = json_position[0].asInt();
@@ -270,14 +1914,14 @@ void Scene::ProcessSceneObjects(
 
 		ProcessObjectComponents(prefix, json_object["components"], object);
 
-		objects_.emplace_back(move(object));
+		objects_.push_back(object);
 	}
 }
 
 void Scene::ProcessObjectComponents(
 		const string &prefix,
 		const Json::Value &in,
-		SceneObject &out) const {
+		SceneObject &out) {
 	if (in.isNull()) {
 		return;
 	}
@@ -293,7 +1937,7 @@ void Scene::ProcessObjectComponents(
 				SDL_LOG_CATEGORY_SYSTEM,
 				"Missing or malformatted component type for"
 				" %s: skipping\n",
-				out.id.c_str());
+				AtomName(out.id).c_str());
 			continue;
 		}
 		const auto &type = json_type.asString();
@@ -303,7 +1947,7 @@ void Scene::ProcessObjectComponents(
 				SDL_LogWarn(
 					SDL_LOG_CATEGORY_SYSTEM,
 					"Redefined texture component for %s: ignoring\n",
-					out.id.c_str());
+					AtomName(out.id).c_str());
 				continue;
 			}
 
@@ -314,46 +1958,103 @@ void Scene::ProcessObjectComponents(
 				SDL_LogWarn(
 					SDL_LOG_CATEGORY_SYSTEM,
 					"Redefined texture_repeat component for %s: ignoring\n",
-					out.id.c_str());
+					AtomName(out.id).c_str());
 				continue;
 			}
 
 			out.texture_repeat = ProcessTextureRepeatComponent(
 				out, json_object);
+		} else if (type == "velocity") {
+			if (out.velocity) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined velocity component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.velocity = ProcessVelocityComponent(out, json_object);
+		} else if (type == "collider") {
+			if (out.collider) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined collider component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.collider = ProcessColliderComponent(out, json_object);
+		} else if (type == "animation") {
+			if (out.animation) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined animation component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.animation = ProcessAnimationComponent(out, json_object);
+		} else if (type == "composite") {
+			if (out.composite) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined composite component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.composite = ProcessCompositeComponent(out, json_object);
+		} else if (type == "transform") {
+			if (out.transform) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined transform component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.transform = ProcessTransformComponent(out, json_object);
+		} else if (type == "emitter") {
+			if (out.emitter) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_SYSTEM,
+					"Redefined emitter component for %s: ignoring\n",
+					AtomName(out.id).c_str());
+				continue;
+			}
+
+			out.emitter = ProcessEmitterComponent(out, json_object);
 		} else {
 			SDL_LogWarn(
 				SDL_LOG_CATEGORY_SYSTEM,
 				"Unknown component type %s for %s: ignoring\n",
 				type.c_str(),
-				out.id.c_str());
+				AtomName(out.id).c_str());
 		}
 	}
 }
 
-unique_ptr<SceneComponentTexture>
+SceneComponentTexture*
 Scene::ProcessTextureComponent(
 		const SceneObject &object,
-		const Json::Value &in) const {
+		const Json::Value &in) {
 	const auto &json_texture_id = in["texture_id"];
 	if (json_texture_id.isNull() || !json_texture_id.isString()) {
 		SDL_LogWarn(
 			SDL_LOG_CATEGORY_SYSTEM,
 			"Missing texture_id for texture component "
 			"in %s\n",
-			object.id.c_str());
+			AtomName(object.id).c_str());
 		return nullptr;
 	}
 
-	auto ptr = unique_ptr<SceneComponentTexture>(
-		new SceneComponentTexture);
-	ptr->texture_id = json_texture_id.asString();
-	return move(ptr);
+	return NewTextureComponent(arena_, json_texture_id.asString());
 }
 
-unique_ptr<SceneComponentTextureRepeat>
+SceneComponentTextureRepeat*
 Scene::ProcessTextureRepeatComponent(
 		const SceneObject &object,
-		const Json::Value &in) const {
+		const Json::Value &in) {
 	const auto &json_repeat = in["repeat"];
 	if (json_repeat.isNull()
 		|| !json_repeat.isArray()
@@ -364,15 +2065,219 @@ Scene::ProcessTextureRepeatComponent(
 			SDL_LOG_CATEGORY_SYSTEM,
 			"Missing or malformated repeat texture_repeat "
 			"comonent in %s\n",
-			object.id.c_str());
+			AtomName(object.id).c_str());
 		return nullptr;
 	}
 
-	auto ptr = unique_ptr<SceneComponentTextureRepeat>(
-		new SceneComponentTextureRepeat);
+	auto ptr = arena_.New<SceneComponentTextureRepeat>();
 	ptr->repeat_x = json_repeat[0].asInt();
 	ptr->repeat_y = json_repeat[1].asInt();
-	return move(ptr);
+	return ptr;
+}
+
+SceneComponentVelocity*
+Scene::ProcessVelocityComponent(
+		const SceneObject &object,
+		const Json::Value &in) {
+	const auto &json_velocity = in["velocity"];
+	if (json_velocity.isNull()
+		|| !json_velocity.isArray()
+		|| json_velocity.size() != 2
+		|| !json_velocity[0].isNumeric()
+		|| !json_velocity[1].isNumeric()) {
+		SDL_LogWarn(
+			SDL_LOG_CATEGORY_SYSTEM,
+			"Missing or malformatted velocity for velocity "
+			"component in %s\n",
+			AtomName(object.id).c_str());
+		return nullptr;
+	}
+
+	// angular_velocity is optional; anything but a number means none.
+	const auto &json_angular = in["angular_velocity"];
+
+	auto ptr = arena_.New<SceneComponentVelocity>();
+	ptr->x = json_velocity[0].asFloat();
+	ptr->y = json_velocity[1].asFloat();
+	ptr->angular = json_angular.isNumeric() ? json_angular.asFloat() : 0.0f;
+	return ptr;
+}
+
+SceneComponentCollider*
+Scene::ProcessColliderComponent(
+		const SceneObject &/*object*/,
+		const Json::Value &in) {
+	// radius is optional; without a positive one the sprite decides.
+	const auto &json_radius = in["radius"];
+
+	auto ptr = arena_.New<SceneComponentCollider>();
+	ptr->radius = json_radius.isNumeric() && json_radius.asFloat() > 0.0f
+		? json_radius.asFloat()
+		: 0.0f;
+	return ptr;
+}
+
+SceneComponentAnimation*
+Scene::ProcessAnimationComponent(
+		const SceneObject &object,
+		const Json::Value &in) {
+	const auto &json_sequence = in["sequence"];
+	if (!json_sequence.isString() || json_sequence.asString().empty()) {
+		SDL_LogWarn(
+			SDL_LOG_CATEGORY_SYSTEM,
+			"Missing sequence for animation component in %s\n",
+			AtomName(object.id).c_str());
+		return nullptr;
+	}
+
+	// fps and loop are optional; anything of the wrong type means the
+	// default.
+	const auto &json_fps = in["fps"];
+	const auto &json_loop = in["loop"];
+
+	return NewAnimationComponent(
+		arena_,
+		InternAtom(json_sequence.asString()),
+		json_fps.isNumeric() ? json_fps.asFloat() : kDefaultAnimationFps,
+		!json_loop.isBool() || json_loop.asBool());
+}
+
+SceneComponentComposite*
+Scene::ProcessCompositeComponent(
+		const SceneObject &object,
+		const Json::Value &in) {
+	const auto &json_parts = in["parts"];
+	vector<SceneCompositePart> parts;
+	for (Json::Value::ArrayIndex i = 0;
+		json_parts.isArray() && i < json_parts.size();
+		++i) {
+		const auto &json_part = json_parts[i];
+		const auto &json_texture_id = json_part["texture_id"];
+		const auto &json_offset = json_part["offset"];
+		const auto &json_flip = json_part["flip"];
+
+		SceneCompositePart part;
+		if (!json_texture_id.isString()
+				|| !json_offset.isArray()
+				|| json_offset.size() != 2
+				|| !json_offset[0].isInt()
+				|| !json_offset[1].isInt()
+				|| !MakeCompositePart(
+					json_texture_id.asString(),
+					json_offset[0].asInt(),
+					json_offset[1].asInt(),
+					json_flip.isBool() && json_flip.asBool(),
+					part)) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_SYSTEM,
+				"Malformatted part %lu of composite component"
+				" in %s: skipping\n",
+				static_cast<unsigned long>(i),
+				AtomName(object.id).c_str());
+			continue;
+		}
+		parts.push_back(part);
+	}
+
+	if (parts.empty()) {
+		SDL_LogWarn(
+			SDL_LOG_CATEGORY_SYSTEM,
+			"Missing parts for composite component in %s\n",
+			AtomName(object.id).c_str());
+		return nullptr;
+	}
+
+	return NewCompositeComponent(arena_, parts.data(), parts.size());
+}
+
+SceneComponentTransform*
+Scene::ProcessTransformComponent(
+		const SceneObject &/*object*/,
+		const Json::Value &in) {
+	// Every field is optional; anything of the wrong type means the
+	// default. scale is one number for both axes or a pair.
+	const auto &json_rotation = in["rotation"];
+	const auto &json_scale = in["scale"];
+	const auto &json_pivot = in["pivot"];
+
+	float scale_x = 1.0f;
+	float scale_y = 1.0f;
+	ReadNumberOrPair(json_scale, scale_x, scale_y);
+
+	float pivot_x = 0.5f;
+	float pivot_y = 0.5f;
+	if (json_pivot.isArray()
+			&& json_pivot.size() == 2
+			&& json_pivot[0].isNumeric()
+			&& json_pivot[1].isNumeric()) {
+		pivot_x = json_pivot[0].asFloat();
+		pivot_y = json_pivot[1].asFloat();
+	}
+
+	return NewTransformComponent(
+		arena_,
+		json_rotation.isNumeric() ? json_rotation.asFloat() : 0.0f,
+		scale_x,
+		scale_y,
+		pivot_x,
+		pivot_y);
+}
+
+SceneComponentEmitter*
+Scene::ProcessEmitterComponent(
+		const SceneObject &object,
+		const Json::Value &in) {
+	const auto &json_spritesheet = in["spritesheet"];
+	const auto &json_sequence = in["sequence"];
+	if (!json_spritesheet.isString()
+			|| !json_sequence.isString()
+			|| json_sequence.asString().empty()) {
+		SDL_LogWarn(
+			SDL_LOG_CATEGORY_SYSTEM,
+			"Missing spritesheet or sequence for emitter"
+			" component in %s\n",
+			AtomName(object.id).c_str());
+		return nullptr;
+	}
+
+	SceneComponentEmitter *emitter = NewEmitterComponent(
+		arena_,
+		InternAtom(json_spritesheet.asString()),
+		InternAtom(json_sequence.asString()));
+
+	// Everything else is optional; anything of the wrong type means the
+	// default. life and speed are one number or a [min, max] pair.
+	const auto &json_rate = in["rate"];
+	const auto &json_burst = in["burst"];
+	const auto &json_capacity = in["capacity"];
+	const auto &json_angle = in["angle"];
+	const auto &json_spread = in["spread"];
+	const auto &json_offset = in["offset"];
+	const auto &json_random_frame = in["random_frame"];
+	if (json_rate.isNumeric()) {
+		emitter->rate = json_rate.asFloat();
+	}
+	if (json_burst.isNumeric()) {
+		emitter->burst = static_cast<int>(json_burst.asDouble());
+	}
+	if (json_capacity.isNumeric()) {
+		emitter->capacity = static_cast<int>(json_capacity.asDouble());
+	}
+	ReadNumberOrPair(in["life"], emitter->life_min, emitter->life_max);
+	ReadNumberOrPair(in["speed"], emitter->speed_min, emitter->speed_max);
+	if (json_angle.isNumeric()) {
+		emitter->angle = json_angle.asFloat();
+	}
+	if (json_spread.isNumeric()) {
+		emitter->spread = json_spread.asFloat();
+	}
+	if (json_offset.isArray()) {
+		ReadNumberOrPair(json_offset, emitter->offset_x, emitter->offset_y);
+	}
+	if (json_random_frame.isBool()) {
+		emitter->random_frame = json_random_frame.asBool();
+	}
+	return emitter;
 }
 
-} // namespace foo
\ No newline at end of file
+} // namespace foo
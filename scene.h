@@ -26,13 +26,24 @@ THE SOFTWARE.
 #include <string>
 #include <vector>
 #include <utility>
-#include <memory>
+#include <iosfwd>
+#include <cstddef>
 #include "json/json-forwards.h"
+#include "json_pull_reader.h"
+#include "arena.h"
+#include "atom.h"
+#include "string_ref.h"
 
 namespace foo {
 
+class ThreadPool;
+
+// Ids and names are atoms. Paths point into the Arena of the Scene that
+// loaded them and components are allocated from it, so neither outlives
+// their Scene.
+
 struct SceneSceneSpritesheetRegion {
-	std::string name;
+	Atom name;
 	int x;
 	int y;
 	int width;
@@ -40,19 +51,37 @@ struct SceneSceneSpritesheetRegion {
 };
 
 struct SceneSpritesheet {
-	std::string id;
-	std::string path;
-	std::string image_path;
+	Atom id;
+	StringRef path;
+	StringRef image_path;
 	std::vector<SceneSceneSpritesheetRegion> regions;
+	// Open-addressed hash table of indices into regions, keyed by name and
+	// built when the atlas is loaded. Empty slots are -1.
+	std::vector<int> region_slots;
+
+	// Returns the index of the region called name, or -1.
+	int
+	FindRegion(Atom name) const;
 };
 
 struct SceneTexture {
-	std::string id;
-	std::string path;
+	Atom id;
+	StringRef path;
 };
 
 struct SceneComponentTexture {
-	std::string texture_id;
+	// "id" in the scene file becomes texture_id; "sheet:region" becomes
+	// texture_id for the sheet and region_id for the region, which is
+	// kNoAtom otherwise.
+	Atom texture_id;
+	Atom region_id;
+	// Ids resolved when the scene is loaded: either texture_index
+	// into Scene::textures(), or spritesheet_index into
+	// Scene::spritesheets() together with region_index into its regions.
+	// Unused or unresolved handles are -1.
+	int texture_index;
+	int spritesheet_index;
+	int region_index;
 };
 
 struct SceneComponentTextureRepeat {
@@ -60,22 +89,161 @@ struct SceneComponentTextureRepeat {
 	int repeat_y;
 };
 
+// Initial motion, in pixels and degrees per second.
+struct SceneComponentVelocity {
+	float x;
+	float y;
+	float angular;
+};
+
+// Collision circle centred on the sprite. A radius of zero means half the
+// smaller side of the sprite's spritesheet region.
+struct SceneComponentCollider {
+	float radius;
+};
+
+// Initial rotation, in degrees clockwise, and scale of the sprite, both
+// about a pivot given as a fraction of its size; (0.5, 0.5) is the
+// centre.
+struct SceneComponentTransform {
+	float rotation;
+	float scale_x;
+	float scale_y;
+	float pivot_x;
+	float pivot_y;
+};
+
+// Plays the regions of the object's spritesheet whose names are sequence
+// followed by a frame number, such as fire00.png to fire19.png for
+// "fire", in numeric order.
+struct SceneComponentAnimation {
+	Atom sequence;
+	float fps;
+	bool loop;
+	// Region indices of the frames, resolved when the scene is loaded and
+	// allocated from its arena. Null if no region matched.
+	const int *frames;
+	int frame_count;
+};
+
+// Spawns particles drawn with the regions of spritesheet_id named
+// sequence followed by a frame number, as for animations. Particles leave
+// from offset of the object's position, rate per second plus burst at
+// once when the object is created, heading angle degrees clockwise from
+// the x axis give or take half of spread. Life, in seconds, and speed are
+// picked between their minimum and maximum. Particles fade out and play
+// the frames over their life, or show one random frame each if
+// random_frame is set. A capacity of zero means enough for rate and
+// burst.
+struct SceneComponentEmitter {
+	Atom spritesheet_id;
+	Atom sequence;
+	float rate;
+	int burst;
+	int capacity;
+	float life_min;
+	float life_max;
+	float speed_min;
+	float speed_max;
+	float angle;
+	float spread;
+	float offset_x;
+	float offset_y;
+	bool random_frame;
+	// Resolved when the scene is loaded and allocated from its arena;
+	// -1 and null if the spritesheet or the sequence did not resolve.
+	int spritesheet_index;
+	const int *frames;
+	int frame_count;
+};
+
+// One spritesheet region of a composite, with its top-left corner at
+// (x, y) from that of the composite. flip mirrors it horizontally, so
+// one-sided parts such as wings can be used on both sides.
+struct SceneCompositePart {
+	Atom texture_id;
+	Atom region_id;
+	int x;
+	int y;
+	bool flip;
+	// Resolved like SceneComponentTexture; -1 if unresolved.
+	int spritesheet_index;
+	int region_index;
+};
+
+// Draws the object as its parts assembled into one image. Objects with
+// the same parts share a composite, which the render system bakes once.
+struct SceneComponentComposite {
+	SceneCompositePart *parts;
+	int part_count;
+	// Index into Scene::composites(), or -1 if a part did not resolve.
+	int composite_index;
+};
+
+// A distinct list of parts used by one or more objects. key spells the
+// parts out and is the same in every scene that uses them.
+struct SceneComposite {
+	StringRef key;
+	const SceneCompositePart *parts;
+	int part_count;
+	int width;
+	int height;
+};
+
 struct SceneObject {
-	std::string id;
+	Atom id;
 	int x;
 	int y;
-	std::unique_ptr<SceneComponentTexture> texture;
-	std::unique_ptr<SceneComponentTextureRepeat> texture_repeat;
+	SceneComponentTexture *texture;
+	SceneComponentTextureRepeat *texture_repeat;
+	SceneComponentVelocity *velocity;
+	SceneComponentCollider *collider;
+	SceneComponentAnimation *animation;
+	SceneComponentComposite *composite;
+	SceneComponentTransform *transform;
+	SceneComponentEmitter *emitter;
+
+	SceneObject()
+		: id(kNoAtom)
+		, x(0)
+		, y(0)
+		, texture(nullptr)
+		, texture_repeat(nullptr)
+		, velocity(nullptr)
+		, collider(nullptr)
+		, animation(nullptr)
+		, composite(nullptr)
+		, transform(nullptr)
+		, emitter(nullptr) {}
+};
+
+// How LoadFromFile reads scene.json. kSceneParserStream fills the scene as
+// tokens are read; kSceneParserDom builds a Json::Value tree first and is
+// kept as the reference implementation.
+enum SceneParser {
+	kSceneParserStream,
+	kSceneParserDom,
 };
 
+// Writes the texture_id of component as it appears in the scene file.
+std::string
+FormatTextureId(const SceneComponentTexture &component);
+
+// Returns the directory part of file_name including the trailing
+// separator, or an empty string. Scene asset paths are relative to it.
+std::string
+ScenePathPrefix(const char *file_name);
+
 class Scene {
-	std::string id_;
-	std::string title_;
+	Arena arena_;
+	StringRef id_;
+	StringRef title_;
 	int width_;
 	int height_;
 	std::vector<SceneTexture> textures_;
 	std::vector<SceneSpritesheet> spritesheets_;
 	std::vector<SceneObject> objects_;
+	std::vector<SceneComposite> composites_;
 
 public:
 	Scene();
@@ -88,6 +256,7 @@ public:
 	friend void swap(Scene &lhs, Scene &rhs) {
 		using std::swap;
 
+		swap(lhs.arena_, rhs.arena_);
 		swap(lhs.id_, rhs.id_);
 		swap(lhs.title_, rhs.title_);
 		swap(lhs.width_, rhs.width_);
@@ -95,15 +264,45 @@ public:
 		swap(lhs.textures_, rhs.textures_);
 		swap(lhs.spritesheets_, rhs.spritesheets_);
 		swap(lhs.objects_, rhs.objects_);
+		swap(lhs.composites_, rhs.composites_);
 	}
 
+	// Texture atlases are read on pool when one is given.
+	void
+	LoadFromFile(
+		const char *file_name,
+		SceneParser parser = kSceneParserStream,
+		ThreadPool *pool = nullptr);
+
+	// Loads a scene baked by foo-asteroids-scene-compiler. Returns false,
+	// leaving the scene untouched, if the file is missing, was compiled by
+	// another version, or any of its sources changed since; callers then
+	// fall back to LoadFromFile on the JSON scene.
+	bool
+	LoadFromCompiledFile(const char *file_name);
+
+	// Reads a scene document from in. Relative asset paths are resolved
+	// against prefix, which is empty or ends with a path separator.
+	void
+	LoadFromStream(
+		std::istream &in,
+		const std::string &prefix,
+		ThreadPool *pool = nullptr);
+
+	// Reads the scene document in [data, data + size) with JsonPullReader,
+	// without materializing a Json::Value tree. Accepts the same documents
+	// and logs the same warnings as LoadFromStream.
 	void
-	LoadFromFile(const char *file_name);
+	LoadFromBuffer(
+		const char *data,
+		size_t size,
+		const std::string &prefix,
+		ThreadPool *pool = nullptr);
 
-	inline const std::string&
+	inline const StringRef&
 	id() const { return id_; }
 
-	inline const std::string&
+	inline const StringRef&
 	title() const { return title_; }
 
 	inline int
@@ -121,7 +320,14 @@ public:
 	inline const std::vector<SceneObject>&
 	objects() const { return objects_; }
 
+	inline const std::vector<SceneComposite>&
+	composites() const { return composites_; }
+
 private:
+	// Drops everything loaded so far, including the arena.
+	void
+	Clear();
+
 	void
 	ProcessSceneObjects(
 		const std::string &prefix,
@@ -131,31 +337,111 @@ private:
 	ProcessObjectComponents(
 		const std::string &prefix,
 		const Json::Value &in,
-		SceneObject &out) const;
+		SceneObject &out);
 
-	std::unique_ptr<SceneComponentTexture>
+	SceneComponentTexture*
 	ProcessTextureComponent(
 		const SceneObject &object,
-		const Json::Value &in) const;
+		const Json::Value &in);
 
-	std::unique_ptr<SceneComponentTextureRepeat>
+	SceneComponentTextureRepeat*
 	ProcessTextureRepeatComponent(
 		const SceneObject &object,
-		const Json::Value &in) const;
+		const Json::Value &in);
+
+	SceneComponentVelocity*
+	ProcessVelocityComponent(
+		const SceneObject &object,
+		const Json::Value &in);
+
+	SceneComponentCollider*
+	ProcessColliderComponent(
+		const SceneObject &object,
+		const Json::Value &in);
+
+	SceneComponentAnimation*
+	ProcessAnimationComponent(
+		const SceneObject &object,
+		const Json::Value &in);
+
+	SceneComponentComposite*
+	ProcessCompositeComponent(
+		const SceneObject &object,
+		const Json::Value &in);
+
+	SceneComponentTransform*
+	ProcessTransformComponent(
+		const SceneObject &object,
+		const Json::Value &in);
+
+	SceneComponentEmitter*
+	ProcessEmitterComponent(
+		const SceneObject &object,
+		const Json::Value &in);
 
 	void
 	ProcessSpritesheets(
 		const std::string &prefix,
 		const Json::Value &in);
 
+	void
+	ProcessTextureAtlases(
+		const std::string &prefix,
+		ThreadPool *pool);
+
+	void
+	ProcessTextureAtlas(
+		const std::string &prefix,
+		SceneSpritesheet &out,
+		Arena &arena) const;
+
 	void
 	ProcessTextureAtlasXml(
 		const std::string &prefix,
-		SceneSpritesheet &out) const;
+		SceneSpritesheet &out,
+		Arena &arena) const;
 
 	void ProcessTextures(
 		const std::string &prefix,
 		const Json::Value &in);
+
+	void
+	StreamSceneObjects(JsonPullReader &in);
+
+	void
+	StreamSpritesheets(
+		const std::string &prefix,
+		JsonPullReader &in);
+
+	void
+	StreamTextures(
+		const std::string &prefix,
+		JsonPullReader &in);
+
+	void
+	ResolveTextureReferences();
+
+	void
+	ResolveAnimationFrames();
+
+	void
+	ResolveEmitters();
+
+	// Region indices of the frames of sequence in the spritesheet at
+	// spritesheet_index, in numeric order and allocated from the arena.
+	// Returns null if no region matches.
+	const int*
+	FindSequenceFrames(
+		int spritesheet_index,
+		Atom sequence,
+		int &frame_count);
+
+	void
+	ResolveCompositeParts();
+
+	// Groups objects with the same resolved parts into composites_.
+	void
+	BuildComposites();
 };
 
 } // namespace foo
@@ -0,0 +1,50 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "scene.h"
+#include "compiled_scene.h"
+#include "SDL.h"
+#include <cstdio>
+#include <exception>
+
+using namespace foo;
+
+// Bakes a JSON scene and its texture atlases into a compiled scene that
+// the game maps at startup instead of parsing. Asset paths are stored
+// relative to the scene, so write the output next to scene.json.
+int
+main(int argc, char **argv) {
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s scene.json scene.bin\n", argv[0]);
+		return 2;
+	}
+
+	try {
+		Scene scene;
+		scene.LoadFromFile(argv[1]);
+		WriteCompiledScene(scene, argv[1], argv[2]);
+	} catch (const std::exception &e) {
+		fprintf(stderr, "%s: %s\n", argv[1], e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,265 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "scene_diff.h"
+#include "SDL_log.h"
+#include <unordered_map>
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+bool
+AreRegionsEqual(
+		const vector<SceneSceneSpritesheetRegion> &lhs,
+		const vector<SceneSceneSpritesheetRegion> &rhs) {
+	if (lhs.size() != rhs.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < lhs.size(); ++i) {
+		if (lhs[i].name != rhs[i].name
+				|| lhs[i].x != rhs[i].x
+				|| lhs[i].y != rhs[i].y
+				|| lhs[i].width != rhs[i].width
+				|| lhs[i].height != rhs[i].height) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool
+AreCompositesEqual(
+		const SceneComponentComposite &lhs,
+		const SceneComponentComposite &rhs) {
+	if (lhs.part_count != rhs.part_count) {
+		return false;
+	}
+
+	for (int i = 0; i < lhs.part_count; ++i) {
+		if (lhs.parts[i].texture_id != rhs.parts[i].texture_id
+				|| lhs.parts[i].region_id != rhs.parts[i].region_id
+				|| lhs.parts[i].x != rhs.parts[i].x
+				|| lhs.parts[i].y != rhs.parts[i].y
+				|| lhs.parts[i].flip != rhs.parts[i].flip) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Frames follow the spritesheet, whose changes are diffed separately.
+bool
+AreEmittersEqual(
+		const SceneComponentEmitter &lhs,
+		const SceneComponentEmitter &rhs) {
+	return lhs.spritesheet_id == rhs.spritesheet_id
+		&& lhs.sequence == rhs.sequence
+		&& lhs.rate == rhs.rate
+		&& lhs.burst == rhs.burst
+		&& lhs.capacity == rhs.capacity
+		&& lhs.life_min == rhs.life_min
+		&& lhs.life_max == rhs.life_max
+		&& lhs.speed_min == rhs.speed_min
+		&& lhs.speed_max == rhs.speed_max
+		&& lhs.angle == rhs.angle
+		&& lhs.spread == rhs.spread
+		&& lhs.offset_x == rhs.offset_x
+		&& lhs.offset_y == rhs.offset_y
+		&& lhs.random_frame == rhs.random_frame;
+}
+
+bool
+AreObjectsEqual(const SceneObject &lhs, const SceneObject &rhs) {
+	if (lhs.x != rhs.x || lhs.y != rhs.y) {
+		return false;
+	}
+
+	if (!lhs.texture != !rhs.texture
+			|| (lhs.texture
+				&& (lhs.texture->texture_id != rhs.texture->texture_id
+					|| lhs.texture->region_id
+						!= rhs.texture->region_id))) {
+		return false;
+	}
+
+	if (!lhs.texture_repeat != !rhs.texture_repeat
+			|| (lhs.texture_repeat
+				&& (lhs.texture_repeat->repeat_x
+						!= rhs.texture_repeat->repeat_x
+					|| lhs.texture_repeat->repeat_y
+						!= rhs.texture_repeat->repeat_y))) {
+		return false;
+	}
+
+	if (!lhs.velocity != !rhs.velocity
+			|| (lhs.velocity
+				&& (lhs.velocity->x != rhs.velocity->x
+					|| lhs.velocity->y != rhs.velocity->y
+					|| lhs.velocity->angular
+						!= rhs.velocity->angular))) {
+		return false;
+	}
+
+	if (!lhs.collider != !rhs.collider
+			|| (lhs.collider
+				&& lhs.collider->radius != rhs.collider->radius)) {
+		return false;
+	}
+
+	// Frames follow the spritesheet, whose changes are diffed separately.
+	if (!lhs.animation != !rhs.animation
+			|| (lhs.animation
+				&& (lhs.animation->sequence != rhs.animation->sequence
+					|| lhs.animation->fps != rhs.animation->fps
+					|| lhs.animation->loop != rhs.animation->loop))) {
+		return false;
+	}
+
+	if (!lhs.composite != !rhs.composite
+			|| (lhs.composite
+				&& !AreCompositesEqual(*lhs.composite, *rhs.composite))) {
+		return false;
+	}
+
+	if (!lhs.transform != !rhs.transform
+			|| (lhs.transform
+				&& (lhs.transform->rotation != rhs.transform->rotation
+					|| lhs.transform->scale_x != rhs.transform->scale_x
+					|| lhs.transform->scale_y != rhs.transform->scale_y
+					|| lhs.transform->pivot_x != rhs.transform->pivot_x
+					|| lhs.transform->pivot_y
+						!= rhs.transform->pivot_y))) {
+		return false;
+	}
+
+	if (!lhs.emitter != !rhs.emitter
+			|| (lhs.emitter
+				&& !AreEmittersEqual(*lhs.emitter, *rhs.emitter))) {
+		return false;
+	}
+
+	return true;
+}
+
+void
+MarkReferenceDirty(const SceneObject &object, SceneDiff &diff) {
+	if (!object.texture) {
+		return;
+	}
+
+	if (kNoAtom == object.texture->region_id) {
+		diff.dirty_textures.insert(object.texture->texture_id);
+	} else {
+		diff.dirty_spritesheets.insert(object.texture->texture_id);
+	}
+}
+
+} // namespace
+
+SceneDiff
+DiffScenes(const Scene &before, const Scene &after) {
+	SceneDiff diff;
+
+	diff.window_changed =
+		before.title() != after.title()
+		|| before.width() != after.width()
+		|| before.height() != after.height();
+
+	unordered_map<Atom, const SceneTexture*> old_textures;
+	for (const auto &texture: before.textures()) {
+		old_textures[texture.id] = &texture;
+	}
+	for (const auto &texture: after.textures()) {
+		auto iter = old_textures.find(texture.id);
+		if (iter == end(old_textures)
+				|| iter->second->path != texture.path) {
+			diff.changed_textures.insert(texture.id);
+		}
+		if (iter != end(old_textures)) {
+			old_textures.erase(iter);
+		}
+	}
+	for (const auto &removed: old_textures) {
+		diff.changed_textures.insert(removed.first);
+	}
+
+	unordered_map<Atom, const SceneSpritesheet*> old_sheets;
+	for (const auto &sheet: before.spritesheets()) {
+		old_sheets[sheet.id] = &sheet;
+	}
+	for (const auto &sheet: after.spritesheets()) {
+		auto iter = old_sheets.find(sheet.id);
+		if (iter == end(old_sheets)
+				|| iter->second->image_path != sheet.image_path
+				|| !AreRegionsEqual(iter->second->regions, sheet.regions)) {
+			diff.changed_spritesheets.insert(sheet.id);
+		}
+		if (iter != end(old_sheets)) {
+			old_sheets.erase(iter);
+		}
+	}
+	for (const auto &removed: old_sheets) {
+		diff.changed_spritesheets.insert(removed.first);
+	}
+
+	unordered_map<Atom, const SceneObject*> old_objects;
+	for (const auto &object: before.objects()) {
+		old_objects[object.id] = &object;
+	}
+	for (const auto &object: after.objects()) {
+		auto iter = old_objects.find(object.id);
+		if (iter == end(old_objects)) {
+			++diff.added_objects;
+			MarkReferenceDirty(object, diff);
+			continue;
+		}
+
+		if (!AreObjectsEqual(*iter->second, object)) {
+			++diff.modified_objects;
+			MarkReferenceDirty(*iter->second, diff);
+			MarkReferenceDirty(object, diff);
+		}
+		old_objects.erase(iter);
+	}
+	for (const auto &removed: old_objects) {
+		++diff.removed_objects;
+		MarkReferenceDirty(*removed.second, diff);
+	}
+
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_SYSTEM,
+		"Scene diff: %lu texture(s) and %lu spritesheet(s) changed,"
+		" objects %lu added, %lu removed, %lu modified\n",
+		static_cast<unsigned long>(diff.changed_textures.size()),
+		static_cast<unsigned long>(diff.changed_spritesheets.size()),
+		static_cast<unsigned long>(diff.added_objects),
+		static_cast<unsigned long>(diff.removed_objects),
+		static_cast<unsigned long>(diff.modified_objects));
+
+	return diff;
+}
+
+} // namespace foo
@@ -0,0 +1,85 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_SCENE_DIFF_H_
+#define FOO_ASTEROIDS_SCENE_DIFF_H_
+
+#include "scene.h"
+#include <set>
+
+namespace foo {
+
+// Describes what changed between two versions of the same scene, so that
+// systems can rebuild only the parts affected by a reload.
+struct SceneDiff {
+	// Title or window size changed.
+	bool window_changed;
+
+	// Textures that were added, removed or now point to another file.
+	std::set<Atom> changed_textures;
+
+	// Spritesheets that were added, removed, point to another image or
+	// have a different region table.
+	std::set<Atom> changed_spritesheets;
+
+	// Texture ids whose list of referencing objects changed. Spritesheet
+	// references are tracked by spritesheet id in dirty_spritesheets.
+	std::set<Atom> dirty_textures;
+	std::set<Atom> dirty_spritesheets;
+
+	size_t added_objects;
+	size_t removed_objects;
+	size_t modified_objects;
+
+	SceneDiff()
+		: window_changed(false)
+		, added_objects(0)
+		, removed_objects(0)
+		, modified_objects(0) {}
+
+	inline bool
+	IsTextureChanged(Atom id) const {
+		return changed_textures.count(id) != 0;
+	}
+
+	inline bool
+	IsTextureDirty(Atom id) const {
+		return dirty_textures.count(id) != 0;
+	}
+
+	inline bool
+	IsSpritesheetChanged(Atom id) const {
+		return changed_spritesheets.count(id) != 0;
+	}
+
+	inline bool
+	IsSpritesheetDirty(Atom id) const {
+		return dirty_spritesheets.count(id) != 0;
+	}
+};
+
+SceneDiff
+DiffScenes(const Scene &before, const Scene &after);
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_SCENE_DIFF_H_
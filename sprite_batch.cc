@@ -0,0 +1,284 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "sprite_batch.h"
+#include "SDL_log.h"
+#include <algorithm>
+
+namespace foo {
+
+namespace {
+
+const SDL_Color kWhite = { 255, 255, 255, 255 };
+
+} // namespace
+
+SpriteBatch::SpriteBatch()
+	: renderer_(nullptr)
+	, texture_(nullptr)
+	, inverse_width_(1.0f)
+	, inverse_height_(1.0f) {
+}
+
+SpriteBatch::~SpriteBatch() {}
+
+void SpriteBatch::Begin(SDL_Renderer *renderer) {
+	renderer_ = renderer;
+	texture_ = nullptr;
+	vertices_.clear();
+	stats_ = RenderStats();
+}
+
+void SpriteBatch::SetTexture(
+		SDL_Texture *texture,
+		int width,
+		int height) {
+	if (texture == texture_) {
+		return;
+	}
+
+	Flush();
+	texture_ = texture;
+	inverse_width_ = 1.0f / width;
+	inverse_height_ = 1.0f / height;
+}
+
+void SpriteBatch::Add(const SDL_Rect &clip, const SDL_Rect &destination) {
+	WriteQuad(
+		AddQuads(1),
+		destination.x,
+		destination.y,
+		destination.w,
+		destination.h,
+		clip);
+}
+
+inline void SpriteBatch::WriteQuad(
+		SDL_Vertex *out,
+		int x,
+		int y,
+		int w,
+		int h,
+		const SDL_Rect &clip) const {
+	float left = static_cast<float>(x);
+	float top = static_cast<float>(y);
+	float right = static_cast<float>(x + w);
+	float bottom = static_cast<float>(y + h);
+
+	float u0 = clip.x * inverse_width_;
+	float v0 = clip.y * inverse_height_;
+	float u1 = (clip.x + clip.w) * inverse_width_;
+	float v1 = (clip.y + clip.h) * inverse_height_;
+
+	out[0].position.x = left;
+	out[0].position.y = top;
+	out[0].color = kWhite;
+	out[0].tex_coord.x = u0;
+	out[0].tex_coord.y = v0;
+	out[1].position.x = right;
+	out[1].position.y = top;
+	out[1].color = kWhite;
+	out[1].tex_coord.x = u1;
+	out[1].tex_coord.y = v0;
+	out[2].position.x = right;
+	out[2].position.y = bottom;
+	out[2].color = kWhite;
+	out[2].tex_coord.x = u1;
+	out[2].tex_coord.y = v1;
+	out[3].position.x = left;
+	out[3].position.y = bottom;
+	out[3].color = kWhite;
+	out[3].tex_coord.x = u0;
+	out[3].tex_coord.y = v1;
+}
+
+void SpriteBatch::Add(const RenderList &list, const ClipTable &clips) {
+	size_t count = list.size();
+	SDL_Vertex *out = AddQuads(count);
+	for (size_t i = 0; i < count; ++i, out += 4) {
+		WriteQuad(
+			out,
+			list.x[i],
+			list.y[i],
+			list.w[i],
+			list.h[i],
+			clips[list.clip[i]]);
+	}
+}
+
+void SpriteBatch::Add(
+		const RenderList &list,
+		const ClipTable &clips,
+		const std::vector<int> &visible) {
+	SDL_Vertex *out = AddQuads(visible.size());
+	for (int i: visible) {
+		WriteQuad(
+			out,
+			list.x[i],
+			list.y[i],
+			list.w[i],
+			list.h[i],
+			clips[list.clip[i]]);
+		out += 4;
+	}
+}
+
+void SpriteBatch::Add(
+		const QuadCorners &quads,
+		const RenderList &list,
+		const ClipTable &clips,
+		const std::vector<int> &visible) {
+	SDL_Vertex *out = AddQuads(visible.size());
+	for (int i: visible) {
+		const SDL_Rect &clip = clips[list.clip[i]];
+		float u0 = clip.x * inverse_width_;
+		float v0 = clip.y * inverse_height_;
+		float u1 = (clip.x + clip.w) * inverse_width_;
+		float v1 = (clip.y + clip.h) * inverse_height_;
+		const float u[4] = { u0, u1, u1, u0 };
+		const float v[4] = { v0, v0, v1, v1 };
+		for (int corner = 0; corner < 4; ++corner) {
+			out[corner].position.x = quads.x[corner][i];
+			out[corner].position.y = quads.y[corner][i];
+			out[corner].color = kWhite;
+			out[corner].tex_coord.x = u[corner];
+			out[corner].tex_coord.y = v[corner];
+		}
+		out += 4;
+	}
+}
+
+void SpriteBatch::Add(
+		const ParticleArrays &particles,
+		const Emitter &emitter,
+		const int *frames,
+		const std::vector<int> &region_clips,
+		const ClipTable &clips) {
+	size_t count = particles.size();
+	SDL_Vertex *out = AddQuads(count);
+
+	const int *sequence = frames + emitter.first_frame;
+	const uint32_t last_frame = emitter.frame_count - 1;
+	for (size_t i = 0; i < count; ++i, out += 4) {
+		float alpha = particles.alpha[i];
+		uint32_t frame = particles.frame[i];
+		if (!emitter.random_frame) {
+			frame = static_cast<uint32_t>(
+				(1.0f - alpha) * emitter.frame_count);
+		}
+		const SDL_Rect &clip =
+			clips[region_clips[sequence[std::min(frame, last_frame)]]];
+		float left = particles.x[i] - clip.w * 0.5f;
+		float top = particles.y[i] - clip.h * 0.5f;
+		float right = left + clip.w;
+		float bottom = top + clip.h;
+		float u0 = clip.x * inverse_width_;
+		float v0 = clip.y * inverse_height_;
+		float u1 = (clip.x + clip.w) * inverse_width_;
+		float v1 = (clip.y + clip.h) * inverse_height_;
+		SDL_Color color = kWhite;
+		color.a = static_cast<Uint8>(alpha * 255.0f);
+
+		out[0].position.x = left;
+		out[0].position.y = top;
+		out[0].color = color;
+		out[0].tex_coord.x = u0;
+		out[0].tex_coord.y = v0;
+		out[1].position.x = right;
+		out[1].position.y = top;
+		out[1].color = color;
+		out[1].tex_coord.x = u1;
+		out[1].tex_coord.y = v0;
+		out[2].position.x = right;
+		out[2].position.y = bottom;
+		out[2].color = color;
+		out[2].tex_coord.x = u1;
+		out[2].tex_coord.y = v1;
+		out[3].position.x = left;
+		out[3].position.y = bottom;
+		out[3].color = color;
+		out[3].tex_coord.x = u0;
+		out[3].tex_coord.y = v1;
+	}
+}
+
+SDL_Vertex* SpriteBatch::AddQuads(size_t count) {
+	// Grown geometrically: a visible count creeping up frame by frame
+	// would otherwise reallocate on every new maximum.
+	size_t first = vertices_.size();
+	size_t needed = first + count * 4;
+	if (needed > vertices_.capacity()) {
+		vertices_.reserve(std::max(needed, vertices_.capacity() * 2));
+	}
+	vertices_.resize(needed);
+	return vertices_.data() + first;
+}
+
+void SpriteBatch::Flush() {
+	if (vertices_.empty()) {
+		return;
+	}
+
+	size_t quad_count = vertices_.size() / 4;
+	ReserveIndices(quad_count);
+
+	if (SDL_RenderGeometry(
+			renderer_,
+			texture_,
+			vertices_.data(),
+			static_cast<int>(vertices_.size()),
+			indices_.data(),
+			static_cast<int>(quad_count * 6)) != 0) {
+		SDL_LogError(
+			SDL_LOG_CATEGORY_RENDER,
+			"Failed to render geometry: %s\n",
+			SDL_GetError());
+	}
+
+	++stats_.draw_calls;
+	stats_.quads += static_cast<unsigned int>(quad_count);
+	vertices_.clear();
+}
+
+void SpriteBatch::ReserveIndices(size_t quad_count) {
+	// Every quad uses the same two-triangle pattern, so the index buffer
+	// only ever grows and is never rewritten.
+	size_t first = indices_.size() / 6;
+	if (first >= quad_count) {
+		return;
+	}
+
+	if (quad_count * 6 > indices_.capacity()) {
+		indices_.reserve(std::max(quad_count * 6, indices_.capacity() * 2));
+	}
+	for (size_t i = first; i < quad_count; ++i) {
+		int base = static_cast<int>(i * 4);
+		indices_.push_back(base);
+		indices_.push_back(base + 1);
+		indices_.push_back(base + 2);
+		indices_.push_back(base + 2);
+		indices_.push_back(base + 3);
+		indices_.push_back(base);
+	}
+}
+
+} // namespace foo
@@ -0,0 +1,137 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_SPRITE_BATCH_H_
+#define FOO_ASTEROIDS_SPRITE_BATCH_H_
+
+#include "SDL_render.h"
+#include "render_list.h"
+#include "transform.h"
+#include "particles.h"
+#include <vector>
+
+namespace foo {
+
+struct RenderStats {
+	unsigned int draw_calls;
+	unsigned int quads;
+	unsigned int culled;
+
+	RenderStats() : draw_calls(0), quads(0), culled(0) {}
+};
+
+// Accumulates textured quads and submits everything that shares a texture
+// with a single SDL_RenderGeometry call. Vertex and index storage is kept
+// between frames, so steady-state frames do not allocate.
+class SpriteBatch {
+	std::vector<SDL_Vertex> vertices_;
+	std::vector<int> indices_;
+	SDL_Renderer *renderer_;
+	SDL_Texture *texture_;
+	float inverse_width_;
+	float inverse_height_;
+	RenderStats stats_;
+
+public:
+	SpriteBatch();
+	SpriteBatch(const SpriteBatch&) = delete;
+	~SpriteBatch();
+
+	SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+	// Starts a new frame and resets the statistics.
+	void
+	Begin(SDL_Renderer *renderer);
+
+	// Flushes pending quads if the texture changes.
+	void
+	SetTexture(
+		SDL_Texture *texture,
+		int width,
+		int height);
+
+	void
+	Add(const SDL_Rect &clip, const SDL_Rect &destination);
+
+	// Adds every sprite of list, reading the arrays in place.
+	void
+	Add(const RenderList &list, const ClipTable &clips);
+
+	// Adds the sprites of list whose indices are in visible.
+	void
+	Add(
+		const RenderList &list,
+		const ClipTable &clips,
+		const std::vector<int> &visible);
+
+	// Adds the transformed sprites of list whose indices are in visible,
+	// with their corners taken from quads.
+	void
+	Add(
+		const QuadCorners &quads,
+		const RenderList &list,
+		const ClipTable &clips,
+		const std::vector<int> &visible);
+
+	// Adds every live particle of an emitter, centred on its position and
+	// faded by its alpha. Particles of random_frame emitters show their
+	// frame; the others play the sequence from frames over their life.
+	// region_clips maps spritesheet regions to clips.
+	void
+	Add(
+		const ParticleArrays &particles,
+		const Emitter &emitter,
+		const int *frames,
+		const std::vector<int> &region_clips,
+		const ClipTable &clips);
+
+	// Records quads skipped by culling in the statistics.
+	inline void
+	AddCulled(unsigned int count) { stats_.culled += count; }
+
+	void
+	Flush();
+
+	inline const RenderStats&
+	stats() const { return stats_; }
+
+private:
+	void
+	ReserveIndices(size_t quad_count);
+
+	// Appends count quads to the vertices and returns the first vertex.
+	SDL_Vertex*
+	AddQuads(size_t count);
+
+	inline void
+	WriteQuad(
+		SDL_Vertex *out,
+		int x,
+		int y,
+		int w,
+		int h,
+		const SDL_Rect &clip) const;
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_SPRITE_BATCH_H_
@@ -0,0 +1,108 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_STRING_REF_H_
+#define FOO_ASTEROIDS_STRING_REF_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+
+namespace foo {
+
+inline uint64_t
+HashString(const char *data, size_t size) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// Non-owning view of characters owned by someone else, usually a scene's
+// Arena or the atom table. Strings handed out by those are always
+// NUL-terminated, which is what makes c_str() safe to call on them.
+class StringRef {
+	const char *data_;
+	size_t size_;
+
+public:
+	StringRef() : data_(""), size_(0) {}
+	StringRef(const char *data, size_t size) : data_(data), size_(size) {}
+	StringRef(const char *value) : data_(value), size_(strlen(value)) {}
+	StringRef(const std::string &value)
+		: data_(value.c_str())
+		, size_(value.size()) {}
+
+	inline const char*
+	data() const { return data_; }
+
+	inline const char*
+	c_str() const { return data_; }
+
+	inline size_t
+	size() const { return size_; }
+
+	inline bool
+	empty() const { return 0 == size_; }
+
+	inline std::string
+	str() const { return std::string(data_, size_); }
+
+	friend inline bool
+	operator==(const StringRef &lhs, const StringRef &rhs) {
+		return lhs.size_ == rhs.size_
+			&& 0 == memcmp(lhs.data_, rhs.data_, lhs.size_);
+	}
+
+	friend inline bool
+	operator!=(const StringRef &lhs, const StringRef &rhs) {
+		return !(lhs == rhs);
+	}
+
+	friend inline bool
+	operator<(const StringRef &lhs, const StringRef &rhs) {
+		size_t size = lhs.size_ < rhs.size_ ? lhs.size_ : rhs.size_;
+		int order = memcmp(lhs.data_, rhs.data_, size);
+		return order != 0 ? order < 0 : lhs.size_ < rhs.size_;
+	}
+};
+
+} // namespace foo
+
+namespace std {
+
+template <>
+struct hash<foo::StringRef> {
+	size_t
+	operator()(const foo::StringRef &value) const {
+		return static_cast<size_t>(
+			foo::HashString(value.data(), value.size()));
+	}
+};
+
+} // namespace std
+
+#endif // FOO_ASTEROIDS_STRING_REF_H_
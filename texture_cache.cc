@@ -0,0 +1,379 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "texture_cache.h"
+#include "thread_pool.h"
+#include "timing.h"
+#include "SDL.h"
+#include "SDL_image.h"
+#include <stdexcept>
+#include <cstdlib>
+#include <climits>
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+const size_t kDefaultBudgetBytes = 256 * 1024 * 1024;
+
+} // namespace
+
+TextureCache::TextureCache()
+	: renderer_(nullptr)
+	, decode_pool_(nullptr)
+	, pending_count_(0)
+	, budget_bytes_(kDefaultBudgetBytes)
+	, resident_bytes_(0)
+	, use_counter_(0) {
+}
+
+TextureCache::~TextureCache() {}
+
+void TextureCache::set_budget_bytes(size_t budget_bytes) {
+	budget_bytes_ = budget_bytes;
+	Trim();
+}
+
+CachedTexture TextureCache::Acquire(const string &path) {
+	string key = CanonicalPath(path);
+	auto iter = entries_.find(key);
+	if (iter != end(entries_)) {
+		Entry &entry = iter->second;
+		if (entry.pending.valid()
+				|| IsFileUnchanged(entry.path, entry.stamp)) {
+			++stats_.hits;
+		} else {
+			SDL_LogInfo(
+				SDL_LOG_CATEGORY_RENDER,
+				"%s changed on disk: reloading\n",
+				path.c_str());
+			++stats_.reloads;
+			Load(entry);
+		}
+		return CachedTexture(this, &entry);
+	}
+
+	++stats_.misses;
+	Entry entry;
+	entry.path = path;
+	entry.generation = 0;
+	entry.references = 0;
+	entry.last_used = 0;
+
+	auto inserted = entries_.emplace(key, move(entry));
+	try {
+		Load(inserted.first->second);
+	} catch (...) {
+		entries_.erase(inserted.first);
+		throw;
+	}
+	CachedTexture result(this, &inserted.first->second);
+	Trim();
+	return result;
+}
+
+void TextureCache::Load(Entry &entry) {
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_RENDER,
+		"Loading %s...\n",
+		entry.path.c_str());
+
+	if (!decode_pool_) {
+		DecodedImage image = Decode(entry.path);
+		if (!Upload(entry, image)) {
+			throw runtime_error(image.error);
+		}
+		return;
+	}
+
+	string path = entry.path;
+	entry.pending = decode_pool_->Submit([path]() {
+		return Decode(path);
+	});
+	++pending_count_;
+}
+
+TextureCache::DecodedImage TextureCache::Decode(const string &path) {
+	FrameClock clock;
+	DecodedImage image;
+	image.stamp = StampFile(path);
+	image.surface = SurfacePtr(IMG_Load(path.c_str()));
+	if (!image.surface) {
+		image.error = IMG_GetError();
+	} else if (!ExtractCollisionMask(
+			image.surface.get(), image.collision_mask)) {
+		SDL_LogWarn(
+			SDL_LOG_CATEGORY_RENDER,
+			"No collision mask for %s: %s\n",
+			path.c_str(),
+			SDL_GetError());
+	}
+	image.milliseconds = clock.Tick();
+	return image;
+}
+
+bool TextureCache::Upload(Entry &entry, DecodedImage &image) {
+	stats_.decode_milliseconds += image.milliseconds;
+	// Not retried until the file changes again.
+	entry.stamp = image.stamp;
+	if (!image.surface) {
+		SDL_LogError(
+			SDL_LOG_CATEGORY_RENDER,
+			"Failed to load image: %s\n",
+			image.error.c_str());
+		return false;
+	}
+
+	FrameClock clock;
+	TexturePtr texture(SDL_CreateTextureFromSurface(
+		renderer_, image.surface.get()));
+	if (!texture) {
+		image.error = SDL_GetError();
+		SDL_LogError(
+			SDL_LOG_CATEGORY_RENDER,
+			"Failed to create texture: %s\n",
+			image.error.c_str());
+		return false;
+	}
+
+	TextureInfo info;
+	SDL_QueryTexture(
+		texture.get(), &info.format, nullptr, &info.width, &info.height);
+	info.bytes =
+		static_cast<size_t>(info.width)
+		* info.height
+		* SDL_BYTESPERPIXEL(info.format);
+
+	resident_bytes_ -= entry.info.bytes;
+	resident_bytes_ += info.bytes;
+
+	entry.texture = move(texture);
+	entry.info = info;
+	entry.collision_mask = move(image.collision_mask);
+	++entry.generation;
+	stats_.upload_milliseconds += clock.Tick();
+	return true;
+}
+
+size_t TextureCache::Pump() {
+	if (0 == pending_count_) {
+		return 0;
+	}
+
+	size_t uploaded = 0;
+	for (auto &item: entries_) {
+		Entry &entry = item.second;
+		if (!entry.pending.valid()
+				|| entry.pending.wait_for(chrono::seconds(0))
+					!= future_status::ready) {
+			continue;
+		}
+
+		--pending_count_;
+		DecodedImage image = entry.pending.get();
+		if (Upload(entry, image)) {
+			++uploaded;
+			SDL_LogInfo(
+				SDL_LOG_CATEGORY_RENDER,
+				"Streamed %s\n",
+				entry.path.c_str());
+		} else {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_RENDER,
+				"Keeping the previous texture of %s\n",
+				entry.path.c_str());
+		}
+	}
+
+	if (uploaded) {
+		Trim();
+	}
+	return uploaded;
+}
+
+void TextureCache::WaitAll() {
+	for (auto &item: entries_) {
+		Entry &entry = item.second;
+		if (entry.pending.valid()) {
+			--pending_count_;
+			DecodedImage image = entry.pending.get();
+			if (!Upload(entry, image)) {
+				SDL_LogWarn(
+					SDL_LOG_CATEGORY_RENDER,
+					"Keeping the previous texture of %s\n",
+					entry.path.c_str());
+			}
+		}
+	}
+	Trim();
+}
+
+void TextureCache::AddReference(Entry &entry) {
+	++entry.references;
+	entry.last_used = ++use_counter_;
+}
+
+void TextureCache::Release(Entry &entry) {
+	--entry.references;
+	if (0 == entry.references && resident_bytes_ > budget_bytes_) {
+		Trim();
+	}
+}
+
+void TextureCache::Trim() {
+	while (resident_bytes_ > budget_bytes_) {
+		auto victim = end(entries_);
+		for (auto iter = begin(entries_); iter != end(entries_); ++iter) {
+			if (iter->second.references > 0) {
+				continue;
+			}
+			if (victim == end(entries_)
+					|| iter->second.last_used < victim->second.last_used) {
+				victim = iter;
+			}
+		}
+
+		if (victim == end(entries_)) {
+			SDL_LogWarn(
+				SDL_LOG_CATEGORY_RENDER,
+				"Texture cache over budget: %lu of %lu bytes referenced\n",
+				static_cast<unsigned long>(resident_bytes_),
+				static_cast<unsigned long>(budget_bytes_));
+			return;
+		}
+
+		SDL_LogInfo(
+			SDL_LOG_CATEGORY_RENDER,
+			"Evicting %s\n",
+			victim->second.path.c_str());
+		resident_bytes_ -= victim->second.info.bytes;
+		if (victim->second.pending.valid()) {
+			--pending_count_;
+		}
+		++stats_.evictions;
+		entries_.erase(victim);
+	}
+}
+
+void TextureCache::Purge() {
+	for (auto iter = begin(entries_); iter != end(entries_);) {
+		if (iter->second.references > 0) {
+			++iter;
+			continue;
+		}
+		resident_bytes_ -= iter->second.info.bytes;
+		if (iter->second.pending.valid()) {
+			--pending_count_;
+		}
+		++stats_.evictions;
+		iter = entries_.erase(iter);
+	}
+}
+
+void TextureCache::LogStats() const {
+	SDL_LogInfo(
+		SDL_LOG_CATEGORY_RENDER,
+		"Texture cache: %lu texture(s), %lu of %lu KiB, %lu hit(s),"
+		" %lu miss(es), %lu reload(s), %lu eviction(s),"
+		" %.1f ms decoding, %.1f ms uploading\n",
+		static_cast<unsigned long>(entries_.size()),
+		static_cast<unsigned long>(resident_bytes_ / 1024),
+		static_cast<unsigned long>(budget_bytes_ / 1024),
+		stats_.hits,
+		stats_.misses,
+		stats_.reloads,
+		stats_.evictions,
+		stats_.decode_milliseconds,
+		stats_.upload_milliseconds);
+}
+
+string TextureCache::CanonicalPath(const string &path) {
+#ifdef _WIN32
+	char buffer[_MAX_PATH];
+	if (_fullpath(buffer, path.c_str(), _MAX_PATH)) {
+		return string(buffer);
+	}
+#else
+	char buffer[PATH_MAX];
+	if (realpath(path.c_str(), buffer)) {
+		return string(buffer);
+	}
+#endif
+	return path;
+}
+
+CachedTexture::CachedTexture() : cache_(nullptr), entry_(nullptr) {}
+
+CachedTexture::CachedTexture(TextureCache *cache, TextureCache::Entry *entry)
+	: cache_(cache)
+	, entry_(entry) {
+	cache_->AddReference(*entry_);
+}
+
+CachedTexture::CachedTexture(const CachedTexture &other)
+	: cache_(other.cache_)
+	, entry_(other.entry_) {
+	if (entry_) {
+		cache_->AddReference(*entry_);
+	}
+}
+
+CachedTexture::CachedTexture(CachedTexture &&other) noexcept
+	: cache_(nullptr)
+	, entry_(nullptr) {
+	swap(*this, other);
+}
+
+CachedTexture::~CachedTexture() {
+	if (entry_) {
+		cache_->Release(*entry_);
+	}
+}
+
+CachedTexture& CachedTexture::operator=(CachedTexture other) {
+	swap(*this, other);
+	return *this;
+}
+
+SDL_Texture* CachedTexture::get() const {
+	return entry_ ? entry_->texture.get() : nullptr;
+}
+
+const TextureInfo& CachedTexture::info() const {
+	return entry_->info;
+}
+
+const CollisionMask& CachedTexture::collision_mask() const {
+	return entry_->collision_mask;
+}
+
+unsigned int CachedTexture::generation() const {
+	return entry_ ? entry_->generation : 0;
+}
+
+const string& CachedTexture::path() const {
+	return entry_->path;
+}
+
+} // namespace foo
@@ -0,0 +1,250 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_TEXTURE_CACHE_H_
+#define FOO_ASTEROIDS_TEXTURE_CACHE_H_
+
+#include "smart_pointers.h"
+#include "file_stamp.h"
+#include "collision_mask.h"
+#include "SDL_stdinc.h"
+#include <string>
+#include <map>
+#include <future>
+
+struct SDL_Renderer;
+struct SDL_Texture;
+
+namespace foo {
+
+struct TextureInfo {
+	int width;
+	int height;
+	Uint32 format;
+	size_t bytes;
+
+	TextureInfo() : width(0), height(0), format(0), bytes(0) {}
+};
+
+struct TextureCacheStats {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long reloads;
+	unsigned long evictions;
+	// Decode time summed over all threads, and upload time on the thread
+	// that owns the renderer.
+	double decode_milliseconds;
+	double upload_milliseconds;
+
+	TextureCacheStats()
+		: hits(0)
+		, misses(0)
+		, reloads(0)
+		, evictions(0)
+		, decode_milliseconds(0.0)
+		, upload_milliseconds(0.0) {}
+};
+
+class CachedTexture;
+class ThreadPool;
+
+// Owns GPU textures keyed by canonical file path, so images referenced
+// from several textures or spritesheets are decoded and uploaded once and
+// survive scene reloads.
+//
+// With a thread pool, images are decoded on its workers and uploaded by
+// Pump() on the thread that owns the renderer; until then a reference has
+// no texture and a generation of 0.
+class TextureCache {
+	friend class CachedTexture;
+
+	struct DecodedImage {
+		SurfacePtr surface;
+		CollisionMask collision_mask;
+		FileStamp stamp;
+		double milliseconds;
+		std::string error;
+	};
+
+	struct Entry {
+		std::string path;
+		TexturePtr texture;
+		TextureInfo info;
+		// Kept on the CPU after the pixels have gone to the GPU.
+		CollisionMask collision_mask;
+		FileStamp stamp;
+		unsigned int generation;
+		int references;
+		unsigned long last_used;
+		std::future<DecodedImage> pending;
+	};
+
+	std::map<std::string, Entry> entries_;
+	SDL_Renderer *renderer_;
+	ThreadPool *decode_pool_;
+	size_t pending_count_;
+	size_t budget_bytes_;
+	size_t resident_bytes_;
+	unsigned long use_counter_;
+	TextureCacheStats stats_;
+
+public:
+	TextureCache();
+	TextureCache(const TextureCache&) = delete;
+	~TextureCache();
+
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	inline void
+	set_renderer(SDL_Renderer *renderer) { renderer_ = renderer; }
+
+	// Decode images asynchronously on pool, or synchronously in Acquire()
+	// if pool is null.
+	inline void
+	set_decode_pool(ThreadPool *pool) { decode_pool_ = pool; }
+
+	// Number of images being decoded and not yet uploaded.
+	inline size_t
+	pending_count() const { return pending_count_; }
+
+	// Unreferenced textures are evicted, least recently used first, while
+	// the resident size exceeds the budget.
+	void
+	set_budget_bytes(size_t budget_bytes);
+
+	inline size_t
+	budget_bytes() const { return budget_bytes_; }
+
+	inline size_t
+	resident_bytes() const { return resident_bytes_; }
+
+	inline size_t
+	size() const { return entries_.size(); }
+
+	inline const TextureCacheStats&
+	stats() const { return stats_; }
+
+	// Returns the texture for path, decoding it on a miss or when the file
+	// changed since it was loaded. Throws if it is decoded here and fails.
+	// A changed file keeps its previous texture until the new one is
+	// uploaded.
+	CachedTexture
+	Acquire(const std::string &path);
+
+	// Uploads images whose decoding finished. Returns the number of
+	// textures created. Images that failed to decode are logged and their
+	// references keep the texture and generation they had, if any.
+	size_t
+	Pump();
+
+	// Blocks until every pending image is decoded and uploaded.
+	void
+	WaitAll();
+
+	// Destroys every unreferenced texture.
+	void
+	Purge();
+
+	void
+	LogStats() const;
+
+private:
+	void
+	Load(Entry &entry);
+
+	// Replaces the texture of entry with image. On failure logs why,
+	// stores it in image.error and leaves the texture alone.
+	bool
+	Upload(Entry &entry, DecodedImage &image);
+
+	static DecodedImage
+	Decode(const std::string &path);
+
+	void
+	AddReference(Entry &entry);
+
+	void
+	Release(Entry &entry);
+
+	void
+	Trim();
+
+	static std::string
+	CanonicalPath(const std::string &path);
+};
+
+// A counted reference to a texture owned by TextureCache. The texture stays
+// resident while at least one reference to it exists; afterwards it may be
+// evicted when the cache goes over its memory budget.
+class CachedTexture {
+	friend class TextureCache;
+
+	TextureCache *cache_;
+	TextureCache::Entry *entry_;
+
+	CachedTexture(TextureCache *cache, TextureCache::Entry *entry);
+
+public:
+	CachedTexture();
+	CachedTexture(const CachedTexture &other);
+	CachedTexture(CachedTexture &&other) noexcept;
+	~CachedTexture();
+
+	CachedTexture& operator=(CachedTexture other);
+	friend void swap(CachedTexture &lhs, CachedTexture &rhs) {
+		using std::swap;
+
+		swap(lhs.cache_, rhs.cache_);
+		swap(lhs.entry_, rhs.entry_);
+	}
+
+	SDL_Texture*
+	get() const;
+
+	const TextureInfo&
+	info() const;
+
+	// Opaque pixels of the whole image, extracted while decoding it;
+	// empty until the texture has been uploaded.
+	const CollisionMask&
+	collision_mask() const;
+
+	// Incremented every time the file is decoded again because it changed
+	// on disk.
+	unsigned int
+	generation() const;
+
+	const std::string&
+	path() const;
+
+	explicit operator bool() const { return entry_ != nullptr; }
+
+	// True if both refer to the same cache entry, even before its texture
+	// has been uploaded.
+	friend bool operator==(const CachedTexture &lhs, const CachedTexture &rhs) {
+		return lhs.entry_ == rhs.entry_;
+	}
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_TEXTURE_CACHE_H_
@@ -0,0 +1,100 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "thread_pool.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace foo {
+
+ThreadPool::ThreadPool(unsigned int thread_count)
+	: first_task_(0)
+	, task_count_(0)
+	, stopping_(false) {
+	if (0 == thread_count) {
+		unsigned int hardware = thread::hardware_concurrency();
+		thread_count = hardware > 1 ? hardware - 1 : 1;
+	}
+
+	workers_.reserve(thread_count);
+	for (unsigned int i = 0; i < thread_count; ++i) {
+		workers_.emplace_back(&ThreadPool::Run, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard<mutex> lock(mutex_);
+		stopping_ = true;
+		tasks_.clear();
+		task_count_ = 0;
+	}
+	available_.notify_all();
+
+	for (auto &worker: workers_) {
+		worker.join();
+	}
+}
+
+void ThreadPool::Post(function<void()> function) {
+	{
+		lock_guard<mutex> lock(mutex_);
+		if (task_count_ == tasks_.size()) {
+			// Unroll the ring into a larger one, oldest first.
+			vector<std::function<void()>> grown(
+				max<size_t>(16, tasks_.size() * 2));
+			for (size_t i = 0; i < task_count_; ++i) {
+				grown[i] = move(
+					tasks_[(first_task_ + i) % tasks_.size()]);
+			}
+			tasks_.swap(grown);
+			first_task_ = 0;
+		}
+		tasks_[(first_task_ + task_count_) % tasks_.size()] =
+			move(function);
+		++task_count_;
+	}
+	available_.notify_one();
+}
+
+void ThreadPool::Run() {
+	for (;;) {
+		function<void()> task;
+		{
+			unique_lock<mutex> lock(mutex_);
+			available_.wait(lock, [this]() {
+				return stopping_ || task_count_ > 0;
+			});
+			if (stopping_) {
+				return;
+			}
+			task = move(tasks_[first_task_]);
+			tasks_[first_task_] = nullptr;
+			first_task_ = (first_task_ + 1) % tasks_.size();
+			--task_count_;
+		}
+		task();
+	}
+}
+
+} // namespace foo
@@ -0,0 +1,89 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_THREAD_POOL_H_
+#define FOO_ASTEROIDS_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace foo {
+
+// Fixed set of worker threads running queued tasks in submission order.
+// Tasks still queued when the pool is destroyed are dropped; their futures
+// report std::future_errc::broken_promise.
+class ThreadPool {
+	std::vector<std::thread> workers_;
+	// Ring of queued tasks, first_task_ being the oldest. It only grows,
+	// so once it has been as deep as it needs queueing stops allocating.
+	std::vector<std::function<void()>> tasks_;
+	size_t first_task_;
+	size_t task_count_;
+	std::mutex mutex_;
+	std::condition_variable available_;
+	bool stopping_;
+
+public:
+	// A thread_count of 0 uses one thread per hardware thread, minus the
+	// main thread.
+	explicit ThreadPool(unsigned int thread_count = 0);
+	ThreadPool(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	template <typename Function>
+	std::future<typename std::result_of<Function()>::type>
+	Submit(Function function) {
+		typedef typename std::result_of<Function()>::type Result;
+
+		auto task = std::make_shared<std::packaged_task<Result()>>(
+			std::move(function));
+		std::future<Result> result = task->get_future();
+		Post([task]() { (*task)(); });
+		return result;
+	}
+
+	// Queues function without a future, for callers that track its
+	// completion themselves. Does not allocate when function fits the
+	// small buffer of std::function, such as a lambda capturing a
+	// pointer, and the queue has been this deep before.
+	void
+	Post(std::function<void()> function);
+
+	inline size_t
+	size() const { return workers_.size(); }
+
+private:
+	void
+	Run();
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_THREAD_POOL_H_
@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "timing.h"
+#include "SDL_timer.h"
+
+namespace foo {
+
+FrameClock::FrameClock()
+	: frequency_(SDL_GetPerformanceFrequency())
+	, last_(SDL_GetPerformanceCounter()) {
+}
+
+void FrameClock::Reset() {
+	last_ = SDL_GetPerformanceCounter();
+}
+
+double FrameClock::Tick() {
+	Uint64 now = SDL_GetPerformanceCounter();
+	double elapsed = (now - last_) * 1000.0 / frequency_;
+	last_ = now;
+	return elapsed;
+}
+
+double FrameClock::Peek() const {
+	Uint64 now = SDL_GetPerformanceCounter();
+	return (now - last_) * 1000.0 / frequency_;
+}
+
+FixedTimestep::FixedTimestep(
+		double step_milliseconds,
+		double max_frame_milliseconds)
+	: step_milliseconds_(step_milliseconds)
+	, max_frame_milliseconds_(max_frame_milliseconds)
+	, accumulator_(0.0) {
+}
+
+void FixedTimestep::Accumulate(double elapsed_milliseconds) {
+	// A long stall (debugger, window drag, scene reload) would otherwise
+	// make the simulation run hundreds of steps to catch up.
+	if (elapsed_milliseconds > max_frame_milliseconds_) {
+		elapsed_milliseconds = max_frame_milliseconds_;
+	}
+	accumulator_ += elapsed_milliseconds;
+}
+
+bool FixedTimestep::ConsumeStep() {
+	if (accumulator_ < step_milliseconds_) {
+		return false;
+	}
+	accumulator_ -= step_milliseconds_;
+	return true;
+}
+
+void FixedTimestep::Reset() {
+	accumulator_ = 0.0;
+}
+
+} // namespace foo
@@ -0,0 +1,85 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_TIMING_H_
+#define FOO_ASTEROIDS_TIMING_H_
+
+#include "SDL_stdinc.h"
+
+namespace foo {
+
+// Measures wall-clock time between frames with the high resolution
+// performance counter.
+class FrameClock {
+	Uint64 frequency_;
+	Uint64 last_;
+
+public:
+	FrameClock();
+
+	void Reset();
+
+	// Returns the milliseconds elapsed since the previous call to Tick()
+	// or Reset().
+	double Tick();
+
+	// Returns the milliseconds elapsed since the previous call to Tick()
+	// or Reset() without advancing the clock.
+	double Peek() const;
+};
+
+// Splits variable frame times into fixed simulation steps. The remainder
+// left in the accumulator is exposed as an interpolation factor for the
+// renderer.
+class FixedTimestep {
+	double step_milliseconds_;
+	double max_frame_milliseconds_;
+	double accumulator_;
+
+public:
+	explicit FixedTimestep(
+		double step_milliseconds,
+		double max_frame_milliseconds = 250.0);
+
+	void
+	Accumulate(double elapsed_milliseconds);
+
+	bool
+	ConsumeStep();
+
+	void
+	Reset();
+
+	inline float
+	step_milliseconds() const {
+		return static_cast<float>(step_milliseconds_);
+	}
+
+	inline float
+	alpha() const {
+		return static_cast<float>(accumulator_ / step_milliseconds_);
+	}
+};
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_TIMING_H_
@@ -0,0 +1,212 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "transform.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FOO_ASTEROIDS_TRANSFORM_SSE2 1
+#endif
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+const float kInverseFullTurn = 1.0f / 360.0f;
+
+// Brings turns into [-0.5, 0.5], the range SineOfTurns covers.
+inline float
+WrapTurns(float turns) {
+	return turns - floor(turns + 0.5f);
+}
+
+// sin(2 pi turns): a parabola through the zeros and extremes of the sine,
+// pulled towards it by a second, weighted pass.
+inline float
+SineOfTurns(float turns) {
+	float y = 8.0f * turns - 16.0f * turns * fabs(turns);
+	return y + 0.225f * (y * fabs(y) - y);
+}
+
+#ifdef FOO_ASTEROIDS_TRANSFORM_SSE2
+inline __m128
+Abs(__m128 value) {
+	return _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+}
+
+inline __m128
+WrapTurns(__m128 turns) {
+	return _mm_sub_ps(turns, _mm_cvtepi32_ps(_mm_cvtps_epi32(turns)));
+}
+
+inline __m128
+SineOfTurns(__m128 turns) {
+	__m128 y = _mm_sub_ps(
+		_mm_mul_ps(_mm_set1_ps(8.0f), turns),
+		_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(16.0f), turns), Abs(turns)));
+	return _mm_add_ps(
+		y,
+		_mm_mul_ps(
+			_mm_set1_ps(0.225f),
+			_mm_sub_ps(_mm_mul_ps(y, Abs(y)), y)));
+}
+
+inline __m128
+LoadInts(const int *values) {
+	return _mm_cvtepi32_ps(
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(values)));
+}
+#endif
+
+} // namespace
+
+void QuadCorners::Resize(size_t count) {
+	for (int corner = 0; corner < 4; ++corner) {
+		x[corner].resize(count);
+		y[corner].resize(count);
+	}
+	left.resize(count);
+	top.resize(count);
+	right.resize(count);
+	bottom.resize(count);
+}
+
+void
+TransformRenderList(const RenderList &list, QuadCorners &out) {
+	int count = static_cast<int>(list.size());
+	out.Resize(count);
+	int i = 0;
+
+	// Each corner is the pivot plus its scaled offset from the pivot,
+	// rotated: (ox + a cos - b sin, oy + a sin + b cos), where a is one of
+	// the left and right offsets and b one of the top and bottom ones.
+#ifdef FOO_ASTEROIDS_TRANSFORM_SSE2
+	const __m128 inverse_turn = _mm_set1_ps(kInverseFullTurn);
+	const __m128 quarter_turn = _mm_set1_ps(0.25f);
+	for (; i + 4 <= count; i += 4) {
+		__m128 w = LoadInts(list.w.data() + i);
+		__m128 h = LoadInts(list.h.data() + i);
+		__m128 scale_x = _mm_loadu_ps(list.scale_x.data() + i);
+		__m128 scale_y = _mm_loadu_ps(list.scale_y.data() + i);
+		__m128 pivot_x = _mm_mul_ps(_mm_loadu_ps(list.pivot_x.data() + i), w);
+		__m128 pivot_y = _mm_mul_ps(_mm_loadu_ps(list.pivot_y.data() + i), h);
+		__m128 origin_x = _mm_add_ps(LoadInts(list.x.data() + i), pivot_x);
+		__m128 origin_y = _mm_add_ps(LoadInts(list.y.data() + i), pivot_y);
+
+		__m128 a0 = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), pivot_x), scale_x);
+		__m128 a1 = _mm_mul_ps(_mm_sub_ps(w, pivot_x), scale_x);
+		__m128 b0 = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), pivot_y), scale_y);
+		__m128 b1 = _mm_mul_ps(_mm_sub_ps(h, pivot_y), scale_y);
+
+		__m128 turns = WrapTurns(_mm_mul_ps(
+			_mm_loadu_ps(list.rotation.data() + i), inverse_turn));
+		__m128 sine = SineOfTurns(turns);
+		__m128 cosine = SineOfTurns(
+			WrapTurns(_mm_add_ps(turns, quarter_turn)));
+
+		__m128 a0_cos = _mm_mul_ps(a0, cosine);
+		__m128 a1_cos = _mm_mul_ps(a1, cosine);
+		__m128 a0_sin = _mm_mul_ps(a0, sine);
+		__m128 a1_sin = _mm_mul_ps(a1, sine);
+		__m128 b0_cos = _mm_mul_ps(b0, cosine);
+		__m128 b1_cos = _mm_mul_ps(b1, cosine);
+		__m128 b0_sin = _mm_mul_ps(b0, sine);
+		__m128 b1_sin = _mm_mul_ps(b1, sine);
+
+		__m128 x0 = _mm_add_ps(origin_x, _mm_sub_ps(a0_cos, b0_sin));
+		__m128 y0 = _mm_add_ps(origin_y, _mm_add_ps(a0_sin, b0_cos));
+		__m128 x1 = _mm_add_ps(origin_x, _mm_sub_ps(a1_cos, b0_sin));
+		__m128 y1 = _mm_add_ps(origin_y, _mm_add_ps(a1_sin, b0_cos));
+		__m128 x2 = _mm_add_ps(origin_x, _mm_sub_ps(a1_cos, b1_sin));
+		__m128 y2 = _mm_add_ps(origin_y, _mm_add_ps(a1_sin, b1_cos));
+		__m128 x3 = _mm_add_ps(origin_x, _mm_sub_ps(a0_cos, b1_sin));
+		__m128 y3 = _mm_add_ps(origin_y, _mm_add_ps(a0_sin, b1_cos));
+
+		_mm_storeu_ps(out.x[0].data() + i, x0);
+		_mm_storeu_ps(out.y[0].data() + i, y0);
+		_mm_storeu_ps(out.x[1].data() + i, x1);
+		_mm_storeu_ps(out.y[1].data() + i, y1);
+		_mm_storeu_ps(out.x[2].data() + i, x2);
+		_mm_storeu_ps(out.y[2].data() + i, y2);
+		_mm_storeu_ps(out.x[3].data() + i, x3);
+		_mm_storeu_ps(out.y[3].data() + i, y3);
+		_mm_storeu_ps(
+			out.left.data() + i,
+			_mm_min_ps(_mm_min_ps(x0, x1), _mm_min_ps(x2, x3)));
+		_mm_storeu_ps(
+			out.top.data() + i,
+			_mm_min_ps(_mm_min_ps(y0, y1), _mm_min_ps(y2, y3)));
+		_mm_storeu_ps(
+			out.right.data() + i,
+			_mm_max_ps(_mm_max_ps(x0, x1), _mm_max_ps(x2, x3)));
+		_mm_storeu_ps(
+			out.bottom.data() + i,
+			_mm_max_ps(_mm_max_ps(y0, y1), _mm_max_ps(y2, y3)));
+	}
+#endif
+
+	for (; i < count; ++i) {
+		float w = static_cast<float>(list.w[i]);
+		float h = static_cast<float>(list.h[i]);
+		float pivot_x = list.pivot_x[i] * w;
+		float pivot_y = list.pivot_y[i] * h;
+		float origin_x = list.x[i] + pivot_x;
+		float origin_y = list.y[i] + pivot_y;
+		float a[2] = {
+			-pivot_x * list.scale_x[i],
+			(w - pivot_x) * list.scale_x[i]
+		};
+		float b[2] = {
+			-pivot_y * list.scale_y[i],
+			(h - pivot_y) * list.scale_y[i]
+		};
+
+		float turns = WrapTurns(list.rotation[i] * kInverseFullTurn);
+		float sine = SineOfTurns(turns);
+		float cosine = SineOfTurns(WrapTurns(turns + 0.25f));
+
+		// Offsets of the corners in the order of QuadCorners.
+		static const int kA[4] = { 0, 1, 1, 0 };
+		static const int kB[4] = { 0, 0, 1, 1 };
+		for (int corner = 0; corner < 4; ++corner) {
+			float offset_a = a[kA[corner]];
+			float offset_b = b[kB[corner]];
+			out.x[corner][i] = origin_x + offset_a * cosine - offset_b * sine;
+			out.y[corner][i] = origin_y + offset_a * sine + offset_b * cosine;
+		}
+		out.left[i] = min(
+			min(out.x[0][i], out.x[1][i]), min(out.x[2][i], out.x[3][i]));
+		out.top[i] = min(
+			min(out.y[0][i], out.y[1][i]), min(out.y[2][i], out.y[3][i]));
+		out.right[i] = max(
+			max(out.x[0][i], out.x[1][i]), max(out.x[2][i], out.x[3][i]));
+		out.bottom[i] = max(
+			max(out.y[0][i], out.y[1][i]), max(out.y[2][i], out.y[3][i]));
+	}
+}
+
+} // namespace foo
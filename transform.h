@@ -0,0 +1,59 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_TRANSFORM_H_
+#define FOO_ASTEROIDS_TRANSFORM_H_
+
+#include "render_list.h"
+#include <cstddef>
+#include <vector>
+
+namespace foo {
+
+// Corners of transformed sprites as parallel arrays, one per corner, in
+// the order top-left, top-right, bottom-right, bottom-left of the sprite
+// before it was transformed, with the bounding box of each for culling.
+struct QuadCorners {
+	std::vector<float> x[4];
+	std::vector<float> y[4];
+	std::vector<float> left;
+	std::vector<float> top;
+	std::vector<float> right;
+	std::vector<float> bottom;
+
+	inline size_t
+	size() const { return left.size(); }
+
+	void
+	Resize(size_t count);
+};
+
+// Computes the corners of every sprite of list, rotated and scaled about
+// its pivot. Works on four sprites at a time where SSE2 is available;
+// sines and cosines come from a polynomial accurate to about 0.001, well
+// under a pixel for sprites of the sizes drawn here.
+void
+TransformRenderList(const RenderList &list, QuadCorners &out);
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_TRANSFORM_H_
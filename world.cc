@@ -0,0 +1,322 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "world.h"
+#include "scene.h"
+#include "SDL_log.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace std;
+
+namespace foo {
+
+namespace {
+
+// Size of the sprite of object if the scene knows it, that is if it is a
+// composite or a spritesheet region; plain textures are only measured
+// once decoded, and are 0 by 0 here.
+void
+MeasureSprite(
+		const Scene &scene,
+		const SceneObject &object,
+		int &width,
+		int &height) {
+	width = 0;
+	height = 0;
+	const SceneComponentTexture *texture = object.texture;
+	if (object.composite && object.composite->composite_index >= 0) {
+		const SceneComposite &composite =
+			scene.composites()[object.composite->composite_index];
+		width = composite.width;
+		height = composite.height;
+	} else if (texture && texture->spritesheet_index >= 0) {
+		const SceneSceneSpritesheetRegion &region =
+			scene.spritesheets()[texture->spritesheet_index]
+				.regions[texture->region_index];
+		width = region.width;
+		height = region.height;
+	}
+}
+
+// Centres the collider of object on its sprite. Unmeasured sprites have
+// their circle at the top-left corner. Scaled sprites scale the circle
+// about the pivot; rotation is ignored, which is exact for the default
+// pivot at the centre.
+bool
+MakeCollider(
+		const Scene &scene,
+		const SceneObject &object,
+		ColliderComponent &out) {
+	out.radius = object.collider->radius;
+	out.offset_x = out.radius;
+	out.offset_y = out.radius;
+
+	int width;
+	int height;
+	MeasureSprite(scene, object, width, height);
+	if (width > 0 && height > 0) {
+		out.offset_x = width * 0.5f;
+		out.offset_y = height * 0.5f;
+		if (out.radius <= 0.0f) {
+			out.radius = min(width, height) * 0.5f;
+		}
+
+		const SceneComponentTransform *transform = object.transform;
+		if (transform) {
+			float pivot_x = transform->pivot_x * width;
+			float pivot_y = transform->pivot_y * height;
+			out.offset_x = pivot_x
+				+ (out.offset_x - pivot_x) * transform->scale_x;
+			out.offset_y = pivot_y
+				+ (out.offset_y - pivot_y) * transform->scale_y;
+			out.radius *= min(
+				fabs(transform->scale_x),
+				fabs(transform->scale_y));
+		}
+	}
+
+	if (out.radius <= 0.0f) {
+		SDL_LogWarn(
+			SDL_LOG_CATEGORY_SYSTEM,
+			"%s: collider needs a radius unless drawn from a"
+			" spritesheet or composite: ignoring\n",
+			AtomName(object.id).c_str());
+		return false;
+	}
+	return true;
+}
+
+} // namespace
+
+World::World() : entity_count_(0) {}
+
+World::~World() {}
+
+Entity World::Create() {
+	Entity entity;
+	if (!free_indices_.empty()) {
+		entity.index = free_indices_.back();
+		free_indices_.pop_back();
+	} else {
+		entity.index = static_cast<uint32_t>(generations_.size());
+		generations_.push_back(0);
+	}
+	entity.generation = generations_[entity.index];
+	++entity_count_;
+	return entity;
+}
+
+void World::Destroy(Entity entity) {
+	if (!IsAlive(entity)) {
+		return;
+	}
+
+	names_.Remove(entity);
+	positions_.Remove(entity);
+	sprites_.Remove(entity);
+	texture_repeats_.Remove(entity);
+	bodies_.Remove(entity);
+	colliders_.Remove(entity);
+	animations_.Remove(entity);
+	transforms_.Remove(entity);
+	particles_.Remove(entity);
+
+	++generations_[entity.index];
+	free_indices_.push_back(entity.index);
+	--entity_count_;
+}
+
+void World::Clear() {
+	names_.Clear();
+	positions_.Clear();
+	sprites_.Clear();
+	texture_repeats_.Clear();
+	bodies_.Clear();
+	colliders_.Clear();
+	animations_.Clear();
+	transforms_.Clear();
+	particles_.Clear();
+
+	// Free indices are handed out lowest first again.
+	free_indices_.clear();
+	free_indices_.reserve(generations_.size());
+	for (size_t i = generations_.size(); i > 0; --i) {
+		++generations_[i - 1];
+		free_indices_.push_back(static_cast<uint32_t>(i - 1));
+	}
+	entity_count_ = 0;
+}
+
+void InstantiateScene(const Scene &scene, World &world) {
+	world.Clear();
+
+	const auto &objects = scene.objects();
+	world.names().Reserve(objects.size());
+	world.positions().Reserve(objects.size());
+	world.sprites().Reserve(objects.size());
+
+	// Where each sequence of the scene starts in the animation and
+	// particle pools.
+	unordered_map<const int*, uint32_t> sequences;
+	unordered_map<const int*, uint32_t> particle_sequences;
+
+	for (const auto &object: objects) {
+		Entity entity = world.Create();
+		world.names().Add(entity, object.id);
+
+		PositionComponent position = { object.x, object.y };
+		world.positions().Add(entity, position);
+
+		bool spins = object.velocity && 0.0f != object.velocity->angular;
+		if (object.transform || spins) {
+			TransformComponent transform = { 0.0f, 1.0f, 1.0f, 0.5f, 0.5f };
+			if (object.transform) {
+				transform.rotation = object.transform->rotation;
+				transform.scale_x = object.transform->scale_x;
+				transform.scale_y = object.transform->scale_y;
+				transform.pivot_x = object.transform->pivot_x;
+				transform.pivot_y = object.transform->pivot_y;
+			}
+			world.transforms().Add(entity, transform);
+		}
+
+		if (object.velocity) {
+			Body body = {
+				static_cast<float>(object.x),
+				static_cast<float>(object.y),
+				object.velocity->x,
+				object.velocity->y,
+				object.transform ? object.transform->rotation : 0.0f,
+				object.velocity->angular
+			};
+			world.bodies().Add(entity, body);
+		}
+
+		ColliderComponent collider;
+		if (object.collider && MakeCollider(scene, object, collider)) {
+			world.colliders().Add(entity, collider);
+		}
+
+		const SceneComponentEmitter *emitter = object.emitter;
+		if (emitter && emitter->frame_count > 0) {
+			auto iter = particle_sequences.find(emitter->frames);
+			if (iter == end(particle_sequences)) {
+				iter = particle_sequences.emplace(
+					emitter->frames,
+					world.particles().AddSequence(
+						emitter->frames,
+						emitter->frame_count)).first;
+			}
+			int width;
+			int height;
+			MeasureSprite(scene, object, width, height);
+			uint32_t burst = static_cast<uint32_t>(max(emitter->burst, 0));
+			float life_max = max(emitter->life_min, emitter->life_max);
+			// By default, room for the burst and a full life of emission.
+			uint32_t capacity = emitter->capacity > 0
+				? static_cast<uint32_t>(emitter->capacity)
+				: burst + static_cast<uint32_t>(
+					ceil(max(emitter->rate, 0.0f) * life_max));
+			Emitter settings = {
+				emitter->spritesheet_index,
+				iter->second,
+				static_cast<uint32_t>(emitter->frame_count),
+				emitter->random_frame,
+				max(capacity, 1u),
+				max(emitter->rate, 0.0f),
+				burst,
+				emitter->life_min,
+				life_max,
+				emitter->speed_min,
+				emitter->speed_max,
+				emitter->angle,
+				emitter->spread,
+				emitter->offset_x,
+				emitter->offset_y,
+				static_cast<float>(width),
+				static_cast<float>(height)
+			};
+			world.particles().Add(entity, settings);
+		}
+
+		if (object.composite && object.composite->composite_index >= 0) {
+			SpriteComponent sprite = {
+				-1,
+				-1,
+				-1,
+				object.composite->composite_index
+			};
+			world.sprites().Add(entity, sprite);
+			continue;
+		}
+
+		const SceneComponentTexture *texture = object.texture;
+		if (!texture
+				|| (texture->texture_index < 0
+					&& texture->spritesheet_index < 0)) {
+			continue;
+		}
+
+		SpriteComponent sprite = {
+			texture->texture_index,
+			texture->spritesheet_index,
+			texture->region_index,
+			-1
+		};
+
+		if (object.texture_repeat) {
+			world.sprites().Add(entity, sprite);
+			TextureRepeatComponent repeat = {
+				object.texture_repeat->repeat_x,
+				object.texture_repeat->repeat_y
+			};
+			world.texture_repeats().Add(entity, repeat);
+			continue;
+		}
+
+		const SceneComponentAnimation *animation = object.animation;
+		if (animation && animation->frame_count > 0) {
+			auto iter = sequences.find(animation->frames);
+			if (iter == end(sequences)) {
+				iter = sequences.emplace(
+					animation->frames,
+					world.animations().AddSequence(
+						animation->frames,
+						animation->frame_count)).first;
+			}
+			Animation playing = {
+				iter->second,
+				static_cast<uint32_t>(animation->frame_count),
+				animation->fps,
+				animation->loop
+			};
+			world.animations().Add(entity, playing);
+			// Bound to the render lists at the first frame.
+			sprite.region_index = animation->frames[0];
+		}
+		world.sprites().Add(entity, sprite);
+	}
+}
+
+} // namespace foo
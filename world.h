@@ -0,0 +1,197 @@
+/*
+Copyright (c) 2015 Dilyan Rusev
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FOO_ASTEROIDS_WORLD_H_
+#define FOO_ASTEROIDS_WORLD_H_
+
+#include "atom.h"
+#include "component_pool.h"
+#include "kinematics.h"
+#include "animation.h"
+#include "particles.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace foo {
+
+class Scene;
+
+struct PositionComponent {
+	int x;
+	int y;
+};
+
+// Drawn with a texture, a spritesheet region or a composite; the indices
+// are the resolved handles of SceneComponentTexture and
+// SceneComponentComposite, so exactly one of texture_index,
+// spritesheet_index and composite_index is set.
+struct SpriteComponent {
+	int texture_index;
+	int spritesheet_index;
+	int region_index;
+	int composite_index;
+};
+
+struct TextureRepeatComponent {
+	int repeat_x;
+	int repeat_y;
+};
+
+// Rotation, in degrees clockwise, and scale of a sprite about a pivot
+// given as a fraction of its size. Bodies with one publish their rotation
+// into it.
+struct TransformComponent {
+	float rotation;
+	float scale_x;
+	float scale_y;
+	float pivot_x;
+	float pivot_y;
+};
+
+// Collision circle whose centre is offset from the entity's position,
+// which is the top-left corner of its sprite.
+struct ColliderComponent {
+	float offset_x;
+	float offset_y;
+	float radius;
+};
+
+// Entities and their components. Systems iterate the pool of the
+// component they drive and look up the others by entity.
+class World {
+	// Current generation of every index. Destroying an entity advances it,
+	// so only the latest handle to an index is alive.
+	std::vector<uint32_t> generations_;
+	std::vector<uint32_t> free_indices_;
+	size_t entity_count_;
+	ComponentPool<Atom> names_;
+	ComponentPool<PositionComponent> positions_;
+	ComponentPool<SpriteComponent> sprites_;
+	ComponentPool<TextureRepeatComponent> texture_repeats_;
+	BodyPool bodies_;
+	ComponentPool<ColliderComponent> colliders_;
+	AnimationPool animations_;
+	ComponentPool<TransformComponent> transforms_;
+	ParticlePool particles_;
+
+public:
+	World();
+	World(const World&) = delete;
+	~World();
+
+	World& operator=(const World&) = delete;
+
+	Entity
+	Create();
+
+	// Removes entity and all of its components. Does nothing for handles
+	// that are no longer alive.
+	void
+	Destroy(Entity entity);
+
+	// Destroys every entity; handles given out so far stay invalid.
+	void
+	Clear();
+
+	inline bool
+	IsAlive(Entity entity) const {
+		return entity.index < generations_.size()
+			&& generations_[entity.index] == entity.generation;
+	}
+
+	inline size_t
+	size() const { return entity_count_; }
+
+	inline ComponentPool<Atom>&
+	names() { return names_; }
+
+	inline const ComponentPool<Atom>&
+	names() const { return names_; }
+
+	inline ComponentPool<PositionComponent>&
+	positions() { return positions_; }
+
+	inline const ComponentPool<PositionComponent>&
+	positions() const { return positions_; }
+
+	inline ComponentPool<SpriteComponent>&
+	sprites() { return sprites_; }
+
+	inline const ComponentPool<SpriteComponent>&
+	sprites() const { return sprites_; }
+
+	inline ComponentPool<TextureRepeatComponent>&
+	texture_repeats() { return texture_repeats_; }
+
+	inline const ComponentPool<TextureRepeatComponent>&
+	texture_repeats() const { return texture_repeats_; }
+
+	// Entities that move. KinematicsSystem owns their positions and
+	// publishes them into positions() for everything else.
+	inline BodyPool&
+	bodies() { return bodies_; }
+
+	inline const BodyPool&
+	bodies() const { return bodies_; }
+
+	inline ComponentPool<ColliderComponent>&
+	colliders() { return colliders_; }
+
+	inline const ComponentPool<ColliderComponent>&
+	colliders() const { return colliders_; }
+
+	// Sprites that cycle through spritesheet regions. The region shown is
+	// the animation's, not the one in sprites().
+	inline AnimationPool&
+	animations() { return animations_; }
+
+	inline const AnimationPool&
+	animations() const { return animations_; }
+
+	// Sprites drawn rotated or scaled; the others are drawn as they are.
+	inline ComponentPool<TransformComponent>&
+	transforms() { return transforms_; }
+
+	inline const ComponentPool<TransformComponent>&
+	transforms() const { return transforms_; }
+
+	// Emitters and their particles, which go with their owner.
+	inline ParticlePool&
+	particles() { return particles_; }
+
+	inline const ParticlePool&
+	particles() const { return particles_; }
+};
+
+// Replaces the contents of world with one entity per object of scene, in
+// scene order. Objects whose composite or texture did not resolve get no
+// sprite; objects with a velocity get a body, and spritesheet sprites with
+// resolved frames an animation. Objects with a transform, or that spin,
+// get a TransformComponent, and objects with an emitter whose frames
+// resolved an emitter. Composites are neither repeated nor animated.
+void
+InstantiateScene(const Scene &scene, World &world);
+
+} // namespace foo
+
+#endif // FOO_ASTEROIDS_WORLD_H_